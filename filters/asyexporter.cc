@@ -78,7 +78,7 @@ void AsyExporter::run(const KigPart &doc, KigWidget &w)
     const double height = w.showingRect().height();
     const double width = w.showingRect().width();
 
-    std::vector<ObjectHolder *> os = doc.document().objects();
+    const std::vector<ObjectHolder *> &os = doc.document().objects();
     QTextStream stream(&file);
     AsyExporterImpVisitor visitor(stream, w);
 
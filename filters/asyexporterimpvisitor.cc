@@ -4,6 +4,8 @@
 
 #include "asyexporterimpvisitor.h"
 
+#include "../misc/common.h"
+#include "../misc/cubic-common.h"
 #include "../misc/goniometry.h"
 #include "../objects/bezier_imp.h"
 #include "../objects/circle_imp.h"
@@ -112,41 +114,11 @@ void AsyExporterImpVisitor::visit(ObjectHolder *obj)
 
 void AsyExporterImpVisitor::plotGenericCurve(const CurveImp *imp)
 {
-    std::vector<std::vector<Coordinate>> coordlist;
-    coordlist.push_back(std::vector<Coordinate>());
-    uint curid = 0;
-
-    Coordinate c;
-    Coordinate prev = Coordinate::invalidCoord();
-    for (double i = 0.0; i <= 1.0; i += 0.0001) {
-        c = imp->getPoint(i, mw.document());
-        if (!c.valid()) {
-            if (coordlist[curid].size() > 0) {
-                coordlist.push_back(std::vector<Coordinate>());
-                ++curid;
-                prev = Coordinate::invalidCoord();
-            }
-            continue;
-        }
-        if (!((fabs(c.x) <= 10000) && (fabs(c.y) <= 10000)))
-            continue;
-        // if there's too much distance between this coordinate and the previous
-        // one, then it's another piece of curve not joined with the rest
-        if (prev.valid() && (c.distance(prev) > 50.0)) {
-            coordlist.push_back(std::vector<Coordinate>());
-            ++curid;
-        }
-        coordlist[curid].push_back(c);
-        prev = c;
-    }
-    // special case for ellipse
-    if (const ConicImp *conic = dynamic_cast<const ConicImp *>(imp)) {
-        // if ellipse, close its path
-        // THSI IS WRONG, think of ellipse arcs!!
-        if (conic->conicType() == 1 && coordlist.size() == 1 && coordlist[0].size() > 1) {
-            coordlist[0].push_back(coordlist[0][0]);
-        }
-    }
+    plotCoordinateLists(calcCurvePolylines(imp, mw.document(), msr, msr.width() * exportCurvePrecision));
+}
+
+void AsyExporterImpVisitor::plotCoordinateLists(const std::vector<std::vector<Coordinate>> &coordlist)
+{
     for (uint i = 0; i < coordlist.size(); ++i) {
         uint s = coordlist[i].size();
         // there's no point in draw curves empty or with only one point
@@ -264,8 +236,9 @@ void AsyExporterImpVisitor::visit(const ConicImp *imp)
 
 void AsyExporterImpVisitor::visit(const CubicImp *imp)
 {
-    // FIXME: cubic are not drawn correctly with plotGenericCurve
-    plotGenericCurve(imp);
+    // the parametrization of cubics breaks up at nodes and cusps, so
+    // we trace the cartesian equation instead..
+    plotCoordinateLists(calcCubicPolylines(imp->data(), msr, msr.width() * exportCurvePrecision));
 }
 
 void AsyExporterImpVisitor::visit(const SegmentImp *imp)
@@ -112,4 +112,9 @@ private:
      * Plots a generic curve though its points calc'ed with getPoint.
      */
     void plotGenericCurve(const CurveImp *imp);
+
+    /**
+     * Plots a set of polylines, one path for each of them.
+     */
+    void plotCoordinateLists(const std::vector<std::vector<Coordinate>> &coordlist);
 };
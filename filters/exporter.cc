@@ -16,16 +16,23 @@
 #include "../misc/common.h"
 #include "../misc/kigfiledialog.h"
 #include "../misc/kigpainter.h"
+#include "../misc/kigtrace.h"
 
 #include <QImageWriter>
 #include <QMimeDatabase>
+#include <QPainter>
+#include <QPicture>
 #include <QStandardPaths>
+#include <QThreadPool>
 
 #include <KActionCollection>
 #include <KActionMenu>
 #include <KIconEngine>
 #include <KMessageBox>
 
+#include <algorithm>
+#include <vector>
+
 ExporterAction::ExporterAction(const KigPart *doc, KigWidget *w, KActionCollection *parent, KigExporter *exp)
     : QAction(exp->menuEntryName(), parent)
     , mexp(exp)
@@ -42,6 +49,7 @@ ExporterAction::ExporterAction(const KigPart *doc, KigWidget *w, KActionCollecti
 
 void ExporterAction::slotActivated()
 {
+    KigTrace::Span span("export", "KigExporter::run", mexp->menuEntryName());
     mexp->run(*mdoc, *mw);
 }
 
@@ -109,17 +117,90 @@ void ImageExporter::run(const KigPart &doc, KigWidget &w)
         return;
     };
 
-    QPixmap img(imgsize);
-    img.fill(Qt::white);
-    KigPainter p(ScreenInfo(w.screenInfo().shownRect(), img.rect()), &img, doc.document());
-    p.setWholeWinOverlay();
-    p.drawGrid(doc.document().coordinateSystem(), showgrid, showaxes);
-    // FIXME: show the selections ?
-    p.drawObjects(doc.document().objects(), false);
     const QStringList types = mimeType.suffixes();
     if (types.isEmpty())
         return; // TODO error dialog?
-    if (!img.save(filename, types.at(0).toLatin1())) {
+    const QByteArray format = types.at(0).toLatin1();
+
+    // The document is drawn only once, into a QPicture, so that expensive
+    // objects like loci are calculated once however large the image is.
+    // The picture is then replayed into bands of the image, in parallel,
+    // and each band is handed to the encoder as soon as it is ready.
+    QPicture picture;
+    picture.setBoundingRect(QRect(QPoint(0, 0), imgsize));
+    {
+        KigPainter p(ScreenInfo(w.screenInfo().shownRect(), picture.boundingRect()), &picture, doc.document(), false);
+        p.drawGrid(doc.document().coordinateSystem(), showgrid, showaxes);
+        // FIXME: show the selections ?
+        p.drawObjects(doc.document().objects(), false);
+    }
+    const QByteArray picturedata(picture.data(), picture.size());
+
+    // PPM can be written a band at a time, the other formats are written
+    // by QImageWriter, which needs the whole image.
+    const bool streamed = format == "ppm";
+    QImage img;
+    if (streamed)
+        file.write(QStringLiteral("P6\n%1 %2\n255\n").arg(imgsize.width()).arg(imgsize.height()).toLatin1());
+    else {
+        img = QImage(imgsize, QImage::Format_RGB888);
+        if (img.isNull()) {
+            KMessageBox::error(&w,
+                               i18n("There is not enough memory to export an image of this size to this format. "
+                                    "Please choose a smaller image size, or the PPM format, which is written in pieces."));
+            return;
+        }
+    }
+
+    // bands of about 4 megapixels, rendered by as many threads as there are
+    // cores, so that only a few bands are in memory at a time
+    const int bandheight = std::max(1, (1 << 22) / std::max(1, imgsize.width()));
+    QThreadPool pool;
+    const int batchsize = std::max(1, pool.maxThreadCount());
+    std::vector<QImage> bands;
+    bool ok = true;
+    for (int top = 0; ok && top < imgsize.height(); top += batchsize * bandheight) {
+        bands.clear();
+        for (int y = top; y < imgsize.height() && y < top + batchsize * bandheight; y += bandheight)
+            bands.push_back(QImage(imgsize.width(), std::min(bandheight, imgsize.height() - y), QImage::Format_RGB32));
+        for (int i = 0; i < int(bands.size()); ++i) {
+            QImage *band = &bands[i];
+            const int y = top + i * bandheight;
+            pool.start([band, y, &picturedata]() {
+                // QPicture::play() isn't reentrant, so every thread
+                // plays its own copy of the picture
+                if (band->isNull())
+                    return;
+                QPicture copy;
+                copy.setData(picturedata.constData(), picturedata.size());
+                band->fill(Qt::white);
+                QPainter painter(band);
+                painter.translate(0, -y);
+                painter.drawPicture(0, 0, copy);
+            });
+        }
+        pool.waitForDone();
+
+        for (int i = 0; ok && i < int(bands.size()); ++i) {
+            const int y = top + i * bandheight;
+            if (bands[i].isNull())
+                ok = false;
+            else if (streamed) {
+                const QImage rgb = bands[i].convertToFormat(QImage::Format_RGB888);
+                for (int line = 0; ok && line < rgb.height(); ++line)
+                    ok = file.write(reinterpret_cast<const char *>(rgb.constScanLine(line)), 3 * rgb.width()) == 3 * rgb.width();
+            } else {
+                QPainter painter(&img);
+                painter.drawImage(0, y, bands[i]);
+            }
+        }
+    }
+
+    if (ok && !streamed) {
+        QImageWriter writer(&file, format);
+        ok = writer.write(img);
+    }
+    if (!ok) {
         KMessageBox::error(&w, i18n("Sorry, something went wrong while saving to image \"%1\"", filename));
     }
 }
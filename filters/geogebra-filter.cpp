@@ -19,10 +19,8 @@
 #include <KZip>
 #include <QDebug>
 
-#include <QFile>
-#include <QXmlQuery>
-
 #include <algorithm>
+#include <memory>
 
 KigFilterGeogebra *KigFilterGeogebra::instance()
 {
@@ -49,19 +47,15 @@ KigDocument *KigFilterGeogebra::load(const QString &sFrom)
         const KZipFileEntry *geogebraXMLEntry = dynamic_cast<const KZipFileEntry *>(geogebraFile.directory()->entry(QStringLiteral("geogebra.xml")));
 
         if (geogebraXMLEntry) {
-            QXmlNamePool np;
-            QXmlQuery geogebraXSLT(QXmlQuery::XSLT20, np);
-            const QString encodedData = QString::fromUtf8(geogebraXMLEntry->data().constData());
-            QFile queryDevice(QStringLiteral(":/kig/geogebra/geogebra.xsl"));
-            GeogebraTransformer ggbtransform(document, np);
-
-            queryDevice.open(QFile::ReadOnly);
-            geogebraXSLT.setFocus(encodedData);
-            geogebraXSLT.setQuery(&queryDevice);
-            geogebraXSLT.evaluateTo(&ggbtransform);
-            queryDevice.close();
-
-            assert(ggbtransform.getNumberOfSections() == 1);
+            // the entry is decompressed while it is being read
+            std::unique_ptr<QIODevice> device(geogebraXMLEntry->createDevice());
+            GeogebraTransformer ggbtransform(document);
+
+            if (!device || !ggbtransform.read(*device) || ggbtransform.getNumberOfSections() != 1) {
+                delete document;
+                parseError(ggbtransform.errorString());
+                return nullptr;
+            }
 
             const GeogebraSection &gs = ggbtransform.getSection(0);
             const std::vector<ObjectCalcer *> &f = gs.getOutputObjects();
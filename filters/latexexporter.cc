@@ -14,6 +14,7 @@
 #include "../kig/kig_part.h"
 #include "../kig/kig_view.h"
 #include "../misc/common.h"
+#include "../misc/cubic-common.h"
 #include "../misc/goniometry.h"
 #include "../misc/kigfiledialog.h"
 #include "../misc/rect.h"
@@ -145,6 +146,10 @@ private:
      * Plots a generic curve though its points calc'ed with getPoint.
      */
     void plotGenericCurve(const CurveImp *imp);
+    /**
+     * Plots a set of polylines, one curve for each of them.
+     */
+    void plotCoordinateLists(const std::vector<std::vector<Coordinate>> &coordlist);
 };
 
 void PSTricksExportImpVisitor::emitCoord(const Coordinate &c)
@@ -212,6 +217,11 @@ QString PSTricksExportImpVisitor::writeStyle(Qt::PenStyle style)
 }
 
 void PSTricksExportImpVisitor::plotGenericCurve(const CurveImp *imp)
+{
+    plotCoordinateLists(calcCurvePolylines(imp, mw.document(), msr, msr.width() * exportCurvePrecision));
+}
+
+void PSTricksExportImpVisitor::plotCoordinateLists(const std::vector<std::vector<Coordinate>> &coordlist)
 {
     int width = mcurobj->drawer()->width();
     if (width == -1)
@@ -219,40 +229,6 @@ void PSTricksExportImpVisitor::plotGenericCurve(const CurveImp *imp)
 
     QString prefix = QStringLiteral("\\pscurve[linecolor=%1,linewidth=%2,%3]").arg(mcurcolorid).arg(width / 100.0).arg(writeStyle(mcurobj->drawer()->style()));
 
-    std::vector<std::vector<Coordinate>> coordlist;
-    coordlist.push_back(std::vector<Coordinate>());
-    uint curid = 0;
-
-    Coordinate c;
-    Coordinate prev = Coordinate::invalidCoord();
-    for (double i = 0.0; i <= 1.0; i += 0.005) {
-        c = imp->getPoint(i, mw.document());
-        if (!c.valid()) {
-            if (coordlist[curid].size() > 0) {
-                coordlist.push_back(std::vector<Coordinate>());
-                ++curid;
-                prev = Coordinate::invalidCoord();
-            }
-            continue;
-        }
-        if (!((fabs(c.x) <= 1000) && (fabs(c.y) <= 1000)))
-            continue;
-        // if there's too much distance between this coordinate and the previous
-        // one, then it's another piece of curve not joined with the rest
-        if (prev.valid() && (c.distance(prev) > 4.0)) {
-            coordlist.push_back(std::vector<Coordinate>());
-            ++curid;
-        }
-        coordlist[curid].push_back(c);
-        prev = c;
-    }
-    // special case for ellipse
-    if (const ConicImp *conic = dynamic_cast<const ConicImp *>(imp)) {
-        // if ellipse, close its path
-        if (conic->conicType() == 1 && coordlist.size() == 1 && coordlist[0].size() > 1) {
-            coordlist[0].push_back(coordlist[0][0]);
-        }
-    }
     for (uint i = 0; i < coordlist.size(); ++i) {
         uint s = coordlist[i].size();
         // there's no point in draw curves empty or with only one point
@@ -391,10 +367,11 @@ void PSTricksExportImpVisitor::visit(const ConicImp *imp)
     plotGenericCurve(imp);
 }
 
-void PSTricksExportImpVisitor::visit(const CubicImp *)
+void PSTricksExportImpVisitor::visit(const CubicImp *imp)
 {
-    // FIXME: cubic are not drawn correctly with plotGenericCurve
-    //  plotGenericCurve( imp );
+    // the parametrization of cubics breaks up at nodes and cusps, so
+    // we trace the cartesian equation instead..
+    plotCoordinateLists(calcCubicPolylines(imp->data(), msr, msr.width() * exportCurvePrecision));
 }
 
 void PSTricksExportImpVisitor::visit(const SegmentImp *imp)
@@ -551,7 +528,7 @@ void LatexExporter::run(const KigPart &doc, KigWidget &w)
     };
 
     QTextStream stream(&file);
-    std::vector<ObjectHolder *> os = doc.document().objects();
+    const std::vector<ObjectHolder *> &os = doc.document().objects();
 
     if (format == LatexExporterOptions::PSTricks) {
         if (standalone) {
@@ -8,6 +8,7 @@
 #include "../kig/kig_part.h"
 #include "../misc/calcpaths.h"
 #include "../misc/coordinate_system.h"
+#include "../misc/kigtrace.h"
 #include "../objects/bogus_imp.h"
 #include "../objects/object_calcer.h"
 #include "../objects/object_drawer.h"
@@ -20,18 +21,24 @@
 #include <kig_version.h>
 
 #include <algorithm>
+#include <cstring>
 #include <iostream>
-#include <map>
+#include <memory>
+#include <unordered_map>
 #include <vector>
 
-#include <QDebug>
+#include <QBuffer>
+#include <QColor>
 #include <QDomElement>
 #include <QFile>
 #include <QFont>
-#include <QStandardPaths>
-#include <QTextStream>
+#include <QHash>
+#include <QtEndian>
 #include <QRegularExpression>
+#include <QXmlStreamReader>
+#include <QXmlStreamWriter>
 
+#include <KCompressionDevice>
 #include <KTar>
 
 struct HierElem {
@@ -69,6 +76,232 @@ static std::vector<HierElem> sortElems(const std::vector<HierElem> &elems)
     return ret;
 }
 
+/*
+ * read the element at the current position of xml, with all of its
+ * contents, into an element of doc, leaving xml at its end.
+ */
+static QDomElement readDomElement(QXmlStreamReader &xml, QDomDocument &doc)
+{
+    QDomElement e = doc.createElement(xml.name().toString());
+    const QXmlStreamAttributes attrs = xml.attributes();
+    for (const QXmlStreamAttribute &a : attrs)
+        e.setAttribute(a.name().toString(), a.value().toString());
+
+    while (!xml.atEnd()) {
+        xml.readNext();
+        if (xml.isStartElement())
+            e.appendChild(readDomElement(xml, doc));
+        else if (xml.isCharacters() && !xml.isWhitespace())
+            e.appendChild(doc.createTextNode(xml.text().toString()));
+        else if (xml.isEndElement())
+            break;
+    }
+    return e;
+}
+
+/*
+ * Kig's binary native format.  Everything is little-endian, and all
+ * the counts, ids and string indexes are unsigned LEB128 varints:
+ *
+ *   "KIGB" version:u8 flags:varint ( 1 = grid, 2 = axes )
+ *   strings: count, then for each one its length and its utf-8 bytes
+ *   coordinatesystem:string
+ *   calcers: count, then for each one in topological order ( its id is
+ *   its position, plus one ), a kind:u8 and
+ *     BinaryNumbers: type:string count doubles:f64[count]
+ *     BinaryXml: length bytes ( a Data element of the XML format, for
+ *       the ObjectImp's that aren't made of numbers only )
+ *     BinaryProperty: parent:id which:string
+ *     BinaryObject: type:string count parents:id[count]
+ *   holders: count, then for each one
+ *     calcer:id color:u32 ( ARGB ) shown:varint width+1:varint
+ *     style:string pointstyle:string font:string namecalcer:id ( 0: none )
+ *
+ * "string" fields are indexes in the string table.
+ */
+static const char binaryMagic[] = {'K', 'I', 'G', 'B'};
+static const uchar binaryVersion = 1;
+enum { BinaryNumbers = 0, BinaryXml = 1, BinaryProperty = 2, BinaryObject = 3 };
+
+class BinaryWriter
+{
+    QHash<QByteArray, quint64> mstringids;
+    std::vector<QByteArray> mstrings;
+
+public:
+    QByteArray body;
+
+    void u8(uchar c)
+    {
+        body.append(static_cast<char>(c));
+    }
+    void varint(quint64 v)
+    {
+        while (v >= 0x80) {
+            body.append(static_cast<char>((v & 0x7f) | 0x80));
+            v >>= 7;
+        }
+        body.append(static_cast<char>(v));
+    }
+    void u32(quint32 v)
+    {
+        char buf[4];
+        qToLittleEndian(v, buf);
+        body.append(buf, 4);
+    }
+    void f64(double d)
+    {
+        quint64 v;
+        memcpy(&v, &d, 8);
+        char buf[8];
+        qToLittleEndian(v, buf);
+        body.append(buf, 8);
+    }
+    void bytes(const QByteArray &b)
+    {
+        varint(b.size());
+        body.append(b);
+    }
+    void string(const QByteArray &s)
+    {
+        QHash<QByteArray, quint64>::const_iterator i = mstringids.constFind(s);
+        if (i == mstringids.constEnd()) {
+            i = mstringids.insert(s, mstrings.size());
+            mstrings.push_back(s);
+        }
+        varint(i.value());
+    }
+
+    /**
+     * the header and the string table, which go before body.
+     */
+    QByteArray header(quint64 flags)
+    {
+        BinaryWriter h;
+        h.body.append(binaryMagic, 4);
+        h.u8(binaryVersion);
+        h.varint(flags);
+        h.varint(mstrings.size());
+        for (const QByteArray &s : mstrings)
+            h.bytes(s);
+        return h.body;
+    }
+};
+
+class BinaryReader
+{
+    const uchar *mp;
+    const uchar *mend;
+
+public:
+    bool ok;
+    std::vector<QByteArray> strings;
+
+    BinaryReader(const uchar *data, qint64 size)
+        : mp(data)
+        , mend(data + size)
+        , ok(true)
+    {
+    }
+
+    bool has(quint64 n)
+    {
+        if (static_cast<quint64>(mend - mp) < n)
+            ok = false;
+        return ok;
+    }
+    uchar u8()
+    {
+        return has(1) ? *mp++ : 0;
+    }
+    quint64 varint()
+    {
+        quint64 ret = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            uchar c = u8();
+            ret |= quint64(c & 0x7f) << shift;
+            if (!(c & 0x80))
+                return ret;
+        }
+        ok = false;
+        return 0;
+    }
+    quint32 u32()
+    {
+        if (!has(4))
+            return 0;
+        quint32 ret = qFromLittleEndian<quint32>(mp);
+        mp += 4;
+        return ret;
+    }
+    double f64()
+    {
+        if (!has(8))
+            return 0;
+        quint64 v = qFromLittleEndian<quint64>(mp);
+        mp += 8;
+        double d;
+        memcpy(&d, &v, 8);
+        return d;
+    }
+    QByteArray bytes()
+    {
+        quint64 n = varint();
+        if (!has(n))
+            return QByteArray();
+        // the data outlives the reader, so we can avoid the copy
+        QByteArray ret = QByteArray::fromRawData(reinterpret_cast<const char *>(mp), n);
+        mp += n;
+        return ret;
+    }
+    const QByteArray &string()
+    {
+        static const QByteArray none;
+        quint64 i = varint();
+        if (i >= strings.size()) {
+            ok = false;
+            return none;
+        }
+        return strings[i];
+    }
+};
+
+/*
+ * what the binary format needs of a document, see
+ * KigFilterNative::snapshot().  The calcers are in topological order,
+ * and their ids are their positions plus one, like in the file.
+ */
+class KigDocumentSnapshot
+{
+public:
+    enum Kind { Constant, Property, Object };
+    struct Calcer {
+        Kind kind;
+        // the imp of a constant calcer
+        std::unique_ptr<ObjectImp> imp;
+        // the type of an object, or the property of a property calcer
+        QByteArray name;
+        std::vector<quint64> parents;
+    };
+    struct Holder {
+        quint64 calcer;
+        QColor color;
+        bool shown;
+        int width;
+        QString style;
+        QString pointstyle;
+        QFont font;
+        // 0 if the object has no name
+        quint64 namecalcer;
+    };
+
+    bool grid;
+    bool axes;
+    QByteArray coordinatesystem;
+    std::vector<Calcer> calcers;
+    std::vector<Holder> holders;
+};
+
 KigFilterNative::KigFilterNative()
 {
 }
@@ -79,80 +312,72 @@ KigFilterNative::~KigFilterNative()
 
 bool KigFilterNative::supportMime(const QString &mime)
 {
-    return mime == QLatin1String("application/x-kig");
+    return mime == QLatin1String("application/x-kig") || mime == QLatin1String("application/x-kig-binary");
 }
 
 KigDocument *KigFilterNative::load(const QString &file)
 {
+    KigTrace::Span span("load", "KigFilterNative::load", file);
     QFile ffile(file);
     if (!ffile.open(QIODevice::ReadOnly)) {
         fileNotFound(file);
         return nullptr;
     };
 
-    QFile kigdoc(file);
-    bool iscompressed = false;
-    if (!file.endsWith(QLatin1String(".kig"), Qt::CaseInsensitive)) {
-        // the file is compressed, so we have to decompress it and fetch the
-        // kig file inside it...
-        iscompressed = true;
-
-        QString tempdir = QStandardPaths::writableLocation(QStandardPaths::TempLocation);
-        if (tempdir.isEmpty())
-            KIG_FILTER_PARSE_ERROR;
-
-        tempdir += QLatin1Char('/');
-
-        QString tempname = file.section('/', -1);
-        if (file.endsWith(QLatin1String(".kigz"), Qt::CaseInsensitive)) {
-            tempname.remove(QRegularExpression("\\.[Kk][Ii][Gg][Zz]$"));
-        } else
-            KIG_FILTER_PARSE_ERROR;
-        // reading compressed file
-        KTar ark(file, QStringLiteral("application/gzip"));
-        ark.open(QIODevice::ReadOnly);
-        const KArchiveDirectory *dir = ark.directory();
-        //    assert( dir );
-        QStringList entries = dir->entries();
-        QStringList kigfiles = entries.filter(QRegularExpression("\\.kig$"));
-        if (kigfiles.count() != 1)
-            // I throw a generic parse error here, but I should warn the user that
-            // this kig archive file doesn't contain one kig file (it contains no
-            // kig files or more than one).
-            KIG_FILTER_PARSE_ERROR;
-        const KArchiveEntry *kigz = dir->entry(kigfiles.at(0));
-        if (!kigz->isFile())
-            KIG_FILTER_PARSE_ERROR;
-        dynamic_cast<const KArchiveFile *>(kigz)->copyTo(tempdir);
-        qDebug() << "extracted file: " << tempdir + kigz->name() << "exists: " << QFile::exists(tempdir + kigz->name());
+    if (file.endsWith(QLatin1String(".kig"), Qt::CaseInsensitive))
+        return load(ffile);
 
-        kigdoc.setFileName(tempdir + kigz->name());
+    if (file.endsWith(QLatin1String(".kigb"), Qt::CaseInsensitive)) {
+        const qint64 size = ffile.size();
+        const uchar *data = ffile.map(0, size);
+        if (data)
+            return loadBinary(data, size);
+        const QByteArray contents = ffile.readAll();
+        return loadBinary(reinterpret_cast<const uchar *>(contents.constData()), contents.size());
     }
 
-    if (!kigdoc.open(QIODevice::ReadOnly))
+    // the file is compressed, so we have to decompress it and fetch the
+    // kig file inside it.  We read it straight from the decompressed
+    // stream: giving KTar a device instead of a mime type keeps it from
+    // extracting the whole archive to a temporary file first.
+    if (!file.endsWith(QLatin1String(".kigz"), Qt::CaseInsensitive))
         KIG_FILTER_PARSE_ERROR;
-
-    QDomDocument doc(QStringLiteral("KigDocument"));
-    if (!doc.setContent(&kigdoc))
+    ffile.close();
+    KCompressionDevice gzdev(file, KCompressionDevice::GZip);
+    KTar ark(&gzdev);
+    if (!ark.open(QIODevice::ReadOnly))
+        KIG_FILTER_PARSE_ERROR;
+    const KArchiveDirectory *dir = ark.directory();
+    //    assert( dir );
+    QStringList entries = dir->entries();
+    QStringList kigfiles = entries.filter(QRegularExpression("\\.kig$"));
+    if (kigfiles.count() != 1)
+        // I throw a generic parse error here, but I should warn the user that
+        // this kig archive file doesn't contain one kig file (it contains no
+        // kig files or more than one).
+        KIG_FILTER_PARSE_ERROR;
+    const KArchiveEntry *kigz = dir->entry(kigfiles.at(0));
+    if (!kigz->isFile())
+        KIG_FILTER_PARSE_ERROR;
+    std::unique_ptr<QIODevice> kigdoc(static_cast<const KArchiveFile *>(kigz)->createDevice());
+    if (!kigdoc)
         KIG_FILTER_PARSE_ERROR;
-    kigdoc.close();
-
-    // removing temp file
-    if (iscompressed)
-        kigdoc.remove();
 
-    return load(doc);
+    return load(*kigdoc);
 }
 
-KigDocument *KigFilterNative::load(const QDomDocument &doc)
+KigDocument *KigFilterNative::load(QIODevice &device)
 {
-    QDomElement main = doc.documentElement();
+    QXmlStreamReader xml(&device);
+    if (!xml.readNextStartElement())
+        KIG_FILTER_PARSE_ERROR;
 
-    QString version = main.attribute(QStringLiteral("CompatibilityVersion"));
+    const QXmlStreamAttributes attrs = xml.attributes();
+    QString version = attrs.value(QLatin1String("CompatibilityVersion")).toString();
     if (version.isEmpty())
-        version = main.attribute(QStringLiteral("Version"));
+        version = attrs.value(QLatin1String("Version")).toString();
     if (version.isEmpty())
-        version = main.attribute(QStringLiteral("version"));
+        version = attrs.value(QLatin1String("version")).toString();
     if (version.isEmpty())
         KIG_FILTER_PARSE_ERROR;
 
@@ -188,10 +413,17 @@ KigDocument *KigFilterNative::load(const QDomDocument &doc)
                  "new format.",
                  version));
         return nullptr;
-    } else if (major == 0 && minor <= 6)
-        return load04(main);
-    else
-        return load07(main);
+    } else if (major == 0 && minor <= 6) {
+        // the 0.4 format allows the objects in any order, so we need the
+        // whole tree before building anything: parse it again as a DOM
+        if (!device.seek(0))
+            KIG_FILTER_PARSE_ERROR;
+        QDomDocument doc(QStringLiteral("KigDocument"));
+        if (!doc.setContent(&device))
+            KIG_FILTER_PARSE_ERROR;
+        return load04(doc.documentElement());
+    } else
+        return load07(xml);
 }
 
 KigDocument *KigFilterNative::load04(const QDomElement &docelem)
@@ -359,7 +591,7 @@ static const char *obsoletemessage = I18N_NOOP(
     "which is obsolete, you should save the construction with "
     "a different name and check that it works as expected.");
 
-KigDocument *KigFilterNative::load07(const QDomElement &docelem)
+KigDocument *KigFilterNative::load07(QXmlStreamReader &xml)
 {
     KigDocument *ret = new KigDocument();
 
@@ -367,17 +599,26 @@ KigDocument *KigFilterNative::load07(const QDomElement &docelem)
     std::vector<ObjectCalcer::shared_ptr> calcers;
     std::vector<ObjectHolder *> holders;
 
-    QString t = docelem.attribute(QStringLiteral("grid"));
+    // a rough guess of the number of objects, to avoid most of the
+    // reallocations of calcers on big documents
+    if (xml.device() && xml.device()->size() > 0)
+        calcers.reserve(xml.device()->size() / 128);
+
+    const QXmlStreamAttributes docattrs = xml.attributes();
+    QStringView t = docattrs.value(QLatin1String("grid"));
     bool tmphide = (t == QLatin1String("false")) || (t == QLatin1String("no")) || (t == QLatin1String("0"));
     ret->setGrid(!tmphide);
-    t = docelem.attribute(QStringLiteral("axes"));
+    t = docattrs.value(QLatin1String("axes"));
     tmphide = (t == QLatin1String("false")) || (t == QLatin1String("no")) || (t == QLatin1String("0"));
     ret->setAxes(!tmphide);
 
-    for (QDomElement subsectionelement = docelem.firstChild().toElement(); !subsectionelement.isNull();
-         subsectionelement = subsectionelement.nextSibling().toElement()) {
-        if (subsectionelement.tagName() == QLatin1String("CoordinateSystem")) {
-            QString tmptype = subsectionelement.text();
+    // the ObjectImpFactory reads Data elements from a DOM: we only build
+    // one for the Data element being read, in this scratch document
+    QDomDocument scratch;
+
+    while (xml.readNextStartElement()) {
+        if (xml.name() == QLatin1String("CoordinateSystem")) {
+            QString tmptype = xml.readElementText();
             // compatibility code - to support Invisible coord system...
             if (tmptype == QLatin1String("Invisible")) {
                 tmptype = QStringLiteral("Euclidean");
@@ -394,35 +635,45 @@ KigDocument *KigFilterNative::load07(const QDomElement &docelem)
                          "instead."));
             } else
                 ret->setCoordinateSystem(s);
-        } else if (subsectionelement.tagName() == QLatin1String("Hierarchy")) {
-            for (QDomElement e = subsectionelement.firstChild().toElement(); !e.isNull(); e = e.nextSibling().toElement()) {
-                QString tmp = e.attribute(QStringLiteral("id"));
-                uint id = tmp.toInt(&ok);
+        } else if (xml.name() == QLatin1String("Hierarchy")) {
+            while (xml.readNextStartElement()) {
+                const QString tagname = xml.name().toString();
+                const QXmlStreamAttributes attrs = xml.attributes();
+                uint id = attrs.value(QLatin1String("id")).toInt(&ok);
                 if (id <= 0)
                     KIG_FILTER_PARSE_ERROR;
 
+                // the contents of a Data element are for the
+                // ObjectImpFactory, the others only have Parent children
+                QDomElement e;
                 std::vector<ObjectCalcer *> parents;
-                for (QDomElement parentel = e.firstChild().toElement(); !parentel.isNull(); parentel = parentel.nextSibling().toElement()) {
-                    if (parentel.tagName() != QLatin1String("Parent"))
-                        continue;
-                    QString tmp = parentel.attribute(QStringLiteral("id"));
-                    uint parentid = tmp.toInt(&ok);
-                    if (!ok)
+                if (tagname == QLatin1String("Data")) {
+                    e = readDomElement(xml, scratch);
+                    if (!e.firstChildElement(QStringLiteral("Parent")).isNull())
                         KIG_FILTER_PARSE_ERROR;
-                    if (parentid == 0 || parentid > calcers.size())
-                        KIG_FILTER_PARSE_ERROR;
-                    ObjectCalcer *parent = calcers[parentid - 1].get();
-                    if (!parent)
-                        KIG_FILTER_PARSE_ERROR;
-                    parents.push_back(parent);
+                } else {
+                    while (xml.readNextStartElement()) {
+                        if (xml.name() == QLatin1String("Parent")) {
+                            uint parentid = xml.attributes().value(QLatin1String("id")).toInt(&ok);
+                            if (!ok)
+                                KIG_FILTER_PARSE_ERROR;
+                            if (parentid == 0 || parentid > calcers.size())
+                                KIG_FILTER_PARSE_ERROR;
+                            ObjectCalcer *parent = calcers[parentid - 1].get();
+                            if (!parent)
+                                KIG_FILTER_PARSE_ERROR;
+                            parents.push_back(parent);
+                        }
+                        xml.skipCurrentElement();
+                    }
                 }
+                if (xml.hasError())
+                    KIG_FILTER_PARSE_ERROR;
 
                 ObjectCalcer *o = nullptr;
 
-                if (e.tagName() == QLatin1String("Data")) {
-                    if (!parents.empty())
-                        KIG_FILTER_PARSE_ERROR;
-                    QString tmp = e.attribute(QStringLiteral("type"));
+                if (tagname == QLatin1String("Data")) {
+                    QString tmp = attrs.value(QLatin1String("type")).toString();
                     QString error;
                     ObjectImp *imp = ObjectImpFactory::instance()->deserialize(tmp, e, error);
                     if ((!imp) && !error.isEmpty()) {
@@ -430,10 +681,10 @@ KigDocument *KigFilterNative::load07(const QDomElement &docelem)
                         return nullptr;
                     }
                     o = new ObjectConstCalcer(imp);
-                } else if (e.tagName() == QLatin1String("Property")) {
+                } else if (tagname == QLatin1String("Property")) {
                     if (parents.size() != 1)
                         KIG_FILTER_PARSE_ERROR;
-                    QByteArray propname = e.attribute(QStringLiteral("which")).toLatin1();
+                    QByteArray propname = attrs.value(QLatin1String("which")).toLatin1();
 
                     ObjectCalcer *parent = parents[0];
                     int propid = parent->imp()->propertiesInternalNames().indexOf(propname);
@@ -441,8 +692,8 @@ KigDocument *KigFilterNative::load07(const QDomElement &docelem)
                         KIG_FILTER_PARSE_ERROR;
 
                     o = new ObjectPropertyCalcer(parent, propname);
-                } else if (e.tagName() == QLatin1String("Object")) {
-                    QString tmp = e.attribute(QStringLiteral("type"));
+                } else if (tagname == QLatin1String("Object")) {
+                    QString tmp = attrs.value(QLatin1String("type")).toString();
                     const ObjectType *type = ObjectTypeFactory::instance()->find(tmp.toLatin1());
                     if (!type) {
                         if (tmp == QLatin1String("MeasureTransport") && parents.size() == 3) {
@@ -513,45 +764,46 @@ KigDocument *KigFilterNative::load07(const QDomElement &docelem)
                 calcers.resize(id, nullptr);
                 calcers[id - 1] = o;
             }
-        } else if (subsectionelement.tagName() == QLatin1String("View")) {
-            for (QDomElement e = subsectionelement.firstChild().toElement(); !e.isNull(); e = e.nextSibling().toElement()) {
-                if (e.tagName() != QLatin1String("Draw"))
+        } else if (xml.name() == QLatin1String("View")) {
+            while (xml.readNextStartElement()) {
+                if (xml.name() != QLatin1String("Draw"))
                     KIG_FILTER_PARSE_ERROR;
 
-                QString tmp = e.attribute(QStringLiteral("object"));
-                uint id = tmp.toInt(&ok);
+                const QXmlStreamAttributes attrs = xml.attributes();
+                xml.skipCurrentElement();
+
+                uint id = attrs.value(QLatin1String("object")).toInt(&ok);
                 if (!ok)
                     KIG_FILTER_PARSE_ERROR;
                 if (id <= 0 || id > calcers.size())
                     KIG_FILTER_PARSE_ERROR;
                 ObjectCalcer *calcer = calcers[id - 1].get();
 
-                tmp = e.attribute(QStringLiteral("color"));
+                QString tmp = attrs.value(QLatin1String("color")).toString();
                 QColor color(tmp);
                 if (!color.isValid())
                     KIG_FILTER_PARSE_ERROR;
 
-                tmp = e.attribute(QStringLiteral("shown"));
+                tmp = attrs.value(QLatin1String("shown")).toString();
                 bool shown = !(tmp == QLatin1String("false") || tmp == QLatin1String("no"));
 
-                tmp = e.attribute(QStringLiteral("width"));
-                int width = tmp.toInt(&ok);
+                int width = attrs.value(QLatin1String("width")).toInt(&ok);
                 if (!ok)
                     width = -1;
 
-                tmp = e.attribute(QStringLiteral("style"));
+                tmp = attrs.value(QLatin1String("style")).toString();
                 Qt::PenStyle style = ObjectDrawer::styleFromString(tmp);
 
-                tmp = e.attribute(QStringLiteral("point-style"));
+                tmp = attrs.value(QLatin1String("point-style")).toString();
                 Kig::PointStyle pointstyle = Kig::pointStyleFromString(tmp);
 
-                tmp = e.attribute(QStringLiteral("font"));
+                tmp = attrs.value(QLatin1String("font")).toString();
                 QFont f;
                 if (!tmp.isEmpty())
                     f.fromString(tmp);
 
                 ObjectConstCalcer *namecalcer = nullptr;
-                tmp = e.attribute(QStringLiteral("namecalcer"));
+                tmp = attrs.value(QLatin1String("namecalcer")).toString();
                 if (tmp != QLatin1String("none") && !tmp.isEmpty()) {
                     int ncid = tmp.toInt(&ok);
                     if (!ok)
@@ -566,111 +818,405 @@ KigDocument *KigFilterNative::load07(const QDomElement &docelem)
                 ObjectDrawer *drawer = new ObjectDrawer(color, width, shown, style, pointstyle, f);
                 holders.push_back(new ObjectHolder(calcer, drawer, namecalcer));
             }
-        }
+        } else
+            xml.skipCurrentElement(); // be forward-compatible..
     }
+    if (xml.hasError())
+        KIG_FILTER_PARSE_ERROR;
 
     ret->addObjects(holders);
     return ret;
 }
 
-bool KigFilterNative::save07(const KigDocument &kdoc, QTextStream &stream)
+bool KigFilterNative::save07(const KigDocument &kdoc, QIODevice &device)
 {
-    QDomDocument doc(QStringLiteral("KigDocument"));
+    QXmlStreamWriter xml(&device);
+    xml.setAutoFormatting(true);
+    xml.setAutoFormattingIndent(1);
 
-    QDomProcessingInstruction xmlpi = doc.createProcessingInstruction(QStringLiteral("xml"), QStringLiteral("version=\"1.0\" encoding=\"utf-8\""));
-    doc.appendChild(xmlpi);
+    xml.writeStartDocument();
+    xml.writeDTD(QStringLiteral("<!DOCTYPE KigDocument>"));
 
-    QDomElement docelem = doc.createElement(QStringLiteral("KigDocument"));
-    docelem.setAttribute(QStringLiteral("Version"), KIG_VERSION_STRING);
-    docelem.setAttribute(QStringLiteral("CompatibilityVersion"), QStringLiteral("0.7.0"));
-    docelem.setAttribute(QStringLiteral("grid"), kdoc.grid());
-    docelem.setAttribute(QStringLiteral("axes"), kdoc.axes());
+    xml.writeStartElement(QStringLiteral("KigDocument"));
+    xml.writeAttribute(QStringLiteral("Version"), QLatin1String(KIG_VERSION_STRING));
+    xml.writeAttribute(QStringLiteral("CompatibilityVersion"), QStringLiteral("0.7.0"));
+    xml.writeAttribute(QStringLiteral("grid"), QString::number(kdoc.grid()));
+    xml.writeAttribute(QStringLiteral("axes"), QString::number(kdoc.axes()));
 
-    QDomElement cselem = doc.createElement(QStringLiteral("CoordinateSystem"));
-    cselem.appendChild(doc.createTextNode(kdoc.coordinateSystem().type()));
-    docelem.appendChild(cselem);
+    xml.writeTextElement(QStringLiteral("CoordinateSystem"), QLatin1String(kdoc.coordinateSystem().type()));
 
-    std::vector<ObjectHolder *> holders = kdoc.objects();
+    const std::vector<ObjectHolder *> &holders = kdoc.objects();
     std::vector<ObjectCalcer *> calcers = getAllParents(getAllCalcers(holders));
     calcers = calcPath(calcers);
 
-    QDomElement hierelem = doc.createElement(QStringLiteral("Hierarchy"));
-    std::map<const ObjectCalcer *, int> idmap;
+    // the ids are simply the positions in calcers, plus one
+    std::unordered_map<const ObjectCalcer *, int> idmap;
+    idmap.reserve(calcers.size());
     for (std::vector<ObjectCalcer *>::const_iterator i = calcers.begin(); i != calcers.end(); ++i)
-        idmap[*i] = (i - calcers.begin()) + 1;
+        idmap.emplace(*i, (i - calcers.begin()) + 1);
     int id = 1;
 
+    xml.writeStartElement(QStringLiteral("Hierarchy"));
     for (std::vector<ObjectCalcer *>::const_iterator i = calcers.begin(); i != calcers.end(); ++i) {
-        QDomElement objectelem;
         if (dynamic_cast<ObjectConstCalcer *>(*i)) {
-            objectelem = doc.createElement(QStringLiteral("Data"));
-            QString ser = ObjectImpFactory::instance()->serialize(*(*i)->imp(), objectelem, doc);
-            objectelem.setAttribute(QStringLiteral("type"), ser);
+            xml.writeStartElement(QStringLiteral("Data"));
+            xml.writeAttribute(QStringLiteral("id"), QString::number(id++));
+            ObjectImpFactory::instance()->serialize(*(*i)->imp(), xml);
         } else if (dynamic_cast<const ObjectPropertyCalcer *>(*i)) {
             const ObjectPropertyCalcer *o = static_cast<const ObjectPropertyCalcer *>(*i);
-            objectelem = doc.createElement(QStringLiteral("Property"));
+            xml.writeStartElement(QStringLiteral("Property"));
+            xml.writeAttribute(QStringLiteral("id"), QString::number(id++));
 
             QByteArray propname = o->parent()->imp()->getPropName(o->propGid());
-            objectelem.setAttribute(QStringLiteral("which"), QString(propname));
+            xml.writeAttribute(QStringLiteral("which"), QString(propname));
         } else if (dynamic_cast<const ObjectTypeCalcer *>(*i)) {
             const ObjectTypeCalcer *o = static_cast<const ObjectTypeCalcer *>(*i);
-            objectelem = doc.createElement(QStringLiteral("Object"));
-            objectelem.setAttribute(QStringLiteral("type"), o->type()->fullName());
+            xml.writeStartElement(QStringLiteral("Object"));
+            xml.writeAttribute(QStringLiteral("id"), QString::number(id++));
+            xml.writeAttribute(QStringLiteral("type"), QLatin1String(o->type()->fullName()));
         } else
             assert(false);
 
         const std::vector<ObjectCalcer *> parents = (*i)->parents();
         for (std::vector<ObjectCalcer *>::const_iterator i = parents.begin(); i != parents.end(); ++i) {
-            std::map<const ObjectCalcer *, int>::const_iterator idp = idmap.find(*i);
+            std::unordered_map<const ObjectCalcer *, int>::const_iterator idp = idmap.find(*i);
             assert(idp != idmap.end());
             int pid = idp->second;
-            QDomElement pel = doc.createElement(QStringLiteral("Parent"));
-            pel.setAttribute(QStringLiteral("id"), pid);
-            objectelem.appendChild(pel);
+            xml.writeEmptyElement(QStringLiteral("Parent"));
+            xml.writeAttribute(QStringLiteral("id"), QString::number(pid));
         }
 
-        objectelem.setAttribute(QStringLiteral("id"), id++);
-        hierelem.appendChild(objectelem);
+        xml.writeEndElement();
     }
-    docelem.appendChild(hierelem);
+    xml.writeEndElement();
 
-    QDomElement windowelem = doc.createElement(QStringLiteral("View"));
-    for (std::vector<ObjectHolder *>::iterator i = holders.begin(); i != holders.end(); ++i) {
-        std::map<const ObjectCalcer *, int>::const_iterator idp = idmap.find((*i)->calcer());
+    xml.writeStartElement(QStringLiteral("View"));
+    for (std::vector<ObjectHolder *>::const_iterator i = holders.begin(); i != holders.end(); ++i) {
+        std::unordered_map<const ObjectCalcer *, int>::const_iterator idp = idmap.find((*i)->calcer());
         assert(idp != idmap.end());
         int id = idp->second;
 
         const ObjectDrawer *d = (*i)->drawer();
-        QDomElement drawelem = doc.createElement(QStringLiteral("Draw"));
-        drawelem.setAttribute(QStringLiteral("object"), id);
-        drawelem.setAttribute(QStringLiteral("color"), d->color().name());
-        drawelem.setAttribute(QStringLiteral("shown"), QLatin1String(d->shown() ? "true" : "false"));
-        drawelem.setAttribute(QStringLiteral("width"), QString::number(d->width()));
-        drawelem.setAttribute(QStringLiteral("style"), d->styleToString());
-        drawelem.setAttribute(QStringLiteral("point-style"), Kig::pointStyleToString(d->pointStyle()));
-        drawelem.setAttribute(QStringLiteral("font"), d->font().toString());
+        xml.writeEmptyElement(QStringLiteral("Draw"));
+        xml.writeAttribute(QStringLiteral("object"), QString::number(id));
+        xml.writeAttribute(QStringLiteral("color"), d->color().name());
+        xml.writeAttribute(QStringLiteral("shown"), QLatin1String(d->shown() ? "true" : "false"));
+        xml.writeAttribute(QStringLiteral("width"), QString::number(d->width()));
+        xml.writeAttribute(QStringLiteral("style"), d->styleToString());
+        xml.writeAttribute(QStringLiteral("point-style"), Kig::pointStyleToString(d->pointStyle()));
+        xml.writeAttribute(QStringLiteral("font"), d->font().toString());
 
         ObjectCalcer *namecalcer = (*i)->nameCalcer();
         if (namecalcer) {
-            std::map<const ObjectCalcer *, int>::const_iterator ncp = idmap.find(namecalcer);
+            std::unordered_map<const ObjectCalcer *, int>::const_iterator ncp = idmap.find(namecalcer);
             assert(ncp != idmap.end());
             int ncid = ncp->second;
-            drawelem.setAttribute(QStringLiteral("namecalcer"), ncid);
+            xml.writeAttribute(QStringLiteral("namecalcer"), QString::number(ncid));
+        } else {
+            xml.writeAttribute(QStringLiteral("namecalcer"), QStringLiteral("none"));
+        }
+    };
+    xml.writeEndElement();
+
+    xml.writeEndElement();
+    xml.writeEndDocument();
+    return !xml.hasError();
+}
+
+KigDocument *KigFilterNative::loadBinary(const uchar *data, qint64 size)
+{
+    BinaryReader in(data, size);
+    if (!in.has(5) || memcmp(data, binaryMagic, 4) != 0)
+        KIG_FILTER_PARSE_ERROR;
+    in.u32();
+    if (in.u8() != binaryVersion) {
+        notSupported(i18n("This binary Kig file was created by a newer Kig version, which this version cannot open."));
+        return nullptr;
+    }
+
+    KigDocument *ret = new KigDocument();
+    const quint64 flags = in.varint();
+    ret->setGrid(flags & 1);
+    ret->setAxes(flags & 2);
+
+    quint64 count = in.varint();
+    if (!in.has(count))
+        KIG_FILTER_PARSE_ERROR;
+    in.strings.reserve(count);
+    for (quint64 i = 0; i < count && in.ok; ++i) {
+        // a deep copy, the names are used as nul terminated strings
+        const QByteArray b = in.bytes();
+        in.strings.push_back(QByteArray(b.constData(), b.size()));
+    }
+
+    CoordinateSystem *s = CoordinateSystemFactory::build(in.string().constData());
+    if (!s) {
+        warning(
+            i18n("This Kig file has a coordinate system "
+                 "that this Kig version does not support.\n"
+                 "A standard coordinate system will be used "
+                 "instead."));
+    } else
+        ret->setCoordinateSystem(s);
+
+    count = in.varint();
+    if (!in.has(count))
+        KIG_FILTER_PARSE_ERROR;
+    std::vector<ObjectCalcer::shared_ptr> calcers;
+    calcers.reserve(count);
+    std::vector<double> numbers;
+    std::vector<ObjectCalcer *> parents;
+    for (quint64 i = 0; i < count && in.ok; ++i) {
+        ObjectCalcer *o = nullptr;
+        const uchar kind = in.u8();
+        if (kind == BinaryNumbers) {
+            const QString type = QString::fromLatin1(in.string());
+            quint64 n = in.varint();
+            if (n > static_cast<quint64>(size) / 8 || !in.has(8 * n))
+                KIG_FILTER_PARSE_ERROR;
+            numbers.resize(n);
+            for (quint64 j = 0; j < n; ++j)
+                numbers[j] = in.f64();
+            ObjectImp *imp = ObjectImpFactory::instance()->deserialize(type, numbers.data(), n);
+            if (!imp)
+                KIG_FILTER_PARSE_ERROR;
+            o = new ObjectConstCalcer(imp);
+        } else if (kind == BinaryXml) {
+            QDomDocument doc;
+            if (!doc.setContent(in.bytes()))
+                KIG_FILTER_PARSE_ERROR;
+            QDomElement e = doc.documentElement();
+            QString error;
+            ObjectImp *imp = ObjectImpFactory::instance()->deserialize(e.attribute(QStringLiteral("type")), e, error);
+            if (!imp) {
+                parseError(error);
+                return nullptr;
+            }
+            o = new ObjectConstCalcer(imp);
+        } else if (kind == BinaryProperty) {
+            quint64 parentid = in.varint();
+            const QByteArray &propname = in.string();
+            if (parentid == 0 || parentid > calcers.size())
+                KIG_FILTER_PARSE_ERROR;
+            ObjectCalcer *parent = calcers[parentid - 1].get();
+            if (parent->imp()->propertiesInternalNames().indexOf(propname) == -1)
+                KIG_FILTER_PARSE_ERROR;
+            o = new ObjectPropertyCalcer(parent, propname.constData());
+        } else if (kind == BinaryObject) {
+            const QByteArray &typename_ = in.string();
+            const ObjectType *type = ObjectTypeFactory::instance()->find(typename_.constData());
+            if (!type) {
+                notSupported(
+                    i18n("This Kig file uses an object of type \"%1\", "
+                         "which this Kig version does not support."
+                         "Perhaps you have compiled Kig without support "
+                         "for this object type,"
+                         "or perhaps you are using an older Kig version.",
+                         QString::fromLatin1(typename_)));
+                return nullptr;
+            }
+            quint64 n = in.varint();
+            if (!in.has(n))
+                KIG_FILTER_PARSE_ERROR;
+            parents.clear();
+            for (quint64 j = 0; j < n; ++j) {
+                quint64 parentid = in.varint();
+                if (parentid == 0 || parentid > calcers.size())
+                    KIG_FILTER_PARSE_ERROR;
+                parents.push_back(calcers[parentid - 1].get());
+            }
+            // don't sort the arguments, see load07()
+            o = new ObjectTypeCalcer(type, parents, false);
+        } else
+            KIG_FILTER_PARSE_ERROR;
+
+        o->calc(*ret);
+        calcers.push_back(o);
+    }
+
+    count = in.varint();
+    if (!in.ok)
+        KIG_FILTER_PARSE_ERROR;
+    std::vector<ObjectHolder *> holders;
+    holders.reserve(std::min<quint64>(count, calcers.size()));
+    for (quint64 i = 0; i < count && in.ok; ++i) {
+        quint64 id = in.varint();
+        QColor color = QColor::fromRgba(in.u32());
+        bool shown = in.varint() != 0;
+        int width = static_cast<int>(in.varint()) - 1;
+        Qt::PenStyle style = ObjectDrawer::styleFromString(QString::fromLatin1(in.string()));
+        Kig::PointStyle pointstyle = Kig::pointStyleFromString(QString::fromLatin1(in.string()));
+        QFont f;
+        const QByteArray &font = in.string();
+        if (!font.isEmpty())
+            f.fromString(QString::fromUtf8(font));
+        quint64 ncid = in.varint();
+        if (!in.ok || id == 0 || id > calcers.size() || ncid > calcers.size())
+            KIG_FILTER_PARSE_ERROR;
+
+        ObjectConstCalcer *namecalcer = nullptr;
+        if (ncid != 0) {
+            namecalcer = dynamic_cast<ObjectConstCalcer *>(calcers[ncid - 1].get());
+            if (!namecalcer)
+                KIG_FILTER_PARSE_ERROR;
+        }
+
+        ObjectDrawer *drawer = new ObjectDrawer(color, width, shown, style, pointstyle, f);
+        holders.push_back(new ObjectHolder(calcers[id - 1].get(), drawer, namecalcer));
+    }
+    if (!in.ok)
+        KIG_FILTER_PARSE_ERROR;
+
+    ret->addObjects(holders);
+    return ret;
+}
+
+bool KigFilterNative::saveBinary(const KigDocumentSnapshot &data, QIODevice &device)
+{
+    BinaryWriter out;
+
+    out.string(data.coordinatesystem);
+
+    out.varint(data.calcers.size());
+    std::vector<double> numbers;
+    for (const KigDocumentSnapshot::Calcer &c : data.calcers) {
+        if (c.kind == KigDocumentSnapshot::Constant) {
+            QString type = ObjectImpFactory::instance()->serialize(*c.imp, numbers);
+            if (!type.isEmpty()) {
+                out.u8(BinaryNumbers);
+                out.string(type.toLatin1());
+                out.varint(numbers.size());
+                for (double d : numbers)
+                    out.f64(d);
+            } else {
+                QByteArray xmldata;
+                QXmlStreamWriter xml(&xmldata);
+                xml.writeStartElement(QStringLiteral("Data"));
+                ObjectImpFactory::instance()->serialize(*c.imp, xml);
+                xml.writeEndElement();
+                out.u8(BinaryXml);
+                out.bytes(xmldata);
+            }
+        } else if (c.kind == KigDocumentSnapshot::Property) {
+            out.u8(BinaryProperty);
+            out.varint(c.parents[0]);
+            out.string(c.name);
         } else {
-            drawelem.setAttribute(QStringLiteral("namecalcer"), QStringLiteral("none"));
+            out.u8(BinaryObject);
+            out.string(c.name);
+            out.varint(c.parents.size());
+            for (quint64 p : c.parents)
+                out.varint(p);
         }
+    }
 
-        windowelem.appendChild(drawelem);
+    out.varint(data.holders.size());
+    for (const KigDocumentSnapshot::Holder &h : data.holders) {
+        out.varint(h.calcer);
+        out.u32(h.color.rgba());
+        out.varint(h.shown ? 1 : 0);
+        out.varint(h.width + 1);
+        out.string(h.style.toLatin1());
+        out.string(h.pointstyle.toLatin1());
+        out.string(h.font.toString().toUtf8());
+        out.varint(h.namecalcer);
+    }
+
+    const quint64 flags = (data.grid ? 1 : 0) | (data.axes ? 2 : 0);
+    const QByteArray header = out.header(flags);
+    return device.write(header) == header.size() && device.write(out.body) == out.body.size();
+}
+
+std::shared_ptr<const KigDocumentSnapshot> KigFilterNative::snapshot(const KigDocument &kdoc)
+{
+    KigTrace::Span span("save", "KigFilterNative::snapshot");
+    std::shared_ptr<KigDocumentSnapshot> ret = std::make_shared<KigDocumentSnapshot>();
+    ret->grid = kdoc.grid();
+    ret->axes = kdoc.axes();
+    ret->coordinatesystem = kdoc.coordinateSystem().type();
+
+    // the calcers are numbered in the post-order of a depth first search
+    // from the objects, which puts the parents before their children
+    // without the cost of calcPath().  The search is iterative, chains
+    // of calcers can be much deeper than the stack.
+    std::unordered_map<const ObjectCalcer *, quint64> idmap;
+    std::vector<std::pair<const ObjectCalcer *, std::size_t>> stack;
+    auto addCalcer = [&](const ObjectCalcer *root) -> quint64 {
+        if (idmap.find(root) == idmap.end())
+            stack.emplace_back(root, 0);
+        while (!stack.empty()) {
+            const ObjectCalcer *o = stack.back().first;
+            const std::span<ObjectCalcer *const> parents = o->parentsView();
+            if (stack.back().second < parents.size()) {
+                const ObjectCalcer *p = parents[stack.back().second++];
+                if (idmap.find(p) == idmap.end())
+                    stack.emplace_back(p, 0);
+                continue;
+            }
+            stack.pop_back();
+            if (idmap.find(o) != idmap.end())
+                continue;
+
+            KigDocumentSnapshot::Calcer c;
+            if (dynamic_cast<const ObjectConstCalcer *>(o)) {
+                c.kind = KigDocumentSnapshot::Constant;
+                c.imp.reset(o->imp()->copy());
+            } else if (const ObjectPropertyCalcer *prop = dynamic_cast<const ObjectPropertyCalcer *>(o)) {
+                c.kind = KigDocumentSnapshot::Property;
+                c.name = prop->parent()->imp()->getPropName(prop->propGid());
+            } else if (const ObjectTypeCalcer *obj = dynamic_cast<const ObjectTypeCalcer *>(o)) {
+                c.kind = KigDocumentSnapshot::Object;
+                // the type names are static
+                c.name = QByteArray::fromRawData(obj->type()->fullName(), qstrlen(obj->type()->fullName()));
+            } else
+                assert(false);
+            c.parents.reserve(parents.size());
+            for (ObjectCalcer *p : parents)
+                c.parents.push_back(idmap.at(p));
+            ret->calcers.push_back(std::move(c));
+            idmap.emplace(o, ret->calcers.size());
+        }
+        return idmap.at(root);
     };
-    docelem.appendChild(windowelem);
 
-    doc.appendChild(docelem);
-    stream << doc.toString();
-    return true;
+    const std::vector<ObjectHolder *> &holders = kdoc.objects();
+    ret->holders.reserve(holders.size());
+    for (const ObjectHolder *o : holders) {
+        const ObjectDrawer *d = o->drawer();
+        KigDocumentSnapshot::Holder h;
+        h.calcer = addCalcer(o->calcer());
+        h.color = d->color();
+        h.shown = d->shown();
+        h.width = d->width();
+        h.style = d->styleToString();
+        h.pointstyle = Kig::pointStyleToString(d->pointStyle());
+        h.font = d->font();
+        h.namecalcer = o->nameCalcer() ? addCalcer(o->nameCalcer()) : 0;
+        ret->holders.push_back(h);
+    }
+    return ret;
+}
+
+QByteArray KigFilterNative::serialize(const KigDocumentSnapshot &data)
+{
+    KigTrace::Span span("save", "KigFilterNative::serialize");
+    QBuffer buffer;
+    buffer.open(QIODevice::WriteOnly);
+    saveBinary(data, buffer);
+    return buffer.data();
 }
 
 bool KigFilterNative::save(const KigDocument &data, const QString &file)
 {
+    KigTrace::Span span("save", "KigFilterNative::save", file);
+    if (file.endsWith(QLatin1String(".kigb"), Qt::CaseInsensitive)) {
+        QFile f(file);
+        if (!f.open(QIODevice::WriteOnly)) {
+            fileNotFound(file);
+            return false;
+        }
+        return saveBinary(*snapshot(data), f);
+    }
     return save07(data, file);
 }
 
@@ -678,55 +1224,43 @@ bool KigFilterNative::save07(const KigDocument &data, const QString &outfile)
 {
     // we have an empty outfile, so we have to print all to stdout
     if (outfile.isEmpty()) {
-        QTextStream stdoutstream(stdout, QIODevice::WriteOnly);
-        stream.setEncoding(QStringConverter::Utf8);
-        return save07(data, stdoutstream);
+        QFile stdoutfile;
+        if (!stdoutfile.open(stdout, QIODevice::WriteOnly))
+            return false;
+        return save07(data, stdoutfile);
     }
     if (!outfile.endsWith(QLatin1String(".kig"), Qt::CaseInsensitive)) {
-        // the user wants to save a compressed file, so we have to save our kig
-        // file to a temp file and then compress it...
-
-        QString tempdir = QStandardPaths::writableLocation(QStandardPaths::TempLocation);
-        if (tempdir.isEmpty())
-            return false;
-
+        // the user wants to save a compressed file.  A tar header needs
+        // the size of the file, so we write our kig file to memory and
+        // then compress it straight into the archive...
         QString tempname = outfile.section('/', -1);
         if (outfile.endsWith(QLatin1String(".kigz"), Qt::CaseInsensitive))
             tempname.remove(QRegularExpression("\\.[Kk][Ii][Gg][Zz]$"));
         else
             return false;
 
-        const QString tmpfile = tempdir + QLatin1Char('/') + tempname + ".kig";
-        QFile ftmpfile(tmpfile);
-        if (!ftmpfile.open(QIODevice::WriteOnly))
-            return false;
-        QTextStream stream(&ftmpfile);
-        // stream.setEncoding();
-        if (!save07(data, stream))
+        QBuffer buffer;
+        buffer.open(QIODevice::WriteOnly);
+        if (!save07(data, buffer))
             return false;
-        ftmpfile.close();
-
-        qDebug() << "tmp saved file: " << tmpfile;
+        buffer.close();
 
         // creating the archive and adding our file
-        KTar ark(outfile, QStringLiteral("application/gzip"));
-        ark.open(QIODevice::WriteOnly);
-        ark.addLocalFile(tmpfile, tempname + ".kig");
-        ark.close();
-
-        // finally, removing temp file
-        QFile::remove(tmpfile);
-
-        return true;
+        KCompressionDevice gzdev(outfile, KCompressionDevice::GZip);
+        KTar ark(&gzdev);
+        if (!ark.open(QIODevice::WriteOnly)) {
+            fileNotFound(outfile);
+            return false;
+        }
+        bool ok = ark.writeFile(tempname + ".kig", buffer.data());
+        return ark.close() && ok;
     } else {
         QFile file(outfile);
         if (!file.open(QIODevice::WriteOnly)) {
             fileNotFound(outfile);
             return false;
         }
-        QTextStream stream(&file);
-        stream.setEncoding(QStringConverter::Utf8);
-        return save07(data, stream);
+        return save07(data, file);
     }
 
     // we should never reach this point...
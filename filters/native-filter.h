@@ -6,11 +6,15 @@
 
 #include "filter.h"
 
+#include <memory>
+
+class KigDocumentSnapshot;
+class QByteArray;
 class QDomElement;
-class QDomDocument;
+class QIODevice;
 class KigDocument;
-class QTextStream;
 class QString;
+class QXmlStreamReader;
 
 /**
  * Kig's native format.  Between versions 0.3.1 and 0.4, there was a
@@ -27,15 +31,24 @@ private:
     KigDocument *load04(const QDomElement &doc);
     /**
      * this is the load function for the Kig format that is used
-     * starting at Kig 0.7
+     * starting at Kig 0.7.  It builds the objects while the file is
+     * being read, xml should be positioned on the document element.
      */
-    KigDocument *load07(const QDomElement &doc);
+    KigDocument *load07(QXmlStreamReader &xml);
 
     /**
      * save in the Kig format that is used starting at Kig 0.7
      */
     bool save07(const KigDocument &data, const QString &outfile);
-    bool save07(const KigDocument &data, QTextStream &file);
+    bool save07(const KigDocument &data, QIODevice &device);
+
+    /**
+     * load and save Kig's binary format ( the .kigb files ), a compact
+     * equivalent of the 0.7 format that can be loaded without parsing
+     * any text.  The format is described in native-filter.cc
+     */
+    KigDocument *loadBinary(const uchar *data, qint64 size);
+    bool saveBinary(const KigDocumentSnapshot &data, QIODevice &device);
 
     KigFilterNative();
     ~KigFilterNative();
@@ -45,8 +58,25 @@ public:
 
     bool supportMime(const QString &mime) override;
     KigDocument *load(const QString &file) override;
-    KigDocument *load(const QDomDocument &doc);
+    /**
+     * load a Kig document from the ( already open ) device.  Only the
+     * pre-0.7 formats need the device to be seekable.
+     */
+    KigDocument *load(QIODevice &device);
 
     bool save(const KigDocument &data, const QString &file);
+    /**
+     * return a copy of what saving the document in the binary format
+     * needs: its settings, the drawers, the graph of calcers and the
+     * imps of the constant ones.  Taking it is cheap, and it doesn't
+     * refer to the document anymore, so it can be serialized on another
+     * thread while the document is being changed.
+     */
+    std::shared_ptr<const KigDocumentSnapshot> snapshot(const KigDocument &data);
+    /**
+     * return the snapshot in the binary format.  This can be called on
+     * any thread.
+     */
+    QByteArray serialize(const KigDocumentSnapshot &data);
     //  bool save( const KigDocument& data, QTextStream& stream );
 };
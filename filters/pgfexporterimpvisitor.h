@@ -117,4 +117,9 @@ private:
      * Plots a generic curve through its points calculated with getPoint.
      */
     void plotGenericCurve(const CurveImp *imp);
+
+    /**
+     * Plots a set of polylines, one path for each of them.
+     */
+    void plotCoordinateLists(const std::vector<std::vector<Coordinate>> &coordlist);
 };
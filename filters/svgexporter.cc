@@ -4,6 +4,7 @@
 
 #include "svgexporter.h"
 
+#include "svgexporterimpvisitor.h"
 #include "svgexporteroptions.h"
 
 #include "../kig/kig_document.h"
@@ -15,9 +16,12 @@
 
 #include <map>
 
+#include <QBuffer>
 #include <QFile>
 #include <QStandardPaths>
 #include <QSvgGenerator>
+#include <QXmlStreamReader>
+#include <QXmlStreamWriter>
 
 #include <KMessageBox>
 
@@ -51,12 +55,14 @@ void SVGExporter::run(const KigPart &part, KigWidget &w)
     kfd->setOptionsWidget(opts);
     opts->setGrid(part.document().grid());
     opts->setAxes(part.document().axes());
+    opts->setPrecision(2);
     if (!kfd->exec())
         return;
 
     QString file_name = kfd->selectedFile();
     bool showgrid = opts->showGrid();
     bool showaxes = opts->showAxes();
+    int precision = opts->precision();
 
     delete opts;
     delete kfd;
@@ -72,25 +78,65 @@ void SVGExporter::run(const KigPart &part, KigWidget &w)
 
     QRect viewrect(w.screenInfo().viewRect());
     QRect r(0, 0, viewrect.width(), viewrect.height());
+    const QString svgns = QStringLiteral("http://www.w3.org/2000/svg");
+
+    QXmlStreamWriter xml(&file);
+    xml.setAutoFormatting(true);
+    xml.setAutoFormattingIndent(1);
+    xml.writeStartDocument();
+    xml.writeStartElement(QStringLiteral("svg"));
+    xml.writeDefaultNamespace(svgns);
+    xml.writeAttribute(QStringLiteral("version"), QStringLiteral("1.1"));
+    xml.writeAttribute(QStringLiteral("width"), QString::number(r.width()));
+    xml.writeAttribute(QStringLiteral("height"), QString::number(r.height()));
+    xml.writeAttribute(QStringLiteral("viewBox"), QStringLiteral("0 0 %1 %2").arg(r.width()).arg(r.height()));
+
+    if (showgrid || showaxes) {
+        // the grid and the axes are drawn by the coordinate system, so
+        // we let KigPainter draw them into a QSvgGenerator, and copy its
+        // elements over..
+        QBuffer grid;
+        grid.open(QIODevice::WriteOnly);
+        QSvgGenerator pic;
+        pic.setOutputDevice(&grid);
+        pic.setSize(r.size());
+        pic.setViewBox(r);
+        KigPainter *p = new KigPainter(ScreenInfo(w.screenInfo().shownRect(), viewrect), &pic, part.document(), false);
+        p->drawGrid(part.document().coordinateSystem(), showgrid, showaxes);
+        delete p;
+
+        QXmlStreamReader reader(grid.data());
+        int depth = 0;
+        int skipdepth = 0;
+        while (!reader.atEnd()) {
+            reader.readNext();
+            if (reader.isStartElement()) {
+                ++depth;
+                if (depth == 2 && !skipdepth && (reader.name() == QLatin1String("title") || reader.name() == QLatin1String("desc")))
+                    skipdepth = depth;
+                if (depth > 1 && !skipdepth)
+                    xml.writeCurrentToken(reader);
+            } else if (reader.isEndElement()) {
+                if (depth > 1 && !skipdepth)
+                    xml.writeCurrentToken(reader);
+                if (depth == skipdepth)
+                    skipdepth = 0;
+                --depth;
+            } else if (depth > 1 && !skipdepth && reader.isCharacters() && !reader.isWhitespace())
+                xml.writeCurrentToken(reader);
+        }
+    }
 
-    // workaround for QSvgGenerator bug not checking for already open device
-    file.close();
-    QSvgGenerator pic;
-    pic.setOutputDevice(&file);
-    pic.setSize(r.size());
-    KigPainter *p = new KigPainter(ScreenInfo(w.screenInfo().shownRect(), viewrect), &pic, part.document());
-    //  p->setWholeWinOverlay();
-    //  p->setBrushColor( Qt::white );
-    //  p->setBrushStyle( Qt::SolidPattern );
-    //  p->drawRect( r );
-    //  p->setBrushStyle( Qt::NoBrush );
-    //  p->setWholeWinOverlay();
-    p->drawGrid(part.document().coordinateSystem(), showgrid, showaxes);
-    p->drawObjects(part.document().objects(), false);
-
-    delete p;
-
-    if (!file.flush()) {
+    SVGExporterImpVisitor visitor(xml, w, precision);
+    const std::vector<ObjectHolder *> &os = part.document().objects();
+    for (std::vector<ObjectHolder *>::const_iterator i = os.begin(); i != os.end(); ++i)
+        visitor.visit(*i);
+    visitor.finish();
+
+    xml.writeEndElement();
+    xml.writeEndDocument();
+
+    if (xml.hasError() || !file.flush()) {
         KMessageBox::error(&w, i18n("Sorry, something went wrong while saving to SVG file \"%1\"", file_name));
     }
     file.close();
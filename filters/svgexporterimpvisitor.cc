@@ -0,0 +1,548 @@
+// SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include "svgexporterimpvisitor.h"
+
+#include "../kig/kig_document.h"
+#include "../kig/kig_view.h"
+#include "../misc/common.h"
+#include "../misc/conic-common.h"
+#include "../misc/cubic-common.h"
+#include "../misc/goniometry.h"
+#include "../objects/bezier_imp.h"
+#include "../objects/circle_imp.h"
+#include "../objects/conic_imp.h"
+#include "../objects/cubic_imp.h"
+#include "../objects/line_imp.h"
+#include "../objects/locus_imp.h"
+#include "../objects/object_drawer.h"
+#include "../objects/object_holder.h"
+#include "../objects/other_imp.h"
+#include "../objects/point_imp.h"
+#include "../objects/polygon_imp.h"
+#include "../objects/text_imp.h"
+
+#include <QFontInfo>
+#include <QFontMetricsF>
+#include <QStringList>
+#include <QXmlStreamWriter>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+bool SVGExporterImpVisitor::Style::operator==(const Style &rhs) const
+{
+    return stroke == rhs.stroke && width == rhs.width && penstyle == rhs.penstyle && fill == rhs.fill;
+}
+
+SVGExporterImpVisitor::SVGExporterImpVisitor(QXmlStreamWriter &xml, const KigWidget &w, int precision)
+    : mxml(xml)
+    , mw(w)
+    , msi(w.screenInfo())
+    , msr(w.showingRect())
+    , mscale(w.screenInfo().viewRect().width() / w.showingRect().width())
+    , mprecision(precision)
+    , mcurobj(nullptr)
+    , mgroupopen(false)
+{
+}
+
+SVGExporterImpVisitor::~SVGExporterImpVisitor()
+{
+}
+
+void SVGExporterImpVisitor::visit(ObjectHolder *obj)
+{
+    if (!obj->drawer()->shown())
+        return;
+    mcurobj = obj;
+    obj->imp()->visit(this);
+}
+
+void SVGExporterImpVisitor::finish()
+{
+    if (mgroupopen)
+        mxml.writeEndElement();
+    mgroupopen = false;
+}
+
+SVGExporterImpVisitor::Style SVGExporterImpVisitor::strokeStyle(int defaultwidth) const
+{
+    Style ret;
+    ret.stroke = mcurobj->drawer()->color();
+    ret.width = mcurobj->drawer()->width() == -1 ? defaultwidth : mcurobj->drawer()->width();
+    ret.penstyle = mcurobj->drawer()->style();
+    return ret;
+}
+
+SVGExporterImpVisitor::Style SVGExporterImpVisitor::fillStyle() const
+{
+    Style ret;
+    ret.width = 0;
+    ret.penstyle = Qt::NoPen;
+    ret.fill = mcurobj->drawer()->color();
+    return ret;
+}
+
+void SVGExporterImpVisitor::setStyle(const Style &style)
+{
+    if (mgroupopen && style == mstyle)
+        return;
+    finish();
+    mxml.writeStartElement(QStringLiteral("g"));
+    if (style.stroke.isValid() && style.penstyle != Qt::NoPen) {
+        mxml.writeAttribute(QStringLiteral("stroke"), style.stroke.name());
+        if (style.stroke.alpha() != 255)
+            mxml.writeAttribute(QStringLiteral("stroke-opacity"), number(style.stroke.alphaF()));
+        mxml.writeAttribute(QStringLiteral("stroke-width"), number(style.width));
+        // the same patterns as Qt uses, in units of the pen width
+        std::vector<int> dashes;
+        switch (style.penstyle) {
+        case Qt::DashLine:
+            dashes = {4, 2};
+            break;
+        case Qt::DotLine:
+            dashes = {1, 2};
+            break;
+        case Qt::DashDotLine:
+            dashes = {4, 2, 1, 2};
+            break;
+        case Qt::DashDotDotLine:
+            dashes = {4, 2, 1, 2, 1, 2};
+            break;
+        default:
+            break;
+        }
+        if (!dashes.empty()) {
+            QStringList dasharray;
+            for (int dash : dashes)
+                dasharray << number(dash * style.width);
+            mxml.writeAttribute(QStringLiteral("stroke-dasharray"), dasharray.join(QLatin1Char(',')));
+        }
+    } else
+        mxml.writeAttribute(QStringLiteral("stroke"), QStringLiteral("none"));
+    if (style.fill.isValid()) {
+        mxml.writeAttribute(QStringLiteral("fill"), style.fill.name());
+        if (style.fill.alpha() != 255)
+            mxml.writeAttribute(QStringLiteral("fill-opacity"), number(style.fill.alphaF()));
+    } else
+        mxml.writeAttribute(QStringLiteral("fill"), QStringLiteral("none"));
+    mstyle = style;
+    mgroupopen = true;
+}
+
+QString SVGExporterImpVisitor::number(double x) const
+{
+    QString ret = QString::number(x, 'f', mprecision);
+    if (ret.contains(QLatin1Char('.'))) {
+        while (ret.endsWith(QLatin1Char('0')))
+            ret.chop(1);
+        if (ret.endsWith(QLatin1Char('.')))
+            ret.chop(1);
+    }
+    if (ret == QLatin1String("-0"))
+        ret = QStringLiteral("0");
+    return ret;
+}
+
+QString SVGExporterImpVisitor::point(const QPointF &p) const
+{
+    return number(p.x()) + QLatin1Char(',') + number(p.y());
+}
+
+QPointF SVGExporterImpVisitor::toScreen(const Coordinate &c) const
+{
+    return msi.toScreenF(c);
+}
+
+void SVGExporterImpVisitor::emitLine(const Coordinate &a, const Coordinate &b)
+{
+    const QPointF qa = toScreen(a);
+    const QPointF qb = toScreen(b);
+    mxml.writeEmptyElement(QStringLiteral("line"));
+    mxml.writeAttribute(QStringLiteral("x1"), number(qa.x()));
+    mxml.writeAttribute(QStringLiteral("y1"), number(qa.y()));
+    mxml.writeAttribute(QStringLiteral("x2"), number(qb.x()));
+    mxml.writeAttribute(QStringLiteral("y2"), number(qb.y()));
+}
+
+void SVGExporterImpVisitor::emitPath(const QString &d)
+{
+    if (d.isEmpty())
+        return;
+    mxml.writeEmptyElement(QStringLiteral("path"));
+    mxml.writeAttribute(QStringLiteral("d"), d);
+}
+
+void SVGExporterImpVisitor::emitPolylines(const std::vector<std::vector<Coordinate>> &lines)
+{
+    // all the polylines of a curve go in a single path..
+    QString d;
+    for (const std::vector<Coordinate> &line : lines) {
+        if (line.size() < 2)
+            continue;
+        d += QLatin1Char('M') + point(toScreen(line[0])) + QLatin1Char('L');
+        for (uint i = 1; i < line.size(); ++i) {
+            if (i > 1)
+                d += QLatin1Char(' ');
+            d += point(toScreen(line[i]));
+        }
+    }
+    emitPath(d);
+}
+
+void SVGExporterImpVisitor::emitPolygon(const std::vector<Coordinate> &pts, bool closed)
+{
+    QStringList points;
+    for (const Coordinate &c : pts)
+        points << point(toScreen(c));
+    mxml.writeEmptyElement(closed ? QStringLiteral("polygon") : QStringLiteral("polyline"));
+    mxml.writeAttribute(QStringLiteral("points"), points.join(QLatin1Char(' ')));
+}
+
+void SVGExporterImpVisitor::appendRationalQuad(QString &d, const QPointF &a, const QPointF &b, const QPointF &c, double w, int level) const
+{
+    if (level == 0) {
+        d += QLatin1Char('Q') + point(b) + QLatin1Char(' ') + point(c);
+        return;
+    }
+    // the same subdivision as KigPainter::rationalQuadTo()..
+    const double scale = 1 / (1 + w);
+    const double nw = std::sqrt(0.5 + 0.5 * w);
+    const QPointF wb = w * b;
+    const QPointF m = (a + 2 * wb + c) * (0.5 * scale);
+    appendRationalQuad(d, a, (a + wb) * scale, m, nw, level - 1);
+    appendRationalQuad(d, m, (wb + c) * scale, c, nw, level - 1);
+}
+
+void SVGExporterImpVisitor::visit(const LineImp *imp)
+{
+    Coordinate a = imp->data().a;
+    Coordinate b = imp->data().b;
+    calcBorderPoints(a, b, msr);
+    setStyle(strokeStyle());
+    emitLine(a, b);
+}
+
+void SVGExporterImpVisitor::visit(const PointImp *imp)
+{
+    if (!msr.contains(imp->coordinate()))
+        return;
+    const QPointF c = toScreen(imp->coordinate());
+    const int width = mcurobj->drawer()->width() == -1 ? 5 : mcurobj->drawer()->width();
+    const double radius = width / 2.;
+    const QColor color = mcurobj->drawer()->color();
+
+    // points are drawn like KigPainter::drawFatPoint() does..
+    Style style;
+    style.stroke = color;
+    style.width = 1;
+    style.penstyle = Qt::SolidLine;
+    switch (mcurobj->drawer()->pointStyle()) {
+    case Kig::Round:
+    case Kig::RoundEmpty:
+        if (mcurobj->drawer()->pointStyle() == Kig::Round)
+            style.fill = color;
+        setStyle(style);
+        mxml.writeEmptyElement(QStringLiteral("circle"));
+        mxml.writeAttribute(QStringLiteral("cx"), number(c.x()));
+        mxml.writeAttribute(QStringLiteral("cy"), number(c.y()));
+        mxml.writeAttribute(QStringLiteral("r"), number(radius));
+        break;
+    case Kig::Rectangular:
+    case Kig::RectangularEmpty:
+        if (mcurobj->drawer()->pointStyle() == Kig::Rectangular)
+            style.fill = color;
+        setStyle(style);
+        mxml.writeEmptyElement(QStringLiteral("rect"));
+        mxml.writeAttribute(QStringLiteral("x"), number(c.x() - radius));
+        mxml.writeAttribute(QStringLiteral("y"), number(c.y() - radius));
+        mxml.writeAttribute(QStringLiteral("width"), number(width));
+        mxml.writeAttribute(QStringLiteral("height"), number(width));
+        break;
+    case Kig::Cross:
+        style.width = 2;
+        setStyle(style);
+        emitPath(QLatin1Char('M') + point(c + QPointF(-radius, -radius)) + QLatin1Char('L') + point(c + QPointF(radius, radius)) + QLatin1Char('M')
+                 + point(c + QPointF(radius, -radius)) + QLatin1Char('L') + point(c + QPointF(-radius, radius)));
+        break;
+    }
+}
+
+void SVGExporterImpVisitor::visit(const TextImp *imp)
+{
+    // the rect that the text occupies on the screen, as calculated the
+    // last time it was drawn..
+    Rect frame = imp->surroundingRect();
+    if (!frame.valid())
+        return;
+    const QRectF r = msi.toScreenF(frame);
+
+    if (imp->hasFrame()) {
+        // the same frame as KigPainter::drawTextFrame() draws..
+        Style style;
+        style.stroke = Qt::black;
+        style.width = 1;
+        style.penstyle = Qt::SolidLine;
+        style.fill = QColor(255, 255, 222);
+        setStyle(style);
+        mxml.writeEmptyElement(QStringLiteral("rect"));
+        mxml.writeAttribute(QStringLiteral("x"), number(r.x()));
+        mxml.writeAttribute(QStringLiteral("y"), number(r.y()));
+        mxml.writeAttribute(QStringLiteral("width"), number(r.width()));
+        mxml.writeAttribute(QStringLiteral("height"), number(r.height()));
+        style.stroke = QColor(197, 194, 197);
+        style.fill = QColor();
+        setStyle(style);
+        emitPath(QLatin1Char('M') + point(r.bottomLeft()) + QLatin1Char('L') + point(r.topLeft()) + QLatin1Char(' ') + point(r.topRight()));
+    }
+
+    const QFont font = mcurobj->drawer()->font();
+    const QFontMetricsF fm(font);
+    const QStringList lines = imp->text().split(QLatin1Char('\n'));
+    // left aligned and vertically centered, two pixels from the frame
+    const double x = r.left() + 2;
+    double y = r.center().y() - lines.size() * fm.lineSpacing() / 2 + fm.ascent();
+
+    setStyle(fillStyle());
+    mxml.writeStartElement(QStringLiteral("text"));
+    mxml.writeAttribute(QStringLiteral("font-family"), font.family());
+    mxml.writeAttribute(QStringLiteral("font-size"), number(QFontInfo(font).pixelSize()));
+    if (font.bold())
+        mxml.writeAttribute(QStringLiteral("font-weight"), QStringLiteral("bold"));
+    if (font.italic())
+        mxml.writeAttribute(QStringLiteral("font-style"), QStringLiteral("italic"));
+    mxml.writeAttribute(QStringLiteral("xml:space"), QStringLiteral("preserve"));
+    for (const QString &line : lines) {
+        mxml.writeStartElement(QStringLiteral("tspan"));
+        mxml.writeAttribute(QStringLiteral("x"), number(x));
+        mxml.writeAttribute(QStringLiteral("y"), number(y));
+        mxml.writeCharacters(line);
+        mxml.writeEndElement();
+        y += fm.lineSpacing();
+    }
+    mxml.writeEndElement();
+}
+
+void SVGExporterImpVisitor::visit(const AngleImp *imp)
+{
+    const QPointF c = toScreen(imp->point());
+    const double radius = AngleImp::radius;
+    const double sa = imp->startAngle();
+    const double a = imp->angle();
+
+    setStyle(strokeStyle());
+    if (a == M_PI / 2 && imp->markRightAngle()) {
+        // the square of KigPainter::drawRightAngle()..
+        const double side = radius * std::sin(M_PI / 4);
+        const QPointF u(std::cos(sa) * side, -std::sin(sa) * side);
+        const QPointF v(-std::sin(sa) * side, -std::cos(sa) * side);
+        emitPath(QLatin1Char('M') + point(c + u) + QLatin1Char('L') + point(c + u + v) + QLatin1Char(' ') + point(c + v));
+        return;
+    }
+
+    const QPointF start = c + radius * QPointF(std::cos(sa), -std::sin(sa));
+    const QPointF end = c + radius * QPointF(std::cos(sa + a), -std::sin(sa + a));
+    emitPath(QStringLiteral("M%1A%2 %2 0 %3 0 %4").arg(point(start), number(radius), a > M_PI ? QStringLiteral("1") : QStringLiteral("0"), point(end)));
+
+    // and the arrow of KigPainter::drawAngle()..
+    const QPointF vect = (end - c) * (6 / radius);
+    const QPointF orthvect(-vect.y(), vect.x());
+    setStyle(fillStyle());
+    mxml.writeEmptyElement(QStringLiteral("polygon"));
+    mxml.writeAttribute(QStringLiteral("points"), point(end) + QLatin1Char(' ') + point(end + orthvect + vect) + QLatin1Char(' ') + point(end + orthvect - vect));
+}
+
+void SVGExporterImpVisitor::visit(const VectorImp *imp)
+{
+    const Coordinate a = imp->a();
+    const Coordinate b = imp->b();
+    if (a == b)
+        return;
+    setStyle(strokeStyle());
+    emitLine(a, b);
+
+    // the arrow lines of KigPainter::drawVector(), with a normal style..
+    const QPointF qa = toScreen(a);
+    const QPointF qb = toScreen(b);
+    const QPointF dir = (qb - qa) * (10 / std::hypot(qb.x() - qa.x(), qb.y() - qa.y()));
+    const QPointF perp(-dir.y(), dir.x());
+    Style style = strokeStyle();
+    style.penstyle = Qt::SolidLine;
+    setStyle(style);
+    emitPath(QLatin1Char('M') + point(qb - dir + perp) + QLatin1Char('L') + point(qb) + QLatin1Char(' ') + point(qb - dir - perp));
+}
+
+void SVGExporterImpVisitor::visit(const LocusImp *imp)
+{
+    setStyle(strokeStyle());
+    emitPolylines(calcCurvePolylines(imp, mw.document(), msr, 0.25 / mscale));
+}
+
+void SVGExporterImpVisitor::visit(const CircleImp *imp)
+{
+    const QPointF c = toScreen(imp->center());
+    setStyle(strokeStyle());
+    mxml.writeEmptyElement(QStringLiteral("circle"));
+    mxml.writeAttribute(QStringLiteral("cx"), number(c.x()));
+    mxml.writeAttribute(QStringLiteral("cy"), number(c.y()));
+    mxml.writeAttribute(QStringLiteral("r"), number(imp->radius() * mscale));
+}
+
+void SVGExporterImpVisitor::visit(const ConicImp *imp)
+{
+    const ConicPolarData data = imp->polarData();
+    const ConicArcImp *arc = dynamic_cast<const ConicArcImp *>(imp);
+    setStyle(strokeStyle());
+
+    if (!arc && imp->conicType() == 1) {
+        // a whole ellipse: rho( theta ) = p / ( 1 - e cos( theta -
+        // theta0 ) ) has its vertices at theta0 and theta0 + pi..
+        const double e = std::hypot(data.ecostheta0, data.esintheta0);
+        const double theta0 = std::atan2(data.esintheta0, data.ecostheta0);
+        const Coordinate center = data.focus1 + Coordinate(std::cos(theta0), std::sin(theta0)) * (data.pdimen * e / (1 - e * e));
+        const QPointF c = toScreen(center);
+        mxml.writeEmptyElement(QStringLiteral("ellipse"));
+        mxml.writeAttribute(QStringLiteral("cx"), number(c.x()));
+        mxml.writeAttribute(QStringLiteral("cy"), number(c.y()));
+        mxml.writeAttribute(QStringLiteral("rx"), number(std::fabs(data.pdimen) / (1 - e * e) * mscale));
+        mxml.writeAttribute(QStringLiteral("ry"), number(std::fabs(data.pdimen) / std::sqrt(1 - e * e) * mscale));
+        if (e != 0)
+            mxml.writeAttribute(QStringLiteral("transform"),
+                                QStringLiteral("rotate(%1 %2 %3)").arg(number(-Goniometry::convert(theta0, Goniometry::Rad, Goniometry::Deg)), number(c.x()), number(c.y())));
+        return;
+    }
+
+    // other conics and arcs are built of rational quadratic Bezier curves
+    // like KigPainter::drawConic() does, the parts farther from the focus
+    // than every corner of the window are left out..
+    const Coordinate corners[4] = {msr.topLeft(), msr.topRight(), msr.bottomLeft(), msr.bottomRight()};
+    double maxdist = 0;
+    for (int i = 0; i < 4; ++i)
+        maxdist = std::max(maxdist, (corners[i] - data.focus1).length());
+    maxdist += 10 / mscale;
+    const std::vector<RationalQuadData> pieces =
+        arc ? calcConicBezierPieces(data, maxdist, arc->startAngle(), arc->angle()) : calcConicBezierPieces(data, maxdist, 0., 2 * M_PI);
+
+    QString d;
+    QPointF last;
+    for (std::vector<RationalQuadData>::const_iterator i = pieces.begin(); i != pieces.end(); ++i) {
+        const QPointF a = toScreen(i->a);
+        const QPointF b = toScreen(i->b);
+        const QPointF c = toScreen(i->c);
+        if (i == pieces.begin() || a != last)
+            d += QLatin1Char('M') + point(a);
+        // parabolas are exact, for the rest we keep the error below a
+        // quarter of a pixel..
+        const QPointF ev = (a - 2 * b + c) * ((i->w - 1) / (4 * (i->w + 1)));
+        double error = std::hypot(ev.x(), ev.y());
+        int level = 0;
+        for (; level < 5 && error > 0.25; ++level)
+            error /= 4;
+        appendRationalQuad(d, a, b, c, i->w, level);
+        last = c;
+    }
+    emitPath(d);
+}
+
+void SVGExporterImpVisitor::visit(const CubicImp *imp)
+{
+    // cells of a few pixels, as in KigPainter::drawCubic()..
+    const double cell = 3 / mscale;
+    Rect r = msr;
+    r.setLeft(r.left() - cell);
+    r.setRight(r.right() + cell);
+    r.setBottom(r.bottom() - cell);
+    r.setTop(r.top() + cell);
+    setStyle(strokeStyle());
+    emitPolylines(calcCubicPolylines(imp->data(), r, cell));
+}
+
+void SVGExporterImpVisitor::visit(const SegmentImp *imp)
+{
+    setStyle(strokeStyle());
+    emitLine(imp->data().a, imp->data().b);
+}
+
+void SVGExporterImpVisitor::visit(const RayImp *imp)
+{
+    Coordinate a = imp->data().a;
+    Coordinate b = imp->data().b;
+    calcRayBorderPoints(a, b, msr);
+    setStyle(strokeStyle());
+    emitLine(a, b);
+}
+
+void SVGExporterImpVisitor::visit(const ArcImp *imp)
+{
+    const double radius = imp->radius() * mscale;
+    const double sa = imp->startAngle();
+    const double a = imp->angle();
+    setStyle(strokeStyle());
+    if (std::fabs(a) >= 2 * M_PI) {
+        const QPointF c = toScreen(imp->center());
+        mxml.writeEmptyElement(QStringLiteral("circle"));
+        mxml.writeAttribute(QStringLiteral("cx"), number(c.x()));
+        mxml.writeAttribute(QStringLiteral("cy"), number(c.y()));
+        mxml.writeAttribute(QStringLiteral("r"), number(radius));
+        return;
+    }
+    // positive angles are counterclockwise, which is a negative sweep
+    // on the screen, where the y axis points down..
+    const QPointF start = toScreen(imp->center() + Coordinate(std::cos(sa), std::sin(sa)) * imp->radius());
+    const QPointF end = toScreen(imp->center() + Coordinate(std::cos(sa + a), std::sin(sa + a)) * imp->radius());
+    emitPath(QStringLiteral("M%1A%2 %2 0 %3 %4 %5")
+                 .arg(point(start),
+                      number(radius),
+                      std::fabs(a) > M_PI ? QStringLiteral("1") : QStringLiteral("0"),
+                      a > 0 ? QStringLiteral("0") : QStringLiteral("1"),
+                      point(end)));
+}
+
+void SVGExporterImpVisitor::visit(const FilledPolygonImp *imp)
+{
+    // with the transparency of KigPainter::drawPolygon()..
+    Style style = fillStyle();
+    style.fill.setAlpha(100);
+    setStyle(style);
+    emitPolygon(imp->points(), true);
+}
+
+void SVGExporterImpVisitor::visit(const ClosedPolygonalImp *imp)
+{
+    setStyle(strokeStyle());
+    emitPolygon(imp->points(), true);
+}
+
+void SVGExporterImpVisitor::visit(const OpenPolygonalImp *imp)
+{
+    setStyle(strokeStyle());
+    emitPolygon(imp->points(), false);
+}
+
+void SVGExporterImpVisitor::visit(const BezierImp *imp)
+{
+    const std::vector<Coordinate> pts = imp->points();
+    setStyle(strokeStyle());
+    // quadratic and cubic Bezier curves are native to SVG..
+    switch (pts.size()) {
+    case 3:
+        emitPath(QLatin1Char('M') + point(toScreen(pts[0])) + QLatin1Char('Q') + point(toScreen(pts[1])) + QLatin1Char(' ') + point(toScreen(pts[2])));
+        break;
+    case 4:
+        emitPath(QLatin1Char('M') + point(toScreen(pts[0])) + QLatin1Char('C') + point(toScreen(pts[1])) + QLatin1Char(' ') + point(toScreen(pts[2]))
+                 + QLatin1Char(' ') + point(toScreen(pts[3])));
+        break;
+    default:
+        emitPolylines(calcCurvePolylines(imp, mw.document(), msr, 0.25 / mscale));
+        break;
+    }
+}
+
+void SVGExporterImpVisitor::visit(const RationalBezierImp *imp)
+{
+    setStyle(strokeStyle());
+    emitPolylines(calcCurvePolylines(imp, mw.document(), msr, 0.25 / mscale));
+}
@@ -0,0 +1,110 @@
+// SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#pragma once
+
+#include "../misc/coordinate.h"
+#include "../misc/rect.h"
+#include "../misc/screeninfo.h"
+#include "../objects/object_imp.h"
+
+#include <QColor>
+#include <QPointF>
+#include <QString>
+
+#include <vector>
+
+class KigWidget;
+class ObjectHolder;
+class QXmlStreamWriter;
+
+/**
+ * Writes the objects of a document as native SVG elements: circles and
+ * ellipses as <circle> and <ellipse>, arcs and other conics as paths of
+ * arcs and Bezier curves, and only the curves that can't be drawn
+ * exactly as polylines.  Consecutive objects with the same style share
+ * a <g> element that carries the style.
+ */
+class SVGExporterImpVisitor : public ObjectImpVisitor
+{
+public:
+    /**
+     * Coordinates are written in pixels of the view of w, with
+     * precision decimal places.
+     */
+    SVGExporterImpVisitor(QXmlStreamWriter &xml, const KigWidget &w, int precision);
+    ~SVGExporterImpVisitor();
+
+    void visit(ObjectHolder *obj);
+    /**
+     * Close the group that is still open, call this after the last
+     * object.
+     */
+    void finish();
+
+    using ObjectImpVisitor::visit;
+    void visit(const LineImp *imp) override;
+    void visit(const PointImp *imp) override;
+    void visit(const TextImp *imp) override;
+    void visit(const AngleImp *imp) override;
+    void visit(const VectorImp *imp) override;
+    void visit(const LocusImp *imp) override;
+    void visit(const CircleImp *imp) override;
+    void visit(const ConicImp *imp) override;
+    void visit(const CubicImp *imp) override;
+    void visit(const SegmentImp *imp) override;
+    void visit(const RayImp *imp) override;
+    void visit(const ArcImp *imp) override;
+    void visit(const FilledPolygonImp *imp) override;
+    void visit(const ClosedPolygonalImp *imp) override;
+    void visit(const OpenPolygonalImp *imp) override;
+    void visit(const BezierImp *imp) override;
+    void visit(const RationalBezierImp *imp) override;
+
+private:
+    // the presentation attributes of a group, an invalid color means none
+    struct Style {
+        QColor stroke;
+        double width;
+        Qt::PenStyle penstyle;
+        QColor fill;
+        bool operator==(const Style &rhs) const;
+    };
+
+    /**
+     * The style of the current object: stroked with its color, width and
+     * pen style, or filled with its color.
+     */
+    Style strokeStyle(int defaultwidth = 1) const;
+    Style fillStyle() const;
+    /**
+     * Open a new group if the current one has another style.
+     */
+    void setStyle(const Style &style);
+
+    QString number(double x) const;
+    QString point(const QPointF &p) const;
+    QPointF toScreen(const Coordinate &c) const;
+
+    void emitLine(const Coordinate &a, const Coordinate &b);
+    void emitPath(const QString &d);
+    void emitPolylines(const std::vector<std::vector<Coordinate>> &lines);
+    void emitPolygon(const std::vector<Coordinate> &pts, bool closed);
+    /**
+     * Append the rational quadratic Bezier curve from a to c with control
+     * point b of weight w to the path data d, as 2^level quadratic ones.
+     */
+    void appendRationalQuad(QString &d, const QPointF &a, const QPointF &b, const QPointF &c, double w, int level) const;
+
+    QXmlStreamWriter &mxml;
+    const KigWidget &mw;
+    ScreenInfo msi;
+    Rect msr;
+    // the size of a document unit in pixels
+    double mscale;
+    int mprecision;
+    ObjectHolder *mcurobj;
+    bool mgroupopen;
+    Style mstyle;
+};
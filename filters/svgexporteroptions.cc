@@ -8,6 +8,7 @@
 
 #include <QCheckBox>
 #include <QLayout>
+#include <QSpinBox>
 
 SVGExporterOptions::SVGExporterOptions(QWidget *parent)
     : QWidget(parent)
@@ -43,4 +44,14 @@ bool SVGExporterOptions::showAxes() const
     return expwidget->showAxesCheckBox->isChecked();
 }
 
+void SVGExporterOptions::setPrecision(int precision)
+{
+    expwidget->precisionSpinBox->setValue(precision);
+}
+
+int SVGExporterOptions::precision() const
+{
+    return expwidget->precisionSpinBox->value();
+}
+
 #include "moc_svgexporteroptions.cpp"
@@ -22,4 +22,6 @@ public:
     bool showGrid() const;
     void setAxes(bool axes);
     bool showAxes() const;
+    void setPrecision(int precision);
+    int precision() const;
 };
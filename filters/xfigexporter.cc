@@ -10,10 +10,14 @@
 #include "../kig/kig_part.h"
 #include "../kig/kig_view.h"
 #include "../misc/common.h"
+#include "../misc/cubic-common.h"
 #include "../misc/kigfiledialog.h"
 #include "../misc/kigpainter.h"
 #include "../objects/circle_imp.h"
+#include "../objects/cubic_imp.h"
+#include "../objects/curve_imp.h"
 #include "../objects/line_imp.h"
+#include "../objects/locus_imp.h"
 #include "../objects/object_drawer.h"
 #include "../objects/object_holder.h"
 #include "../objects/object_imp.h"
@@ -76,6 +80,11 @@ class XFigExportImpVisitor : public ObjectImpVisitor
     }
 
     void emitLine(const Coordinate &a, const Coordinate &b, int width, bool vector = false);
+    void emitPolyline(const std::vector<Coordinate> &pts, int width);
+    /**
+     * Plots a generic curve as the polylines of calcCurvePolylines().
+     */
+    void plotGenericCurve(const CurveImp *imp);
 
 public:
     void visit(ObjectHolder *obj);
@@ -191,6 +200,57 @@ void XFigExportImpVisitor::emitLine(const Coordinate &a, const Coordinate &b, in
     mstream << ca.x() << " " << ca.y() << " " << cb.x() << " " << cb.y() << "\n";
 }
 
+void XFigExportImpVisitor::emitPolyline(const std::vector<Coordinate> &pts, int width)
+{
+    mstream << "2 "; // polyline type;
+    mstream << "1 "; // polyline subtype;
+    mstream << "0 "; // line_style: Solid
+    mstream << width << " "; // thickness: *1/80 inch
+    mstream << mcurcolorid << " "; // pen_color: default
+    mstream << "7 "; // fill_color: white
+    mstream << "50 "; // depth: 50
+    mstream << "-1 "; // pen_style: unused by XFig
+    mstream << "-1 "; // area_fill: no fill
+    mstream << "0.000 "; // style_val: the distance between dots and
+                         // dashes in case of dotted or dashed lines..
+    mstream << "0 "; // join_style: Miter
+    mstream << "0 "; // cap_style: Butt
+    mstream << "-1 "; // radius in case of an arc-box, but we're a
+                      // polyline, so nothing here..
+    mstream << "0 "; // forward arrow: no
+    mstream << "0 "; // backward arrow: no
+    mstream << pts.size(); // it has n points
+    mstream << "\n";
+
+    // write the list of points, max 6 per line..
+    bool in_line = false;
+    for (uint i = 0; i < pts.size(); ++i) {
+        int m = i % 6;
+        if (m == 0) {
+            in_line = true;
+            mstream << "\t";
+        }
+        QPoint p = convertCoord(pts[i]);
+        mstream << " " << p.x() << " " << p.y();
+        if (m == 5) {
+            in_line = false;
+            mstream << "\n";
+        }
+    }
+    if (in_line)
+        mstream << "\n";
+}
+
+void XFigExportImpVisitor::plotGenericCurve(const CurveImp *imp)
+{
+    int width = mcurobj->drawer()->width();
+    if (width == -1)
+        width = 1;
+    const std::vector<std::vector<Coordinate>> lines = calcCurvePolylines(imp, mw.document(), msr, msr.width() * exportCurvePrecision);
+    for (const std::vector<Coordinate> &pts : lines)
+        emitPolyline(pts, width);
+}
+
 void XFigExportImpVisitor::visit(const PointImp *imp)
 {
     const QPoint center = convertCoord(imp->coordinate());
@@ -253,8 +313,9 @@ void XFigExportImpVisitor::visit(const VectorImp *imp)
     emitLine(imp->a(), imp->b(), width, true);
 }
 
-void XFigExportImpVisitor::visit(const LocusImp *)
+void XFigExportImpVisitor::visit(const LocusImp *imp)
 {
+    plotGenericCurve(imp);
 }
 
 void XFigExportImpVisitor::visit(const CircleImp *imp)
@@ -335,11 +396,17 @@ void XFigExportImpVisitor::visit(const ConicImp *imp)
                 << qcenter.y() << " " << qpoint2.x() << " " // end point
                 << qpoint2.y() << " ";
     } else
-        return;
+        plotGenericCurve(imp);
 }
 
-void XFigExportImpVisitor::visit(const CubicImp *)
+void XFigExportImpVisitor::visit(const CubicImp *imp)
 {
+    int width = mcurobj->drawer()->width();
+    if (width == -1)
+        width = 1;
+    const std::vector<std::vector<Coordinate>> lines = calcCubicPolylines(imp->data(), msr, msr.width() * exportCurvePrecision);
+    for (const std::vector<Coordinate> &pts : lines)
+        emitPolyline(pts, width);
 }
 
 void XFigExportImpVisitor::visit(const SegmentImp *imp)
@@ -581,7 +648,7 @@ void XFigExporter::run(const KigPart &doc, KigWidget &w)
     stream << "-2\n";
     stream << "1200 2\n";
 
-    std::vector<ObjectHolder *> os = doc.document().objects();
+    const std::vector<ObjectHolder *> &os = doc.document().objects();
     XFigExportImpVisitor visitor(stream, w);
 
     for (std::vector<ObjectHolder *>::const_iterator i = os.begin(); i != os.end(); ++i) {
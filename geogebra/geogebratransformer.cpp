@@ -12,250 +12,314 @@
 #include <objects/bogus_imp.h>
 #include <objects/object_calcer.h>
 #include <objects/object_drawer.h>
-#include <objects/object_factory.h>
-#include <objects/object_holder.h>
 #include <objects/object_type_factory.h>
 
-#include <QDebug>
-
-#include <QColor>
-#include <QXmlName>
-
-void GeogebraTransformer::atomicValue(const QVariant &)
-{
-    // I wish I could use this...
-}
-
-void GeogebraTransformer::attribute(const QXmlName &name, const QStringRef &value)
+#include <KLocalizedString>
+
+#include <QXmlStreamReader>
+
+// The GeoGebra commands that map to a single Kig type, whatever their
+// inputs are.
+static const struct {
+    const char *command;
+    const char *type;
+} simpleCommands[] = {
+    {"Segment", "SegmentAB"},
+    {"Ray", "RayAB"},
+    {"Midpoint", "Midpoint"},
+    {"OrthogonalLine", "LinePerpend"},
+    {"PolyLine", "OpenPolygon"},
+    {"Vector", "Vector"},
+    {"Polygon", "PolygonBNP"},
+    {"CircumcircleArc", "ArcBTP"},
+    {"Parabola", "ParabolaBDP"},
+    {"Ellipse", "EllipseBFFP"},
+    {"Hyperbola", "HyperbolaBFFP"},
+    {"Conic", "ConicB5P"},
+    {"Translate", "Translation"},
+    {"Dilate", "ScalingOverCenter"},
+    {"Polar", "ConicPolarLine"},
+};
+
+bool GeogebraTransformer::read(QIODevice &device)
 {
-    if (name.localName(m_np) == QLatin1String("label")) {
-        const QByteArray objectLabel = value.toLatin1();
-        bool isDoubleValue;
-        const double dblval = value.toString().toDouble(&isDoubleValue);
-
-        switch (m_currentState) {
-        case GeogebraTransformer::ReadingObject:
-            m_currentObjectLabel = value.toLatin1();
-            // There must be a better place for this
-            m_currentState = GeogebraTransformer::ReadingArguments;
-
-            break;
-        case GeogebraTransformer::ReadingArguments:
-            if (isDoubleValue) {
-                /* This is to handle the circle-point-radius, dilate (and similar) type of Geogebra objects.
-                 * <command name="Circle">
-                 * <input a0="A" a1="3"/>
-                 * <output a0="c"/>
-                 *
-                 * Notice the attribute 'a1' of the 'input' element. The value - '3' is the radius of the circle.
-                 * First, we try to convert that value to Double. If the conversion suceeds, we stack a DoubleImp (Calcer)
-                 * in the m_currentArgStack and break. Otherwise, we check the m_objectMap for that label entry.
-                 */
-                DoubleImp *doubleImp = new DoubleImp(dblval);
-                m_currentArgStack.push_back(new ObjectConstCalcer(doubleImp));
-            } else if (m_objectMap.contains(objectLabel)) {
-                m_currentArgStack.push_back(m_objectMap[objectLabel]);
-            } else {
-                // TODO Figure out error reporting
-            }
-
-            break;
-        default:
-            break;
+    QXmlStreamReader xml(&device);
+
+    if (xml.readNextStartElement()) {
+        if (xml.name() != QLatin1String("geogebra"))
+            xml.raiseError(i18n("This is not a GeoGebra file."));
+        while (xml.readNextStartElement()) {
+            if (xml.name() == QLatin1String("euclidianView")) {
+                while (xml.readNextStartElement()) {
+                    if (xml.name() == QLatin1String("evSettings")) {
+                        const QXmlStreamAttributes attrs = xml.attributes();
+                        if (attrs.hasAttribute(QLatin1String("axes")))
+                            m_document->setAxes(attrs.value(QLatin1String("axes")) == QLatin1String("true"));
+                        if (attrs.hasAttribute(QLatin1String("grid")))
+                            m_document->setGrid(attrs.value(QLatin1String("grid")) == QLatin1String("true"));
+                    }
+                    xml.skipCurrentElement();
+                }
+            } else if (xml.name() == QLatin1String("construction")) {
+                GeogebraSection section;
+                m_inputObjectLabels.clear();
+                m_outputObjectLabels.clear();
+                readConstruction(xml, section);
+                m_sections.push_back(section);
+            } else if (xml.name() == QLatin1String("macro")) {
+                readMacro(xml);
+            } else
+                xml.skipCurrentElement();
         }
-    } else if (name.localName(m_np) == QLatin1String("value")) {
-        Q_ASSERT(m_currentState == ReadingDouble);
-        DoubleImp *doubleImp = new DoubleImp(value.toString().toDouble());
+    }
 
-        m_currentArgStack.push_back(new ObjectConstCalcer(doubleImp));
-    } else if (name.localName(m_np) == QLatin1String("Name")) {
-        m_sections[m_nsections - 1].setName(value.toString());
-    } else if (name.localName(m_np) == QLatin1String("Description")) {
-        m_sections[m_nsections - 1].setDescription(value.toString());
-    } else if (name.localName(m_np) == QLatin1String("Input")) {
-        m_inputObjectLabels.insert(value.toLatin1());
-    } else if (name.localName(m_np) == QLatin1String("Output")) {
-        m_outputObjectLabels.insert(value.toLatin1());
-    } else if (name.localName(m_np) == QLatin1String("show")) {
-        m_show = ((value.toString() == QLatin1String("true")) ? true : false);
-    } else if (name.localName(m_np) == QLatin1String("thickness")) {
-        m_thickness = value.toString().toInt();
-    } else if (name.localName(m_np) == QLatin1String("thickness_point")) {
-        m_thickness = value.toString().toInt();
-        m_thickness += 6;
-    } else if (name.localName(m_np) == QLatin1String("type")) {
-        int penType = value.toString().toInt();
-        switch (penType) {
-        case SOLIDLINE:
-            m_type = Qt::SolidLine;
-            break;
-        case DASHDOTDOTLINE:
-            m_type = Qt::DashDotDotLine;
-            break;
-        case DASHLINE:
-            m_type = Qt::DashLine;
-            break;
-        case DOTLINE:
-            m_type = Qt::DotLine;
-            break;
-        case DASHDOTLINE:
-            m_type = Qt::DashDotLine;
-            break;
-        default:
-            m_type = Qt::SolidLine;
-        };
-    } else if (name.localName(m_np) == QLatin1String("pointType")) {
-        int pt = value.toString().toInt();
-        if (pt == SOLIDCIRCLEPOINT)
-            m_pointType = Kig::pointStyleFromString(QStringLiteral("Round"));
-        else if (pt == SOLIDDIAMONDPOINT || pt == UPARROWPOINT || pt == DOWNARROWPOINT || pt == RIGHTARROWPOINT || pt == LEFTARROWPOINT)
-            m_pointType = Kig::pointStyleFromString(QStringLiteral("Rectangular"));
-        else if (pt == HOLLOWCIRCLEPOINT)
-            m_pointType = Kig::pointStyleFromString(
-                QStringLiteral("Round")); // TODO should be mapped to RoundEmpty ( i.e. 1) but for some reason it is not drawing in KIG
-        else if (pt == HOLLOWDIAMONDPOINT)
-            m_pointType = Kig::pointStyleFromString(
-                QStringLiteral("Rectangular")); // TODO should be mapped to RectangularEmpty ( i.e. 3) but for some reason it is not drawing in KIG
-        else if (pt == CROSSPOINT || pt == PLUSPOINT)
-            m_pointType = Kig::pointStyleFromString(QStringLiteral("Cross"));
-        else
-            m_pointType = Kig::Round;
-    } else if (name.localName(m_np) == QLatin1String("r")) {
-        m_r = value.toString().toInt();
-    } else if (name.localName(m_np) == QLatin1String("g")) {
-        m_g = value.toString().toInt();
-    } else if (name.localName(m_np) == QLatin1String("b")) {
-        m_b = value.toString().toInt();
-    } else if (name.localName(m_np) == QLatin1String("alpha")) {
-        m_alpha = value.toString().toInt();
-    } else if (name.localName(m_np) == QLatin1String("axes")) {
-        bool showAxes = value.toString() == QLatin1String("true") ? true : false;
-        m_document->setAxes(showAxes);
-    } else if (name.localName(m_np) == QLatin1String("grid")) {
-        bool showGrid = value.toString() == QLatin1String("true") ? true : false;
-        m_document->setGrid(showGrid);
+    if (xml.hasError()) {
+        m_errorString = xml.errorString();
+        return false;
     }
+    return true;
 }
 
-void GeogebraTransformer::characters(const QStringRef &)
+void GeogebraTransformer::readMacro(QXmlStreamReader &xml)
 {
-}
+    GeogebraSection section;
+    const QXmlStreamAttributes attrs = xml.attributes();
+    section.setName(attrs.value(QLatin1String("toolName")).toString());
+    section.setDescription(attrs.value(QLatin1String("toolHelp")).toString());
+
+    m_inputObjectLabels.clear();
+    m_outputObjectLabels.clear();
+    while (xml.readNextStartElement()) {
+        if (xml.name() == QLatin1String("macroInput")) {
+            const QXmlStreamAttributes labels = xml.attributes();
+            for (const QXmlStreamAttribute &label : labels)
+                m_inputObjectLabels.insert(label.value().toString());
+            xml.skipCurrentElement();
+        } else if (xml.name() == QLatin1String("macroOutput")) {
+            const QXmlStreamAttributes labels = xml.attributes();
+            for (const QXmlStreamAttribute &label : labels)
+                m_outputObjectLabels.insert(label.value().toString());
+            xml.skipCurrentElement();
+        } else if (xml.name() == QLatin1String("toolHelp")) {
+            section.setDescription(xml.readElementText());
+        } else if (xml.name() == QLatin1String("construction")) {
+            readConstruction(xml, section);
+        } else
+            xml.skipCurrentElement();
+    }
 
-void GeogebraTransformer::comment(const QString &)
-{
+    m_sections.push_back(section);
 }
 
-void GeogebraTransformer::endDocument()
+void GeogebraTransformer::readConstruction(QXmlStreamReader &xml, GeogebraSection &section)
 {
+    m_objectMap.clear();
+    m_commandNames.clear();
+    m_elementTypes.clear();
+    m_drawnLabels.clear();
+    m_styles.clear();
+
+    while (xml.readNextStartElement()) {
+        if (xml.name() == QLatin1String("element"))
+            readElement(xml, section);
+        else if (xml.name() == QLatin1String("command"))
+            readCommand(xml, section);
+        else
+            xml.skipCurrentElement();
+    }
+
+    for (const QString &label : m_drawnLabels) {
+        const Style style = m_styles.value(label);
+        section.addDrawer(new ObjectDrawer(style.color, style.thickness, style.show, style.type, style.pointType));
+    }
 }
 
-void GeogebraTransformer::endElement()
+void GeogebraTransformer::readCommand(QXmlStreamReader &xml, GeogebraSection &section)
 {
-    switch (m_currentState) {
-    case GeogebraTransformer::ReadingObject:
-        if (m_currentObject) {
-            if (!m_objectMap.contains(m_currentObjectLabel)) {
-                ObjectTypeCalcer *oc = new ObjectTypeCalcer(m_currentObject, m_currentArgStack);
-
-                oc->calc(*m_document);
-                m_objectMap.insert(m_currentObjectLabel, oc);
-
-                // Decide where to put this object
-                if (m_inputObjectLabels.empty()) {
-                    // Not handling input/output objects, put everything in second
-                    ObjectDrawer *od = new ObjectDrawer(QColor(m_r, m_g, m_b), m_thickness, m_show, m_type, m_pointType);
-
-                    m_sections[m_nsections - 1].addOutputObject(oc);
-                    m_sections[m_nsections - 1].addDrawer(od);
-                } else {
-                    if (m_inputObjectLabels.contains(m_currentObjectLabel)) {
-                        m_sections[m_nsections - 1].addInputObject(oc);
-                    } else if (m_outputObjectLabels.contains(m_currentObjectLabel)) {
-                        m_sections[m_nsections - 1].addOutputObject(oc);
-                    }
-                }
-            }
-
-            m_currentArgStack.clear();
-            m_currentObject = nullptr;
+    const QString command = xml.attributes().value(QLatin1String("name")).toString();
+    std::vector<QString> inputs;
+    QString label;
+
+    while (xml.readNextStartElement()) {
+        const QXmlStreamAttributes attrs = xml.attributes();
+        if (xml.name() == QLatin1String("input")) {
+            for (const QXmlStreamAttribute &input : attrs)
+                inputs.push_back(input.value().toString());
+        } else if (xml.name() == QLatin1String("output")) {
+            for (const QXmlStreamAttribute &output : attrs)
+                m_commandNames.insert(output.value().toString(), command);
+            label = attrs.value(QLatin1String("a0")).toString();
         }
+        xml.skipCurrentElement();
+    }
 
-        break;
-    case GeogebraTransformer::ReadingArguments:
-    case GeogebraTransformer::ReadingDouble:
-        /* We do this because every argument may be the
-         * last argument of the stack. If it is not, then
-         * startElement() will reset this to ReadingArguments
-         */
-        m_currentState = GeogebraTransformer::ReadingObject;
+    const ObjectType *type = commandType(command, inputs);
+    if (!type || label.isEmpty())
+        return;
 
-        break;
-    default:
-        break;
+    std::vector<ObjectCalcer *> args;
+    for (const QString &input : inputs) {
+        bool isDoubleValue;
+        const double dblval = input.toDouble(&isDoubleValue);
+        if (isDoubleValue) {
+            /* This is to handle the circle-point-radius, dilate (and similar) type of Geogebra objects.
+             * <command name="Circle">
+             * <input a0="A" a1="3"/>
+             * <output a0="c"/>
+             *
+             * Notice the attribute 'a1' of the 'input' element. The value - '3' is the radius of the circle.
+             * First, we try to convert that value to Double. If the conversion suceeds, we stack a DoubleImp (Calcer)
+             * in the args and continue. Otherwise, we check the m_objectMap for that label entry.
+             */
+            args.push_back(new ObjectConstCalcer(new DoubleImp(dblval)));
+        } else {
+            const QHash<QString, ObjectCalcer *>::const_iterator parent = m_objectMap.constFind(input);
+            if (parent != m_objectMap.constEnd())
+                args.push_back(*parent);
+            // TODO Figure out error reporting
+        }
     }
-}
 
-void GeogebraTransformer::endOfSequence()
-{
+    addObject(section, label, type, args);
 }
 
-void GeogebraTransformer::namespaceBinding(const QXmlName &)
+void GeogebraTransformer::readElement(QXmlStreamReader &xml, GeogebraSection &section)
 {
-}
+    const QXmlStreamAttributes elementAttrs = xml.attributes();
+    const QString type = elementAttrs.value(QLatin1String("type")).toString();
+    const QString label = elementAttrs.value(QLatin1String("label")).toString();
+    Style style;
+    double x = 0.;
+    double y = 0.;
+
+    while (xml.readNextStartElement()) {
+        const QXmlStreamAttributes attrs = xml.attributes();
+        if (xml.name() == QLatin1String("show")) {
+            if (attrs.hasAttribute(QLatin1String("object")))
+                style.show = attrs.value(QLatin1String("object")) == QLatin1String("true");
+        } else if (xml.name() == QLatin1String("objColor")) {
+            // the alpha GeoGebra writes is not always an integer, so it is not used
+            style.color = QColor(attrs.value(QLatin1String("r")).toInt(), attrs.value(QLatin1String("g")).toInt(), attrs.value(QLatin1String("b")).toInt());
+        } else if (xml.name() == QLatin1String("lineStyle")) {
+            if (attrs.hasAttribute(QLatin1String("thickness")))
+                style.thickness = attrs.value(QLatin1String("thickness")).toInt();
+            switch (attrs.value(QLatin1String("type")).toInt()) {
+            case DASHDOTDOTLINE:
+                style.type = Qt::DashDotDotLine;
+                break;
+            case DASHLINE:
+                style.type = Qt::DashLine;
+                break;
+            case DOTLINE:
+                style.type = Qt::DotLine;
+                break;
+            case DASHDOTLINE:
+                style.type = Qt::DashDotLine;
+                break;
+            default:
+                style.type = Qt::SolidLine;
+            }
+        } else if (xml.name() == QLatin1String("pointSize")) {
+            style.thickness = attrs.value(QLatin1String("val")).toInt() + 6;
+        } else if (xml.name() == QLatin1String("pointStyle")) {
+            const int pt = attrs.value(QLatin1String("val")).toInt();
+            if (pt == SOLIDCIRCLEPOINT)
+                style.pointType = Kig::Round;
+            else if (pt == SOLIDDIAMONDPOINT || pt == UPARROWPOINT || pt == DOWNARROWPOINT || pt == RIGHTARROWPOINT || pt == LEFTARROWPOINT)
+                style.pointType = Kig::Rectangular;
+            else if (pt == HOLLOWCIRCLEPOINT)
+                style.pointType = Kig::Round; // TODO should be mapped to RoundEmpty ( i.e. 1) but for some reason it is not drawing in KIG
+            else if (pt == HOLLOWDIAMONDPOINT)
+                style.pointType = Kig::Rectangular; // TODO should be mapped to RectangularEmpty ( i.e. 3) but for some reason it is not drawing in KIG
+            else if (pt == CROSSPOINT || pt == PLUSPOINT)
+                style.pointType = Kig::Cross;
+            else
+                style.pointType = Kig::Round;
+        } else if (xml.name() == QLatin1String("coords")) {
+            x = attrs.value(QLatin1String("x")).toDouble();
+            y = attrs.value(QLatin1String("y")).toDouble();
+        }
+        xml.skipCurrentElement();
+    }
 
-void GeogebraTransformer::processingInstruction(const QXmlName &, const QString &)
-{
-}
+    m_elementTypes.insert(label, type);
+    m_styles.insert(label, style);
 
-void GeogebraTransformer::startDocument()
-{
+    // Points that are not constructed by a command are free points.
+    // Intersections of anything but lines, and points on objects, are
+    // not supported
+    if (type == QLatin1String("point") && !m_objectMap.contains(label)) {
+        const QString command = m_commandNames.value(label);
+        if (command == QLatin1String("Intersect") || command == QLatin1String("Point"))
+            return;
+        std::vector<ObjectCalcer *> args;
+        args.push_back(new ObjectConstCalcer(new DoubleImp(x)));
+        args.push_back(new ObjectConstCalcer(new DoubleImp(y)));
+        addObject(section, label, ObjectTypeFactory::instance()->find("FixedPoint"), args);
+    }
 }
 
-void GeogebraTransformer::startElement(const QXmlName &name)
+const ObjectType *GeogebraTransformer::commandType(const QString &command, const std::vector<QString> &inputs) const
 {
-    if (name.localName(m_np) == QLatin1String("Section")) {
-        m_nsections++;
-        m_sections.push_back(GeogebraSection());
-
-        // Clear stacks
-        m_inputObjectLabels.clear();
-        m_outputObjectLabels.clear();
-        m_currentArgStack.clear();
-        m_objectMap.clear();
-        return;
+    const char *type = nullptr;
+
+    for (const auto &c : simpleCommands)
+        if (command == QLatin1String(c.command))
+            type = c.type;
+
+    if (command == QLatin1String("Line")) {
+        // A line through a point parallel to another line, or a line
+        // through two points
+        bool parallel = false;
+        for (const QString &input : inputs)
+            parallel = parallel || m_commandNames.value(input) == QLatin1String("Line");
+        type = parallel ? "LineParallel" : "LineAB";
+    } else if (command == QLatin1String("Circle")) {
+        /* Separate geogebra's circle-center-point type from compass and circle-center-radius types:
+         * if both the inputs are of point type then the circle is of circle-center-point type (CircleBCPType),
+         * otherwise (CircleBPRType).
+         */
+        if (inputs.size() == 2) {
+            const bool points = m_elementTypes.value(inputs[0]) == QLatin1String("point") && m_elementTypes.value(inputs[1]) == QLatin1String("point");
+            type = points ? "CircleBCP" : "CircleBPR";
+        } else if (inputs.size() == 3)
+            type = "CircleBTP";
+    } else if (command == QLatin1String("Mirror")) {
+        // TODO It cannot open reflection of Polygons.
+        const QString reflector = inputs.size() > 1 ? m_commandNames.value(inputs[1]) : QString();
+        if (reflector == QLatin1String("Line"))
+            type = "LineReflection";
+        else if (reflector == QLatin1String("Circle"))
+            type = "CircularInversion";
+        else
+            type = "PointReflection";
+    } else if (command == QLatin1String("Intersect")) {
+        if (inputs.size() == 2 && m_commandNames.value(inputs[0]) == QLatin1String("Line") && m_commandNames.value(inputs[1]) == QLatin1String("Line"))
+            type = "LineLineIntersection";
     }
+    // Kig can't draw diameters of conics ( ?? )
 
-    switch (m_currentState) {
-    case GeogebraTransformer::ReadingObject:
-        if (m_currentObject) {
-            // We are already building an object
-            m_currentState = GeogebraTransformer::ReadingArguments;
-            startElement(name);
-            return;
-        }
-
-        {
-            resetDrawerVars();
-            const QByteArray nameData = name.localName(m_np).toLatin1();
-            m_currentObject = ObjectTypeFactory::instance()->find(nameData);
-
-            if (!m_currentObject) {
-                qWarning() << name.localName(m_np) << " object not found!";
-            }
-        }
-
-        break;
-    case GeogebraTransformer::ReadingArguments:
-        if (name.localName(m_np) == QLatin1String("Double")) {
-            m_currentState = GeogebraTransformer::ReadingDouble;
-        }
-
-        break;
-    default:
-        break;
-    }
+    return type ? ObjectTypeFactory::instance()->find(type) : nullptr;
 }
 
-void GeogebraTransformer::startOfSequence()
+void GeogebraTransformer::addObject(GeogebraSection &section, const QString &label, const ObjectType *type, const std::vector<ObjectCalcer *> &args)
 {
+    if (m_objectMap.contains(label))
+        return;
+
+    ObjectTypeCalcer *oc = new ObjectTypeCalcer(type, args);
+    oc->calc(*m_document);
+    m_objectMap.insert(label, oc);
+
+    // Decide where to put this object
+    if (m_inputObjectLabels.empty()) {
+        // Not handling input/output objects, put everything in the section,
+        // the drawers follow at the end of the construction
+        section.addOutputObject(oc);
+        m_drawnLabels.push_back(label);
+    } else if (m_inputObjectLabels.contains(label)) {
+        section.addInputObject(oc);
+    } else if (m_outputObjectLabels.contains(label)) {
+        section.addOutputObject(oc);
+    }
 }
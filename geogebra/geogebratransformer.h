@@ -7,10 +7,10 @@
 
 #pragma once
 
-#include <QAbstractXmlReceiver>
-#include <QMap>
+#include <QColor>
+#include <QHash>
 #include <QSet>
-#include <QXmlNamePool>
+#include <QString>
 
 #include <vector>
 
@@ -18,70 +18,75 @@
 #include "geogebrasection.h"
 
 class KigDocument;
-class ObjectHolder;
 class ObjectType;
+class QIODevice;
+class QXmlStreamReader;
 
 /* This class 'transforms' the XML representation of the GeoGebra file into Kig's
  * internal representation of objects ( with proper parent-child relationship ).
+ * The file is read in a single pass, building each object as soon as its
+ * command ( or, for free points, its element ) has been read.
  */
-class GeogebraTransformer : public QAbstractXmlReceiver
+class GeogebraTransformer
 {
 public:
-    GeogebraTransformer(KigDocument *document, const QXmlNamePool &np)
+    explicit GeogebraTransformer(KigDocument *document)
         : m_document(document)
-        , m_currentState(GeogebraTransformer::ReadingObject)
-        , m_currentObject(nullptr)
-        , m_nsections(0)
-        , m_np(np)
     {
     }
     ~GeogebraTransformer()
     {
     }
 
+    /* Read a geogebra.xml ( worksheet ) or geogebra_macro.xml ( tools ) file
+     * from device.  Every construction of a worksheet, and every tool, becomes
+     * a section.  Returns false if the file is not well-formed.
+     */
+    bool read(QIODevice &device);
+    QString errorString() const
+    {
+        return m_errorString;
+    };
+
     size_t getNumberOfSections() const
     {
-        return m_nsections;
+        return m_sections.size();
     };
     const GeogebraSection &getSection(size_t sectionIdx) const
     {
         return m_sections[sectionIdx];
     };
 
-    // QAbstractXmlReceiver implementation
-    void atomicValue(const QVariant &) override;
-    void attribute(const QXmlName &name, const QStringRef &value) override;
-    void characters(const QStringRef &) override;
-    void comment(const QString &) override;
-    void endDocument() override;
-    void endElement() override;
-    void endOfSequence() override;
-    void namespaceBinding(const QXmlName &) override;
-    void processingInstruction(const QXmlName &, const QString &) override;
-    void startDocument() override;
-    void startElement(const QXmlName &name) override;
-    void startOfSequence() override;
-
 private:
-    void resetDrawerVars()
-    {
-        m_show = true;
-        m_thickness = -1;
-        m_pointType = Kig::Round;
-        m_type = Qt::SolidLine;
-        m_r = 0;
-        m_g = 0;
-        m_b = 0;
-        m_alpha = 0;
+    // The style of an object, as found in its <element>
+    struct Style {
+        Style()
+            : show(true)
+            , thickness(-1)
+            , pointType(Kig::Round)
+            , type(Qt::SolidLine)
+            , color(Qt::black)
+        {
+        }
+        bool show;
+        int thickness;
+        Kig::PointStyle pointType;
+        Qt::PenStyle type;
+        QColor color;
     };
 
-private:
-    enum State {
-        ReadingDouble,
-        ReadingObject,
-        ReadingArguments,
-    };
+    void readMacro(QXmlStreamReader &xml);
+    void readConstruction(QXmlStreamReader &xml, GeogebraSection &section);
+    void readCommand(QXmlStreamReader &xml, GeogebraSection &section);
+    void readElement(QXmlStreamReader &xml, GeogebraSection &section);
+
+    /* The Kig type for the GeoGebra command with the given name and input
+     * labels, or 0 if Kig doesn't support that command.
+     */
+    const ObjectType *commandType(const QString &command, const std::vector<QString> &inputs) const;
+    void addObject(GeogebraSection &section, const QString &label, const ObjectType *type, const std::vector<ObjectCalcer *> &args);
 
+private:
     // Enumerations of the Line Styles used by Geogebra
     // The values 0, 10, 15, 20 are the values used by Geogebra to represent the corresponding styles.
     enum {
@@ -107,20 +112,21 @@ private:
     };
 
     KigDocument *m_document;
-    State m_currentState;
-    QMap<QByteArray, ObjectCalcer *> m_objectMap;
-    std::vector<ObjectCalcer *> m_currentArgStack;
-    const ObjectType *m_currentObject;
-    QSet<QByteArray> m_inputObjectLabels;
-    QSet<QByteArray> m_outputObjectLabels;
-    QByteArray m_currentObjectLabel;
     std::vector<GeogebraSection> m_sections;
-    size_t m_nsections;
-    QXmlNamePool m_np;
-    /* members required for constructing the object-drawers*/
-    bool m_show;
-    int m_thickness;
-    Kig::PointStyle m_pointType;
-    Qt::PenStyle m_type;
-    int m_r, m_g, m_b, m_alpha; // m_alpha is causing trouble at the moment as Geogebra somehow generates decimal values for it
+    QString m_errorString;
+
+    /* The state of the construction being read: the objects built so far,
+     * the name of the command each label is the first output of, and the
+     * type of each element.
+     */
+    QHash<QString, ObjectCalcer *> m_objectMap;
+    QHash<QString, QString> m_commandNames;
+    QHash<QString, QString> m_elementTypes;
+    QSet<QString> m_inputObjectLabels;
+    QSet<QString> m_outputObjectLabels;
+    /* The drawers of a worksheet are only built at the end of its construction,
+     * because the element holding the style of an object follows its command.
+     */
+    std::vector<QString> m_drawnLabels;
+    QHash<QString, Style> m_styles;
 };
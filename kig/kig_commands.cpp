@@ -17,7 +17,9 @@
 #include "../objects/object_drawer.h"
 #include "../objects/object_imp.h"
 
+#include <algorithm>
 #include <iterator>
+#include <utility>
 #include <vector>
 
 using std::max;
@@ -156,12 +158,25 @@ RemoveObjectsTask::RemoveObjectsTask(const std::vector<ObjectHolder *> &os)
 
 void RemoveObjectsTask::execute(KigPart &doc)
 {
+    // remember where the objects are, in the order of the document..
+    std::vector<std::pair<std::size_t, ObjectHolder *>> positions;
+    positions.reserve(mobjs.size());
+    for (std::vector<ObjectHolder *>::iterator i = mobjs.begin(); i != mobjs.end(); ++i)
+        positions.push_back(std::make_pair(doc.document().indexOf(*i), *i));
+    std::sort(positions.begin(), positions.end());
+    mindices.clear();
+    for (uint i = 0; i < positions.size(); ++i) {
+        mindices.push_back(positions[i].first);
+        mobjs[i] = positions[i].second;
+    }
     AddObjectsTask::unexecute(doc);
 }
 
 void RemoveObjectsTask::unexecute(KigPart &doc)
 {
-    AddObjectsTask::execute(doc);
+    // ..and put them back there
+    doc._insertObjects(mobjs, mindices);
+    undone = false;
 }
 
 ChangeObjectConstCalcerTask::ChangeObjectConstCalcerTask(ObjectConstCalcer *calcer, ObjectImp *newimp)
@@ -177,9 +192,7 @@ void ChangeObjectConstCalcerTask::execute(KigPart &doc)
 
     std::set<ObjectCalcer *> allchildren = getAllChildren(mcalcer.get());
     std::vector<ObjectCalcer *> allchildrenvect(allchildren.begin(), allchildren.end());
-    allchildrenvect = calcPath(allchildrenvect);
-    for (std::vector<ObjectCalcer *>::iterator i = allchildrenvect.begin(); i != allchildrenvect.end(); ++i)
-        (*i)->calc(doc.document());
+    calcAll(calcPath(allchildrenvect), doc.document());
 }
 
 void ChangeObjectConstCalcerTask::unexecute(KigPart &doc)
@@ -246,9 +259,7 @@ ChangeCoordSystemTask::ChangeCoordSystemTask(CoordinateSystem *s)
 void ChangeCoordSystemTask::execute(KigPart &doc)
 {
     mcs = doc.document().switchCoordinateSystem(mcs);
-    std::vector<ObjectCalcer *> calcpath = calcPath(getAllCalcers(doc.document().objects()));
-    for (std::vector<ObjectCalcer *>::iterator i = calcpath.begin(); i != calcpath.end(); ++i)
-        (*i)->calc(doc.document());
+    calcAll(calcPath(getAllCalcers(doc.document().objects())), doc.document());
     doc.coordSystemChanged(doc.document().coordinateSystem().id());
 }
 
@@ -303,9 +314,7 @@ void ChangeParentsAndTypeTask::execute(KigPart &doc)
     d->o->calc(doc.document());
     std::set<ObjectCalcer *> allchildren = getAllChildren(d->o);
     std::vector<ObjectCalcer *> allchildrenvect(allchildren.begin(), allchildren.end());
-    allchildrenvect = calcPath(allchildrenvect);
-    for (std::vector<ObjectCalcer *>::iterator i = allchildrenvect.begin(); i != allchildrenvect.end(); ++i)
-        (*i)->calc(doc.document());
+    calcAll(calcPath(allchildrenvect), doc.document());
 }
 
 void ChangeParentsAndTypeTask::unexecute(KigPart &doc)
@@ -101,6 +101,10 @@ public:
     explicit RemoveObjectsTask(const std::vector<ObjectHolder *> &os);
     void execute(KigPart &) override;
     void unexecute(KigPart &) override;
+
+private:
+    // where the objects were in the document, increasing
+    std::vector<std::size_t> mindices;
 };
 
 class ChangeObjectConstCalcerTask : public KigCommandTask
@@ -13,19 +13,22 @@
 #include "../objects/point_imp.h"
 #include "../objects/polygon_imp.h"
 
+#include <algorithm>
 #include <assert.h>
 #include <cmath>
 #include <iterator>
 
-KigDocument::KigDocument(const std::set<ObjectHolder *> &objects, CoordinateSystem *coordsystem, bool showgrid, bool showaxes, bool nv)
-    : mobjects(objects)
-    , mcoordsystem(coordsystem)
+thread_local double KigDocument::mcachedparam = 0.0;
+
+KigDocument::KigDocument(const std::vector<ObjectHolder *> &objects, CoordinateSystem *coordsystem, bool showgrid, bool showaxes, bool nv)
+    : mcoordsystem(coordsystem)
     , mshowgrid(showgrid)
     , mshowaxes(showaxes)
     , mnightvision(nv)
     , mcoordinatePrecision(-1)
-    , mcachedparam(0.0)
 {
+    for (std::vector<ObjectHolder *>::const_iterator i = objects.begin(); i != objects.end(); ++i)
+        addObject(*i);
 }
 
 const CoordinateSystem &KigDocument::coordinateSystem() const
@@ -34,14 +37,21 @@ const CoordinateSystem &KigDocument::coordinateSystem() const
     return *mcoordsystem;
 }
 
-const std::vector<ObjectHolder *> KigDocument::objects() const
+const std::vector<ObjectHolder *> &KigDocument::objects() const
 {
-    return std::vector<ObjectHolder *>(mobjects.begin(), mobjects.end());
+    return mobjects;
 }
 
-const std::set<ObjectHolder *> &KigDocument::objectsSet() const
+bool KigDocument::contains(const ObjectHolder *o) const
 {
-    return mobjects;
+    return mindices.find(o) != mindices.end();
+}
+
+std::size_t KigDocument::indexOf(const ObjectHolder *o) const
+{
+    std::unordered_map<const ObjectHolder *, std::size_t>::const_iterator i = mindices.find(o);
+    assert(i != mindices.end());
+    return i->second;
 }
 
 void KigDocument::setCoordinateSystem(CoordinateSystem *s)
@@ -61,7 +71,8 @@ std::vector<ObjectHolder *> KigDocument::whatAmIOn(const Coordinate &p, const Ki
     std::vector<ObjectHolder *> ret;
     std::vector<ObjectHolder *> curves;
     std::vector<ObjectHolder *> fatobjects;
-    for (std::set<ObjectHolder *>::const_iterator i = mobjects.begin(); i != mobjects.end(); ++i) {
+    // the objects drawn last are on top, so they come first..
+    for (std::vector<ObjectHolder *>::const_reverse_iterator i = mobjects.rbegin(); i != mobjects.rend(); ++i) {
         if (!(*i)->contains(p, w, mnightvision))
             continue;
         const ObjectImp *oimp = (*i)->imp();
@@ -82,7 +93,7 @@ std::vector<ObjectHolder *> KigDocument::whatIsInHere(const Rect &p, const KigWi
 {
     std::vector<ObjectHolder *> ret;
     std::vector<ObjectHolder *> nonpoints;
-    for (std::set<ObjectHolder *>::const_iterator i = mobjects.begin(); i != mobjects.end(); ++i) {
+    for (std::vector<ObjectHolder *>::const_iterator i = mobjects.begin(); i != mobjects.end(); ++i) {
         if (!(*i)->inRect(p, w))
             continue;
         if ((*i)->imp()->inherits(PointImp::stype()))
@@ -98,7 +109,7 @@ Rect KigDocument::suggestedRect() const
 {
     bool rectInited = false;
     Rect r(0., 0., 0., 0.);
-    for (std::set<ObjectHolder *>::const_iterator i = mobjects.begin(); i != mobjects.end(); ++i) {
+    for (std::vector<ObjectHolder *>::const_iterator i = mobjects.begin(); i != mobjects.end(); ++i) {
         if ((*i)->shown()) {
             Rect cr = (*i)->imp()->surroundingRect();
             if (!cr.valid())
@@ -126,25 +137,71 @@ Rect KigDocument::suggestedRect() const
 
 void KigDocument::addObject(ObjectHolder *o)
 {
-    mobjects.insert(o);
+    if (mindices.insert(std::make_pair(o, mobjects.size())).second)
+        mobjects.push_back(o);
 }
 
 void KigDocument::addObjects(const std::vector<ObjectHolder *> &os)
 {
     for (std::vector<ObjectHolder *>::const_iterator i = os.begin(); i != os.end(); ++i)
         (*i)->calc(*this);
-    std::copy(os.begin(), os.end(), std::inserter(mobjects, mobjects.begin()));
+    mobjects.reserve(mobjects.size() + os.size());
+    for (std::vector<ObjectHolder *>::const_iterator i = os.begin(); i != os.end(); ++i)
+        addObject(*i);
+}
+
+void KigDocument::insertObjects(const std::vector<ObjectHolder *> &os, const std::vector<std::size_t> &indices)
+{
+    assert(os.size() == indices.size());
+    if (os.empty())
+        return;
+    for (std::vector<ObjectHolder *>::const_iterator i = os.begin(); i != os.end(); ++i)
+        (*i)->calc(*this);
+    // merge them into the others in one pass, and only renumber the
+    // objects from the first one inserted..
+    const std::size_t first = indices.front();
+    assert(first <= mobjects.size());
+    std::vector<ObjectHolder *> rest(mobjects.begin() + first, mobjects.end());
+    mobjects.resize(first);
+    mobjects.reserve(first + rest.size() + os.size());
+    std::vector<ObjectHolder *>::const_iterator r = rest.begin();
+    for (std::size_t i = 0; i < os.size(); ++i) {
+        assert(i == 0 || indices[i - 1] < indices[i]);
+        while (mobjects.size() < indices[i] && r != rest.end())
+            mobjects.push_back(*r++);
+        assert(mindices.find(os[i]) == mindices.end());
+        mobjects.push_back(os[i]);
+    }
+    mobjects.insert(mobjects.end(), r, rest.end());
+    for (std::size_t i = first; i < mobjects.size(); ++i)
+        mindices[mobjects[i]] = i;
 }
 
 void KigDocument::delObject(ObjectHolder *o)
 {
-    mobjects.erase(o);
+    std::vector<ObjectHolder *> os;
+    os.push_back(o);
+    delObjects(os);
 }
 
 void KigDocument::delObjects(const std::vector<ObjectHolder *> &os)
 {
-    for (std::vector<ObjectHolder *>::const_iterator i = os.begin(); i != os.end(); ++i)
-        mobjects.erase(*i);
+    // remove them in one pass, keeping the order of the others, and
+    // only renumber the objects after the first one removed..
+    std::size_t first = mobjects.size();
+    for (std::vector<ObjectHolder *>::const_iterator i = os.begin(); i != os.end(); ++i) {
+        std::unordered_map<const ObjectHolder *, std::size_t>::iterator j = mindices.find(*i);
+        if (j == mindices.end())
+            continue;
+        first = std::min(first, j->second);
+        mobjects[j->second] = nullptr;
+        mindices.erase(j);
+    }
+    if (first == mobjects.size())
+        return;
+    mobjects.erase(std::remove(mobjects.begin() + first, mobjects.end(), nullptr), mobjects.end());
+    for (std::size_t i = first; i < mobjects.size(); ++i)
+        mindices[mobjects[i]] = i;
 }
 
 KigDocument::KigDocument()
@@ -158,8 +215,7 @@ KigDocument::KigDocument()
 
 KigDocument::~KigDocument()
 {
-    typedef std::set<ObjectHolder *> s;
-    for (s::iterator i = mobjects.begin(); i != mobjects.end(); ++i) {
+    for (std::vector<ObjectHolder *>::iterator i = mobjects.begin(); i != mobjects.end(); ++i) {
         delete *i;
     }
     delete mcoordsystem;
@@ -233,7 +289,7 @@ int KigDocument::getCoordinatePrecision() const
 std::vector<ObjectCalcer *> KigDocument::findIntersectionPoints(const ObjectCalcer *c1, const ObjectCalcer *c2) const
 {
     std::vector<ObjectCalcer *> ret;
-    for (std::set<ObjectHolder *>::const_iterator i = mobjects.begin(); i != mobjects.end(); ++i) {
+    for (std::vector<ObjectHolder *>::const_iterator i = mobjects.begin(); i != mobjects.end(); ++i) {
         if (!(*i)->imp()->inherits(PointImp::stype()))
             continue;
         ObjectCalcer *o = (*i)->calcer();
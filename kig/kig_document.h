@@ -5,6 +5,7 @@
 #pragma once
 
 #include <set>
+#include <unordered_map>
 #include <vector>
 
 class Coordinate;
@@ -26,8 +27,14 @@ class KigDocument
      * objects that the user is aware of.  Other objects exist as well,
      * but there's no ObjectHolder for them, and they only exist because
      * some other ObjectCalcer has them as its ancestor.
+     * They are kept in the order in which they were added, which is
+     * the order in which they are drawn, and saved.
      */
-    std::set<ObjectHolder *> mobjects;
+    std::vector<ObjectHolder *> mobjects;
+    /**
+     * The index of every object in mobjects.
+     */
+    std::unordered_map<const ObjectHolder *, std::size_t> mindices;
 
     /**
      * The CoordinateSystem as the user sees it: this has little to do
@@ -55,11 +62,16 @@ class KigDocument
     int mcoordinatePrecision;
 
 public:
-    mutable double mcachedparam;
+    /**
+     * The parameter of the last point calculated on a curve, which
+     * CurveImp::getParam() tries first.  calcAll() calculates on
+     * several threads at once, so every thread has one of its own.
+     */
+    static thread_local double mcachedparam;
 
 public:
     KigDocument();
-    KigDocument(const std::set<ObjectHolder *> &objects, CoordinateSystem *coordsystem, bool showgrid = true, bool showaxes = true, bool nv = false);
+    KigDocument(const std::vector<ObjectHolder *> &objects, CoordinateSystem *coordsystem, bool showgrid = true, bool showaxes = true, bool nv = false);
     ~KigDocument();
 
     const CoordinateSystem &coordinateSystem() const;
@@ -69,10 +81,21 @@ public:
     bool isUserSpecifiedCoordinatePrecision() const;
     int getCoordinatePrecision() const;
     /**
-     * Get a hold of the objects of this KigDocument.
+     * Get a hold of the objects of this KigDocument, in the order in
+     * which they are drawn: objects added later are drawn on top of the
+     * ones added before them.  The reference is valid until objects are
+     * added or removed.
+     */
+    const std::vector<ObjectHolder *> &objects() const;
+    /**
+     * Return whether \p o is one of the objects of this KigDocument.
+     */
+    bool contains(const ObjectHolder *o) const;
+    /**
+     * Return the index of \p o in objects(), \p o must be one of the
+     * objects of this KigDocument.
      */
-    const std::vector<ObjectHolder *> objects() const;
-    const std::set<ObjectHolder *> &objectsSet() const;
+    std::size_t indexOf(const ObjectHolder *o) const;
 
     /**
      * sets the coordinate system to \p s , and returns the old one.
@@ -102,7 +125,9 @@ public:
     void setCoordinatePrecision(int precision);
 
     /**
-     * Return a vector of objects that contain the given point.
+     * Return a vector of objects that contain the given point.  The
+     * points come first, then the other objects, and then the filled
+     * polygons, and each of these comes topmost first.
      */
     std::vector<ObjectHolder *> whatAmIOn(const Coordinate &p, const KigWidget &w) const;
 
@@ -118,13 +143,20 @@ public:
     Rect suggestedRect() const;
 
     /**
-     * Add the objects \p o to the document.
+     * Add the objects \p o to the document, on top of the others.
      */
     void addObject(ObjectHolder *oObject);
     /**
      * Add the objects \p os to the document.
      */
     void addObjects(const std::vector<ObjectHolder *> &os);
+    /**
+     * Add the objects \p os to the document, each of them at the index
+     * in \p indices that it has in objects() afterwards.  The indices
+     * must be increasing.  This puts objects that were removed back
+     * where they were.
+     */
+    void insertObjects(const std::vector<ObjectHolder *> &os, const std::vector<std::size_t> &indices);
     /**
      * Remove the object \p o from the document.
      */
@@ -16,40 +16,61 @@
 
 #include "../filters/exporter.h"
 #include "../filters/filter.h"
+#include "../filters/native-filter.h"
 #include "../misc/builtin_stuff.h"
+#include "../misc/calcprofiler.h"
+#include "../misc/calcprofilerview.h"
 #include "../misc/calcpaths.h"
 #include "../misc/coordinate_system.h"
 #include "../misc/guiaction.h"
 #include "../misc/kigcoordinateprecisiondialog.h"
 #include "../misc/kigpainter.h"
+#include "../misc/kigtrace.h"
 #include "../misc/lists.h"
 #include "../misc/object_constructor.h"
 #include "../misc/screeninfo.h"
 #include "../modes/normal.h"
 #include "../objects/object_drawer.h"
 #include "../objects/point_imp.h"
+#ifdef KIG_ENABLE_PYTHON_SCRIPTING
+#include "../scripting/scriptcostsdialog.h"
+#endif
 
 #include <algorithm>
 #include <functional>
 #include <iterator>
 
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
 #include <QDirIterator>
 #include <QFile>
 #include <QFileDialog>
+#include <QImage>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QLocale>
+#include <QLockFile>
+#include <QMainWindow>
 #include <QMimeDatabase>
 #include <QMimeType>
 #include <QPrintDialog>
 #include <QPrintPreviewDialog>
 #include <QPrinter>
+#include <QSaveFile>
 #include <QStandardPaths>
 #include <QTimer>
+#include <QUndoStack>
+#include <QUuid>
 
 #include <KActionCollection>
+#include <KConfigGroup>
 #include <KIconEngine>
 #include <KIconLoader>
 #include <KMessageBox>
 #include <KParts/OpenUrlArguments>
 #include <KPluginFactory>
+#include <KSharedConfig>
 #include <KStandardAction>
 #include <KToggleAction>
 #include <KUndoActions>
@@ -171,6 +192,9 @@ KigPart::KigPart(QObject *parent, const KPluginMetaData &data)
     , mMode(nullptr)
     , mRememberConstruction(nullptr)
     , mdocument(new KigDocument())
+    , mautosavelock(nullptr)
+    , mchanges(0)
+    , mautosavedchanges(0)
 {
     mMode = new NormalMode(*this);
 
@@ -194,12 +218,25 @@ KigPart::KigPart(QObject *parent, const KPluginMetaData &data)
     KUndoActions::createUndoAction(mhistory, actionCollection());
     KUndoActions::createRedoAction(mhistory, actionCollection());
     connect(mhistory, &QUndoStack::cleanChanged, this, &KigPart::setHistoryClean);
+    connect(mhistory, &QUndoStack::indexChanged, this, [this]() {
+        ++mchanges;
+    });
 
     // we are read-write by default
     setReadWrite(true);
 
     setModified(false);
 
+    // autosave every few minutes ( two, unless configured otherwise, 0
+    // means never ), one file at a time
+    mautosavepool.setMaxThreadCount(1);
+    mautosavetimer = new QTimer(this);
+    connect(mautosavetimer, &QTimer::timeout, this, &KigPart::autoSave);
+    const int autosaveinterval = KSharedConfig::openConfig()->group("Autosave").readEntry("Interval", 2);
+    if (autosaveinterval > 0)
+        mautosavetimer->start(autosaveinterval * 60 * 1000);
+    QTimer::singleShot(0, this, &KigPart::recoverUntitled);
+
     GUIActionList::instance()->regDoc(this);
 }
 
@@ -263,6 +300,18 @@ void KigPart::setupActions()
     connect(aBrowseHistory, &QAction::triggered, this, &KigPart::browseHistory);
     aBrowseHistory->setToolTip(i18n("Browse the history of the current construction."));
 
+    aToggleProfiler = new KToggleAction(QIcon::fromTheme(QStringLiteral("chronometer")), i18n("Show &Profiler"), this);
+    actionCollection()->addAction(QStringLiteral("tools_profiler"), aToggleProfiler);
+    aToggleProfiler->setToolTip(i18n("Show how long the calculations of the objects take."));
+    connect(aToggleProfiler, &QAction::triggered, this, &KigPart::toggleProfiler);
+
+#ifdef KIG_ENABLE_PYTHON_SCRIPTING
+    QAction *aScriptCosts = new QAction(QIcon::fromTheme(QStringLiteral("text-x-python")), i18n("Python Script &Costs..."), this);
+    actionCollection()->addAction(QStringLiteral("tools_script_costs"), aScriptCosts);
+    connect(aScriptCosts, &QAction::triggered, this, &KigPart::showScriptCosts);
+    aScriptCosts->setToolTip(i18n("Show how long the Python scripts of the construction take to calculate."));
+#endif
+
     KigExportManager::instance()->addMenuAction(this, m_widget->realWidget(), actionCollection());
 
     QAction *a = KStandardAction::zoomIn(m_widget, SLOT(slotZoomIn()), actionCollection());
@@ -356,12 +405,19 @@ KigPart::~KigPart()
     // save our types...
     saveTypes();
 
+    // the document is closed cleanly, so its autosave is not needed
+    // anymore
+    removeAutoSave();
+
     // objects get deleted automatically, when mobjsref gets
     // destructed..
 
     delete_all(aActions.begin(), aActions.end());
     aActions.clear();
 
+    // the profiler view lives in the main window, but refers to us
+    delete mprofilerview;
+
     // cleanup
     delete mMode;
     delete mhistory;
@@ -371,6 +427,7 @@ KigPart::~KigPart()
 
 bool KigPart::openFile()
 {
+    KigTrace::Span span("load", "KigPart::openFile", localFilePath());
     QFileInfo fileinfo(localFilePath());
     if (!fileinfo.exists()) {
         KMessageBox::error(widget(),
@@ -407,6 +464,32 @@ bool KigPart::openFile()
         setUrl(QUrl());
         return false;
     }
+    removeAutoSave();
+    setDocument(newdoc);
+
+    // if Kig crashed while this file was being edited, the autosave is
+    // newer than the file.  The user is only asked about it once the
+    // document is shown, and not from inside openFile(), whose callers
+    // don't expect a dialog.
+    const QString autosave = autoSaveFile(fileinfo.absoluteFilePath());
+    if (QFileInfo(autosave).lastModified() > fileinfo.lastModified()) {
+        const QUrl opened = url();
+        const QString question = i18n("Kig found unsaved changes to \"%1\" from a session that ended unexpectedly. "
+                                      "Do you want to recover them?",
+                                      localFilePath());
+        QTimer::singleShot(0, this, [this, opened, autosave, question]() {
+            // unless another file was opened, or this one changed, in the
+            // meantime
+            if (url() == opened && !isModified())
+                recoverAutoSave(autosave, question);
+        });
+    }
+
+    return true;
+}
+
+void KigPart::setDocument(KigDocument *newdoc)
+{
     delete mdocument;
     mdocument = newdoc;
     coordSystemChanged(mdocument->coordinateSystem().id());
@@ -417,24 +500,21 @@ bool KigPart::openFile()
     setModified(false);
     mhistory->clear();
 
-    std::vector<ObjectCalcer *> tmp = calcPath(getAllParents(getAllCalcers(document().objects())));
-    for (std::vector<ObjectCalcer *>::iterator i = tmp.begin(); i != tmp.end(); ++i)
-        (*i)->calc(document());
+    calcAll(calcPath(getAllParents(getAllCalcers(document().objects()))), document());
     Q_EMIT recenterScreen();
 
     redrawScreen();
-
-    return true;
 }
 
 bool KigPart::saveFile()
 {
+    KigTrace::Span span("save", "KigPart::saveFile", localFilePath());
     if (url().isEmpty())
         return internalSaveAs();
     // mimetype:
     const QMimeDatabase mimeDb;
     const QMimeType mimeType = mimeDb.mimeTypeForFile(localFilePath());
-    if (mimeType.name() != QLatin1String("application/x-kig")) {
+    if (mimeType.name() != QLatin1String("application/x-kig") && mimeType.name() != QLatin1String("application/x-kig-binary")) {
         // we don't support this mime type...
 #if KWIDGETSADDONS_VERSION >= QT_VERSION_CHECK(5, 100, 0)
         if (KMessageBox::warningTwoActions(widget(),
@@ -473,6 +553,7 @@ bool KigPart::saveFile()
     if (KigFilters::instance()->save(document(), localFilePath())) {
         setModified(false);
         mhistory->setClean();
+        removeAutoSave();
         return true;
     }
     return false;
@@ -548,6 +629,12 @@ void KigPart::_addObjects(const std::vector<ObjectHolder *> &os)
     setModified(true);
 }
 
+void KigPart::_insertObjects(const std::vector<ObjectHolder *> &os, const std::vector<std::size_t> &indices)
+{
+    document().insertObjects(os, indices);
+    setModified(true);
+}
+
 void KigPart::deleteObjects()
 {
     mode()->deleteObjects();
@@ -610,11 +697,163 @@ void KigPart::browseHistory()
     mode()->browseHistory();
 }
 
+void KigPart::toggleProfiler()
+{
+    if (!mprofilerview) {
+        QMainWindow *mainwindow = qobject_cast<QMainWindow *>(m_widget->window());
+        mprofilerview = new CalcProfilerView(*this, mainwindow ? static_cast<QWidget *>(mainwindow) : m_widget);
+        if (mainwindow)
+            mainwindow->addDockWidget(Qt::BottomDockWidgetArea, mprofilerview);
+        else
+            mprofilerview->setFloating(true);
+        connect(mprofilerview, &QDockWidget::visibilityChanged, aToggleProfiler, &QAction::setChecked);
+    }
+    mprofilerview->setVisible(aToggleProfiler->isChecked());
+}
+
+void KigPart::showScriptCosts()
+{
+#ifdef KIG_ENABLE_PYTHON_SCRIPTING
+    ScriptCostsDialog d(document().objects(), m_widget);
+    d.exec();
+    if (d.changed()) {
+        // run the scripts again, with the new budget or statistics.  The
+        // compiled scripts are not among the objects' calcers, they keep
+        // their statistics..
+        calcAll(calcPath(getAllCalcers(document().objects())), document());
+        redrawScreen();
+    }
+#endif
+}
+
 void KigPart::setHistoryClean(bool clean)
 {
     setModified(!clean);
 }
 
+QString KigPart::autoSaveFile(const QString &path)
+{
+    const QString dir = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + QLatin1String("/autosave/");
+    // untitled documents get a name of their own, documents with a file
+    // get one that can be found again from the file name
+    if (path.isEmpty())
+        return dir + QLatin1String("untitled-") + QUuid::createUuid().toString(QUuid::WithoutBraces) + QLatin1String(".kigb");
+    return dir + QString::fromLatin1(QCryptographicHash::hash(path.toUtf8(), QCryptographicHash::Sha1).toHex()) + QLatin1String(".kigb");
+}
+
+void KigPart::autoSave()
+{
+    if (!isReadWrite() || !isModified() || mchanges == mautosavedchanges)
+        return;
+
+    if (mautosavefile.isEmpty()) {
+        const QString file = autoSaveFile(url().isLocalFile() ? QFileInfo(localFilePath()).absoluteFilePath() : QString());
+        QDir().mkpath(QFileInfo(file).absolutePath());
+        QLockFile *lock = new QLockFile(file + QLatin1String(".lock"));
+        lock->setStaleLockTime(0);
+        if (!lock->tryLock(0)) {
+            // another Kig is editing the same file, and autosaves it
+            delete lock;
+            return;
+        }
+        mautosavelock = lock;
+        mautosavefile = file;
+    }
+
+    // only a copy of the document is taken here, it is serialized and
+    // written on the autosave thread, so that neither a large document
+    // nor a slow disk blocks the user
+    std::shared_ptr<const KigDocumentSnapshot> snapshot = KigFilterNative::instance()->snapshot(document());
+    const QString file = mautosavefile;
+    mautosavepool.start([snapshot, file]() {
+        const QByteArray data = KigFilterNative::instance()->serialize(*snapshot);
+        QSaveFile f(file);
+        if (f.open(QIODevice::WriteOnly) && f.write(data) == data.size())
+            f.commit();
+    });
+    mautosavedchanges = mchanges;
+}
+
+void KigPart::removeAutoSave()
+{
+    // wait for the last autosave, so that it can't recreate the file
+    mautosavepool.waitForDone();
+    if (mautosavefile.isEmpty())
+        return;
+    QFile::remove(mautosavefile);
+    delete mautosavelock;
+    mautosavelock = nullptr;
+    mautosavefile.clear();
+    mautosavedchanges = mchanges;
+}
+
+bool KigPart::recoverAutoSave(const QString &file, const QString &question)
+{
+    if (!QFile::exists(file))
+        return false;
+    // the lock of an autosave is only free if the Kig that wrote it is
+    // not running anymore
+    QLockFile *lock = new QLockFile(file + QLatin1String(".lock"));
+    lock->setStaleLockTime(0);
+    if (!lock->tryLock(0)) {
+        delete lock;
+        return false;
+    }
+
+#if KWIDGETSADDONS_VERSION >= QT_VERSION_CHECK(5, 100, 0)
+    if (KMessageBox::questionTwoActions(widget(),
+#else
+    if (KMessageBox::questionYesNo(widget(),
+#endif
+                                        question,
+                                        i18n("Recover Document"),
+                                        KGuiItem(i18n("Recover")),
+                                        KStandardGuiItem::discard())
+#if KWIDGETSADDONS_VERSION >= QT_VERSION_CHECK(5, 100, 0)
+        == KMessageBox::ButtonCode::SecondaryAction) {
+#else
+        == KMessageBox::No) {
+#endif
+        QFile::remove(file);
+        delete lock;
+        return false;
+    }
+
+    KigDocument *newdoc = KigFilterNative::instance()->load(file);
+    if (!newdoc) {
+        delete lock;
+        return false;
+    }
+    removeAutoSave();
+    setDocument(newdoc);
+    // the recovered changes are not saved yet, and go on being
+    // autosaved to the same file
+    setModified(true);
+    mautosavelock = lock;
+    mautosavefile = file;
+    return true;
+}
+
+void KigPart::recoverUntitled()
+{
+    // if a file was opened in the meantime, or this part is only used
+    // for viewing, there is nothing to recover into
+    if (!isReadWrite() || !url().isEmpty() || isModified())
+        return;
+
+    const QString dir = QFileInfo(autoSaveFile(QString())).absolutePath();
+    QDirIterator it(dir, QStringList() << QStringLiteral("untitled-*.kigb"), QDir::Files);
+    while (it.hasNext()) {
+        const QString file = it.next();
+        const QString date = QLocale().toString(it.fileInfo().lastModified(), QLocale::ShortFormat);
+        if (recoverAutoSave(file,
+                            i18n("Kig found an untitled document, last changed on %1, from a session that ended unexpectedly. "
+                                 "Do you want to recover it?",
+                                 date)))
+            return;
+    }
+}
+
 void KigPart::setCoordinatePrecision()
 {
     KigCoordinatePrecisionDialog dlg(document().isUserSpecifiedCoordinatePrecision(), document().getCoordinatePrecision());
@@ -635,25 +874,18 @@ void KigPart::delObjects(const std::vector<ObjectHolder *> &os)
 {
     if (os.size() < 1)
         return;
-    std::set<ObjectHolder *> delobjs;
-
     std::set<ObjectCalcer *> delcalcers = getAllChildren(getAllCalcers(os));
-    std::map<ObjectCalcer *, ObjectHolder *> holdermap;
 
-    std::set<ObjectHolder *> curobjs = document().objectsSet();
+    // the objects are collected in the order of the document, so that
+    // undoing puts them back in it
+    std::vector<ObjectHolder *> delobjsvect;
+    const std::vector<ObjectHolder *> &curobjs = document().objects();
+    for (std::vector<ObjectHolder *>::const_iterator i = curobjs.begin(); i != curobjs.end(); ++i)
+        if (delcalcers.find((*i)->calcer()) != delcalcers.end())
+            delobjsvect.push_back(*i);
 
-    for (std::set<ObjectHolder *>::iterator i = curobjs.begin(); i != curobjs.end(); ++i)
-        holdermap[(*i)->calcer()] = *i;
+    assert(delobjsvect.size() >= os.size());
 
-    for (std::set<ObjectCalcer *>::iterator i = delcalcers.begin(); i != delcalcers.end(); ++i) {
-        std::map<ObjectCalcer *, ObjectHolder *>::iterator j = holdermap.find(*i);
-        if (j != holdermap.end())
-            delobjs.insert(j->second);
-    }
-
-    assert(delobjs.size() >= os.size());
-
-    std::vector<ObjectHolder *> delobjsvect(delobjs.begin(), delobjs.end());
     mhistory->push(KigCommand::removeCommand(*this, delobjsvect));
 }
 
@@ -702,7 +934,7 @@ void KigPart::fileSave()
 bool KigPart::internalSaveAs()
 {
     // this slot is connected to the KStandardAction::saveAs action...
-    QString formats = i18n("Kig Documents (*.kig);;Compressed Kig Documents (*.kigz)");
+    QString formats = i18n("Kig Documents (*.kig);;Compressed Kig Documents (*.kigz);;Binary Kig Documents (*.kigb)");
     QString currentDir = url().toLocalFile();
 
     if (currentDir.isNull()) {
@@ -793,18 +1025,21 @@ void KigPart::setupMacroTypes()
     static bool alreadysetup = false;
     if (!alreadysetup) {
         alreadysetup = true;
+        KigTrace::Span span("macros", "KigPart::setupMacroTypes");
 
         // the user's saved macro types:
         const QStringList dataFiles = getDataFiles(QStringLiteral("kig-types"));
         std::vector<Macro *> macros;
         for (QStringList::const_iterator file = dataFiles.begin(); file != dataFiles.end(); ++file) {
             std::vector<Macro *> nmacros;
-            bool ok = MacroList::instance()->load(*file, nmacros, *this);
+            bool ok = MacroList::instance()->loadCached(*file, nmacros, *this);
             if (!ok)
                 continue;
             copy(nmacros.begin(), nmacros.end(), back_inserter(macros));
         }
         MacroList::instance()->add(macros);
+        // the builtin macro's are loaded by now too
+        MacroList::instance()->saveCache();
     };
     // hack: we need to plug the action lists _after_ the gui is
     // built. I can't find a better solution than this.
@@ -816,26 +1051,29 @@ void KigPart::setupBuiltinMacros()
     static bool alreadysetup = false;
     if (!alreadysetup) {
         alreadysetup = true;
+        KigTrace::Span span("macros", "KigPart::setupBuiltinMacros");
         // builtin macro types ( we try to make the user think these are
-        // normal types )..
+        // normal types )..  The actions are registered all at once, so
+        // that the open documents only update their GUI once.
         const QStringList builtinfiles = getDataFiles(QStringLiteral("builtin-macros"));
+        std::vector<GUIAction *> actions;
         for (QStringList::const_iterator file = builtinfiles.begin(); file != builtinfiles.end(); ++file) {
             std::vector<Macro *> macros;
-            bool ok = MacroList::instance()->load(*file, macros, *this);
+            bool ok = MacroList::instance()->loadCached(*file, macros, *this);
             if (!ok)
                 continue;
             for (uint i = 0; i < macros.size(); ++i) {
                 ObjectConstructorList *ctors = ObjectConstructorList::instance();
-                GUIActionList *actions = GUIActionList::instance();
                 Macro *macro = macros[i];
                 macro->ctor->setBuiltin(true);
                 ctors->add(macro->ctor);
-                actions->add(macro->action);
+                actions.push_back(macro->action);
                 macro->ctor = nullptr;
                 macro->action = nullptr;
                 delete macro;
             };
         };
+        GUIActionList::instance()->add(actions);
     };
 }
 
@@ -975,14 +1213,13 @@ KigDocument &KigPart::document()
     return *mdocument;
 }
 
-extern "C" KIGPART_EXPORT int convertToNative(const QUrl &url, const QByteArray &outfile)
+// load a document for the command line option option, and calculate it
+static KigDocument *loadForCommandLine(const QUrl &url, const char *option)
 {
-    qDebug() << "converting " << url.toDisplayString(QUrl::PrettyDecoded) << " to " << outfile;
-
     if (!url.isLocalFile()) {
         // TODO
-        qCritical() << "--convert-to-native only supports local files for now.";
-        return -1;
+        qCritical() << option << "only supports local files for now.";
+        return nullptr;
     }
 
     QString file = url.toLocalFile();
@@ -990,7 +1227,7 @@ extern "C" KIGPART_EXPORT int convertToNative(const QUrl &url, const QByteArray
     QFileInfo fileinfo(file);
     if (!fileinfo.exists()) {
         qCritical() << "The file \"" << file << "\" does not exist";
-        return -1;
+        return nullptr;
     };
 
     const QMimeDatabase mimeDb;
@@ -999,20 +1236,28 @@ extern "C" KIGPART_EXPORT int convertToNative(const QUrl &url, const QByteArray
     KigFilter *filter = KigFilters::instance()->find(mimeType.name());
     if (!filter) {
         qCritical() << "The file \"" << file << "\" is of a filetype not currently supported by Kig.";
-        return -1;
+        return nullptr;
     };
 
     KigDocument *doc = filter->load(file);
     if (!doc) {
         qCritical() << "Parse error in file \"" << file << "\".";
-        return -1;
+        return nullptr;
     }
 
     std::vector<ObjectCalcer *> tmp = calcPath(getAllParents(getAllCalcers(doc->objects())));
-    for (std::vector<ObjectCalcer *>::iterator i = tmp.begin(); i != tmp.end(); ++i)
-        (*i)->calc(*doc);
-    for (std::vector<ObjectCalcer *>::iterator i = tmp.begin(); i != tmp.end(); ++i)
-        (*i)->calc(*doc);
+    calcAll(tmp, *doc);
+    calcAll(tmp, *doc);
+    return doc;
+}
+
+extern "C" KIGPART_EXPORT int convertToNative(const QUrl &url, const QByteArray &outfile)
+{
+    qDebug() << "converting " << url.toDisplayString(QUrl::PrettyDecoded) << " to " << outfile;
+
+    KigDocument *doc = loadForCommandLine(url, "--convert-to-native");
+    if (!doc)
+        return -1;
 
     QString out = (outfile == "-") ? QString() : outfile;
     bool success = KigFilters::instance()->save(*doc, out);
@@ -1026,6 +1271,44 @@ extern "C" KIGPART_EXPORT int convertToNative(const QUrl &url, const QByteArray
     return 0;
 }
 
+extern "C" KIGPART_EXPORT int profileDocument(const QUrl &url, const QByteArray &outfile)
+{
+    KigDocument *doc = loadForCommandLine(url, "--profile");
+    if (!doc)
+        return -1;
+
+    // one more calculation of the whole document, and a drawing of it
+    // as it is shown when it's opened..
+    CalcProfiler::instance()->setEnabled(true);
+    calcAll(calcPath(getAllParents(getAllCalcers(doc->objects()))), *doc);
+    QImage img(800, 600, QImage::Format_RGB32);
+    img.fill(Qt::white);
+    {
+        KigPainter p(ScreenInfo(doc->suggestedRect(), img.rect()), &img, *doc, false);
+        p.drawGrid(doc->coordinateSystem(), doc->grid(), doc->axes());
+        p.drawObjects(doc->objects(), false);
+    }
+    CalcProfiler::instance()->setEnabled(false);
+
+    QFile file;
+    bool opened;
+    if (outfile == "-")
+        opened = file.open(stdout, QIODevice::WriteOnly);
+    else {
+        file.setFileName(QString::fromLocal8Bit(outfile));
+        opened = file.open(QIODevice::WriteOnly);
+    }
+    if (!opened || file.write(QJsonDocument(CalcProfiler::instance()->toJson()).toJson()) < 0) {
+        qCritical() << "something went wrong while writing the profile";
+        delete doc;
+        return -1;
+    }
+
+    delete doc;
+
+    return 0;
+}
+
 void KigPart::toggleGrid()
 {
     bool toshow = !mdocument->grid();
@@ -8,6 +8,8 @@
 #pragma once
 
 #include <QList>
+#include <QPointer>
+#include <QThreadPool>
 
 #include <KParts/ReadWritePart>
 #include <KSelectAction>
@@ -18,8 +20,11 @@
 
 #include <vector>
 
+class CalcProfilerView;
 class KAboutData;
 class KToggleAction;
+class QLockFile;
+class QTimer;
 class QUndoStack;
 class QWidget;
 class QPrinter;
@@ -114,6 +119,8 @@ public Q_SLOTS:
     void newMacro();
     void editTypes();
     void browseHistory();
+    void showScriptCosts();
+    void toggleProfiler();
 
     void toggleGrid();
     void toggleAxes();
@@ -123,6 +130,19 @@ public Q_SLOTS:
 
     void setCoordinatePrecision();
 
+    /**
+     * write a snapshot of the document to its autosave file, if it
+     * changed since the last one.  Called periodically by
+     * mautosavetimer.
+     */
+    void autoSave();
+
+    /**
+     * offer to recover an untitled document whose Kig session ended
+     * unexpectedly.  Called once, right after the part is created.
+     */
+    void recoverUntitled();
+
     /****************** cooperation with stuff ******************/
 public:
     void addWidget(KigWidget *);
@@ -160,6 +180,9 @@ public:
 
     void _addObject(ObjectHolder *inObject);
     void _addObjects(const std::vector<ObjectHolder *> &o);
+    // puts removed objects back where they were, see
+    // KigDocument::insertObjects()
+    void _insertObjects(const std::vector<ObjectHolder *> &o, const std::vector<std::size_t> &indices);
     void _delObject(ObjectHolder *inObject);
     void _delObjects(const std::vector<ObjectHolder *> &o);
 
@@ -189,6 +212,29 @@ public:
 protected:
     bool internalSaveAs();
 
+    /**
+     * take ownership of the document \p newdoc, and show it in the
+     * views.  This is what openFile() does after loading a file.
+     */
+    void setDocument(KigDocument *newdoc);
+
+    /**
+     * the file the autosave of the document at \p path ( an empty path
+     * for an untitled document ) goes to.
+     */
+    static QString autoSaveFile(const QString &path);
+    /**
+     * if \p file is an autosave whose Kig session ended unexpectedly,
+     * ask the user whether to recover it, and do so.  The autosave is
+     * removed if the user doesn't want it.
+     */
+    bool recoverAutoSave(const QString &file, const QString &question);
+    /**
+     * stop autosaving to the current autosave file, and remove it.
+     * Called when the document is saved, or replaced by another one.
+     */
+    void removeAutoSave();
+
 protected:
     void setupActions();
     void setupTypes();
@@ -237,6 +283,7 @@ public:
     KToggleAction *aToggleGrid;
     KToggleAction *aToggleAxes;
     KToggleAction *aToggleNightVision;
+    KToggleAction *aToggleProfiler;
     std::vector<KigGUIAction *> aActions;
 
     /**
@@ -283,6 +330,28 @@ protected:
      */
     std::vector<ObjectHolder *> mcurrentObjectGroup;
 
+    /**
+     * autosave: every few minutes, autoSave() takes a copy of the
+     * document on the GUI thread ( which is cheap, see
+     * KigFilterNative::snapshot() ), and serializes it and writes it to
+     * mautosavefile on mautosavepool's thread.  mautosavelock marks the autosave file
+     * as belonging to a running Kig, so that the next Kig can tell the
+     * autosaves of crashed sessions apart.
+     */
+    QTimer *mautosavetimer;
+    QThreadPool mautosavepool;
+    QLockFile *mautosavelock;
+
+    // the profiler dock, created when it is first shown
+    QPointer<CalcProfilerView> mprofilerview;
+    QString mautosavefile;
+    /**
+     * the number of changes to the history so far, and that number at
+     * the time of the last autosave
+     */
+    int mchanges;
+    int mautosavedchanges;
+
 public:
     const KigDocument &document() const;
     KigDocument &document();
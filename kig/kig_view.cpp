@@ -10,6 +10,7 @@
 #include "../misc/coordinate_system.h"
 #include "../misc/kiginputdialog.h"
 #include "../misc/kigpainter.h"
+#include "../misc/kigtrace.h"
 #include "../modes/dragrectmode.h"
 #include "../modes/mode.h"
 #include "kig_commands.h"
@@ -218,17 +219,19 @@ void KigWidget::clearStillPix()
 
 void KigWidget::redrawScreen(const std::vector<ObjectHolder *> &_selection, bool dos)
 {
+    KigTrace::Span span("render", "KigWidget::redrawScreen");
     std::vector<ObjectHolder *> nonselection;
-    std::vector<ObjectHolder *> selection = _selection;
-    std::set<ObjectHolder *> objs = mpart->document().objectsSet();
-    std::sort(selection.begin(), selection.end());
-    std::set_difference(objs.begin(), objs.end(), selection.begin(), selection.end(), std::back_inserter(nonselection));
+    const std::set<ObjectHolder *> selection(_selection.begin(), _selection.end());
+    const std::vector<ObjectHolder *> &objs = mpart->document().objects();
+    for (std::vector<ObjectHolder *>::const_iterator i = objs.begin(); i != objs.end(); ++i)
+        if (selection.find(*i) == selection.end())
+            nonselection.push_back(*i);
 
     // update the screen...
     clearStillPix();
     KigPainter p(msi, &stillPix, mpart->document());
     p.drawGrid(mpart->document().coordinateSystem(), mpart->document().grid(), mpart->document().axes());
-    p.drawObjects(selection, true);
+    p.drawObjects(selection.begin(), selection.end(), true);
     p.drawObjects(nonselection, false);
     updateCurPix(p.overlay());
     if (dos)
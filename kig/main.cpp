@@ -21,12 +21,14 @@
 #include "aboutdata.h"
 #include <KLocalizedString>
 
-static int convertToNative(const QUrl &file, const QByteArray &outfile)
+// call the function name of the part, which takes the file to load and
+// the file to write to
+static int callPartFunction(const char *name, const QUrl &file, const QByteArray &outfile)
 {
     QPluginLoader libraryLoader(QStringLiteral("kf" QT_STRINGIFY(QT_VERSION_MAJOR)) + QStringLiteral("/parts/kigpart"));
     QLibrary library(libraryLoader.fileName());
     int (*converterfunction)(const QUrl &, const QByteArray &);
-    converterfunction = (int (*)(const QUrl &, const QByteArray &))library.resolve("convertToNative");
+    converterfunction = (int (*)(const QUrl &, const QByteArray &))library.resolve(name);
     if (!converterfunction) {
         qCritical() << "Error: broken Kig installation: different library and application version !";
         return -1;
@@ -44,9 +46,16 @@ int main(int argc, char **argv)
     QCommandLineOption convertToNativeOption(
         QStringList() << QStringLiteral("c") << QStringLiteral("convert-to-native"),
         i18n("Do not show a GUI. Convert the specified file to the native Kig format. Output goes to stdout unless --outfile is specified."));
+    QCommandLineOption profileOption(QStringLiteral("profile"),
+                                     i18n("Do not show a GUI. Calculate and draw the specified file, and output how long the calculations of "
+                                          "its objects took, as JSON. Output goes to stdout unless --outfile is specified."));
     QCommandLineOption outfileOption(QStringList() << QStringLiteral("o") << QStringLiteral("outfile"),
                                      i18n("File to output the created native file to. '-' means output to stdout. Default is stdout as well."),
                                      QStringLiteral("file"));
+    QCommandLineOption traceOption(QStringLiteral("trace"),
+                                   i18n("Write a timeline of the loading, calculating, drawing and saving done to file, in the Chrome trace "
+                                        "event format. The environment variable KIG_TRACE does the same."),
+                                   QStringLiteral("file"));
 
     QCoreApplication::setApplicationName(QStringLiteral("kig"));
     QCoreApplication::setApplicationVersion(KIG_VERSION_STRING);
@@ -55,29 +64,37 @@ int main(int argc, char **argv)
 
     about.setupCommandLine(&parser);
     parser.addOption(convertToNativeOption);
+    parser.addOption(profileOption);
     parser.addOption(outfileOption);
+    parser.addOption(traceOption);
     parser.addPositionalArgument(QStringLiteral("URL"), i18n("Document to open"));
     parser.process(app);
     about.processCommandLine(&parser);
 
     QStringList urls = parser.positionalArguments();
 
-    if (parser.isSet(QStringLiteral("convert-to-native"))) {
+    // the part reads this when it traces the first span..
+    if (parser.isSet(traceOption))
+        qputenv("KIG_TRACE", QFile::encodeName(parser.value(traceOption)));
+
+    if (parser.isSet(QStringLiteral("convert-to-native")) || parser.isSet(QStringLiteral("profile"))) {
+        const bool convert = parser.isSet(QStringLiteral("convert-to-native"));
+        const char *option = convert ? "--convert-to-native" : "--profile";
         QString outfile = parser.value(QStringLiteral("outfile"));
         if (outfile.isNull())
             outfile = '-';
         if (urls.isEmpty()) {
-            qCritical() << "Error: --convert-to-native specified without a file to convert.";
+            qCritical() << "Error:" << option << "specified without a file.";
             return -1;
         }
         if (urls.count() > 1) {
-            qCritical() << "Error: --convert-to-native specified with more than one file to convert.";
+            qCritical() << "Error:" << option << "specified with more than one file.";
             return -1;
         }
-        return convertToNative(QUrl::fromLocalFile(urls[0]), outfile.toLocal8Bit());
+        return callPartFunction(convert ? "convertToNative" : "profileDocument", QUrl::fromLocalFile(urls[0]), outfile.toLocal8Bit());
     } else {
         if (parser.isSet(QStringLiteral("outfile"))) {
-            qCritical() << "Error: --outfile specified without convert-to-native.";
+            qCritical() << "Error: --outfile specified without convert-to-native or profile.";
             return -1;
         }
 
@@ -4,10 +4,18 @@
 
 #include "calcpaths.h"
 
+#include "kigtrace.h"
+
 #include "../objects/object_calcer.h"
 #include "../objects/object_imp.h"
 
+#include <QThreadPool>
+
 #include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <unordered_map>
 
 // mp:
 // The previous algorithm by Dominique had an exponential complexity
@@ -32,6 +40,7 @@ void localdfs(ObjectCalcer *obj, std::vector<ObjectCalcer *> &visited, std::vect
 
 std::vector<ObjectCalcer *> calcPath(const std::vector<ObjectCalcer *> &os)
 {
+    KigTrace::Span span("calc", "calcPath");
     // "all" is the Objects var we're building, in reverse ordering
     std::vector<ObjectCalcer *> visited;
     std::vector<ObjectCalcer *> all;
@@ -56,8 +65,8 @@ std::vector<ObjectCalcer *> calcPath(const std::vector<ObjectCalcer *> &os)
 void localdfs(ObjectCalcer *obj, std::vector<ObjectCalcer *> &visited, std::vector<ObjectCalcer *> &all)
 {
     visited.push_back(obj);
-    const std::vector<ObjectCalcer *> o = obj->children();
-    for (std::vector<ObjectCalcer *>::const_iterator i = o.begin(); i != o.end(); ++i) {
+    const std::span<ObjectCalcer *const> o = obj->childrenView();
+    for (std::span<ObjectCalcer *const>::iterator i = o.begin(); i != o.end(); ++i) {
         if (std::find(visited.begin(), visited.end(), *i) == visited.end())
             localdfs(*i, visited, all);
     }
@@ -93,7 +102,7 @@ std::vector<ObjectCalcer *> calcPath(const std::vector<ObjectCalcer *> &os)
     std::vector<ObjectCalcer *> tmp2;
     while (!tmp.empty()) {
         for (std::vector<ObjectCalcer *>::const_iterator i = tmp.begin(); i != tmp.end(); ++i) {
-            const std::vector<ObjectCalcer *> o = (*i)->children();
+            const std::span<ObjectCalcer *const> o = (*i)->childrenView();
             std::copy(o.begin(), o.end(), std::back_inserter(all));
             std::copy(o.begin(), o.end(), std::back_inserter(tmp2));
         };
@@ -117,13 +126,13 @@ std::vector<ObjectCalcer *> calcPath(const std::vector<ObjectCalcer *> &os)
 }
 #endif
 
-bool addBranch(const std::vector<ObjectCalcer *> &o, const ObjectCalcer *to, std::vector<ObjectCalcer *> &ret)
+bool addBranch(std::span<ObjectCalcer *const> o, const ObjectCalcer *to, std::vector<ObjectCalcer *> &ret)
 {
     bool rb = false;
-    for (std::vector<ObjectCalcer *>::const_iterator i = o.begin(); i != o.end(); ++i) {
+    for (std::span<ObjectCalcer *const>::iterator i = o.begin(); i != o.end(); ++i) {
         if (*i == to)
             rb = true;
-        else if (addBranch((*i)->children(), to, ret)) {
+        else if (addBranch((*i)->childrenView(), to, ret)) {
             rb = true;
             ret.push_back(*i);
         };
@@ -136,7 +145,7 @@ std::vector<ObjectCalcer *> calcPath(const std::vector<ObjectCalcer *> &from, co
     std::vector<ObjectCalcer *> all;
 
     for (std::vector<ObjectCalcer *>::const_iterator i = from.begin(); i != from.end(); ++i) {
-        (void)addBranch((*i)->children(), to, all);
+        (void)addBranch((*i)->childrenView(), to, all);
     };
 
     std::vector<ObjectCalcer *> ret;
@@ -153,7 +162,7 @@ static void addNonCache(ObjectCalcer *o, std::vector<ObjectCalcer *> &ret)
         if (std::find(ret.begin(), ret.end(), o) == ret.end())
             ret.push_back(o);
         else {
-            std::vector<ObjectCalcer *> parents = o->parents();
+            const std::span<ObjectCalcer *const> parents = o->parentsView();
             for (uint i = 0; i < parents.size(); ++i)
                 addNonCache(parents[i], ret);
         };
@@ -169,10 +178,10 @@ static bool visit(const ObjectCalcer *o, const std::vector<ObjectCalcer *> &from
     if (std::find(from.begin(), from.end(), o) != from.end())
         return true;
 
-    std::vector<bool> deps(o->parents().size(), false);
+    const std::span<ObjectCalcer *const> parents = o->parentsView();
+    std::vector<bool> deps(parents.size(), false);
     bool somedepend = false;
     bool alldepend = true;
-    std::vector<ObjectCalcer *> parents = o->parents();
     for (uint i = 0; i < parents.size(); ++i) {
         bool v = ::visit(parents[i], from, ret);
         somedepend |= v;
@@ -203,7 +212,7 @@ std::vector<ObjectCalcer *> getAllParents(const std::vector<ObjectCalcer *> &obj
     while (!cur.empty()) {
         std::set<ObjectCalcer *> next;
         for (std::set<ObjectCalcer *>::const_iterator i = cur.begin(); i != cur.end(); ++i) {
-            std::vector<ObjectCalcer *> parents = (*i)->parents();
+            const std::span<ObjectCalcer *const> parents = (*i)->parentsView();
             next.insert(parents.begin(), parents.end());
         };
 
@@ -229,14 +238,14 @@ bool isChild(const ObjectCalcer *o, ObjectCalcer *op)
 
 bool isChild(const ObjectCalcer *o, const std::vector<ObjectCalcer *> &os)
 {
-    std::vector<ObjectCalcer *> parents = o->parents();
+    const std::span<ObjectCalcer *const> parents = o->parentsView();
     std::set<ObjectCalcer *> cur(parents.begin(), parents.end());
     while (!cur.empty()) {
         std::set<ObjectCalcer *> next;
         for (std::set<ObjectCalcer *>::const_iterator i = cur.begin(); i != cur.end(); ++i) {
             if (std::find(os.begin(), os.end(), *i) != os.end())
                 return true;
-            std::vector<ObjectCalcer *> parents = (*i)->parents();
+            const std::span<ObjectCalcer *const> parents = (*i)->parentsView();
             next.insert(parents.begin(), parents.end());
         };
         cur = next;
@@ -261,7 +270,7 @@ std::set<ObjectCalcer *> getAllChildren(const std::vector<ObjectCalcer *> &objs)
         std::set<ObjectCalcer *> next;
         for (std::set<ObjectCalcer *>::iterator i = cur.begin(); i != cur.end(); ++i) {
             ret.insert(*i);
-            std::vector<ObjectCalcer *> children = (*i)->children();
+            const std::span<ObjectCalcer *const> children = (*i)->childrenView();
             next.insert(children.begin(), children.end());
         };
         cur = next;
@@ -273,3 +282,148 @@ bool isPointOnCurve(const ObjectCalcer *point, const ObjectCalcer *curve)
 {
     return point->isDefinedOnOrThrough(curve) || curve->isDefinedOnOrThrough(point);
 }
+
+namespace
+{
+// paths shorter than this are calculated on the calling thread, handing
+// them to other threads would cost more than it saves..
+const uint minparallelpathsize = 64;
+
+/**
+ * Calculates a calc path with dependency counters: every object waits
+ * for the number of its parents in the path that aren't calculated yet,
+ * and is queued when that becomes zero.  The worker threads take the
+ * thread safe objects from the queue, the calling thread takes the
+ * others too.
+ */
+class CalcScheduler
+{
+    const std::vector<ObjectCalcer *> &mpath;
+    const KigDocument &mdoc;
+    std::vector<uint> mwaiting;
+    std::vector<std::vector<uint>> mchildren;
+    std::deque<uint> mready;
+    std::deque<uint> mmainthreadonly;
+    uint mdone;
+    uint mworkers;
+    std::mutex mmutex;
+    std::condition_variable mcond;
+
+    // called with mmutex locked
+    void enqueue(uint i);
+    void work(bool mainthread);
+
+public:
+    CalcScheduler(const std::vector<ObjectCalcer *> &path, const KigDocument &doc);
+    void run(QThreadPool *pool);
+};
+
+CalcScheduler::CalcScheduler(const std::vector<ObjectCalcer *> &path, const KigDocument &doc)
+    : mpath(path)
+    , mdoc(doc)
+    , mwaiting(path.size(), 0)
+    , mchildren(path.size())
+    , mdone(0)
+    , mworkers(0)
+{
+    std::unordered_map<const ObjectCalcer *, uint> index;
+    for (uint i = 0; i < mpath.size(); ++i)
+        index[mpath[i]] = i;
+    // parents outside of the path are supposed to be calculated
+    // already..
+    for (uint i = 0; i < mpath.size(); ++i) {
+        const std::span<ObjectCalcer *const> parents = mpath[i]->parentsView();
+        for (std::span<ObjectCalcer *const>::iterator j = parents.begin(); j != parents.end(); ++j) {
+            std::unordered_map<const ObjectCalcer *, uint>::const_iterator p = index.find(*j);
+            if (p == index.end())
+                continue;
+            ++mwaiting[i];
+            mchildren[p->second].push_back(i);
+        }
+    }
+    for (uint i = 0; i < mpath.size(); ++i)
+        if (mwaiting[i] == 0)
+            enqueue(i);
+}
+
+void CalcScheduler::enqueue(uint i)
+{
+    if (mpath[i]->isThreadSafe())
+        mready.push_back(i);
+    else
+        mmainthreadonly.push_back(i);
+}
+
+void CalcScheduler::work(bool mainthread)
+{
+    std::unique_lock<std::mutex> lock(mmutex);
+    while (mdone < mpath.size()) {
+        uint i;
+        if (mainthread && !mmainthreadonly.empty()) {
+            i = mmainthreadonly.front();
+            mmainthreadonly.pop_front();
+        } else if (!mready.empty()) {
+            i = mready.front();
+            mready.pop_front();
+        } else {
+            mcond.wait(lock);
+            continue;
+        }
+
+        lock.unlock();
+        mpath[i]->calc(mdoc);
+        lock.lock();
+
+        ++mdone;
+        bool queued = mdone == mpath.size();
+        for (std::vector<uint>::const_iterator c = mchildren[i].begin(); c != mchildren[i].end(); ++c)
+            if (--mwaiting[*c] == 0) {
+                enqueue(*c);
+                queued = true;
+            }
+        if (queued)
+            mcond.notify_all();
+    }
+    if (!mainthread) {
+        --mworkers;
+        mcond.notify_all();
+    }
+}
+
+void CalcScheduler::run(QThreadPool *pool)
+{
+    // only start the workers that get a thread right now, we don't want
+    // to wait for the other users of the pool..
+    for (int i = 1; i < pool->maxThreadCount(); ++i) {
+        {
+            std::lock_guard<std::mutex> lock(mmutex);
+            ++mworkers;
+        }
+        if (!pool->tryStart([this]() {
+                work(false);
+            })) {
+            std::lock_guard<std::mutex> lock(mmutex);
+            --mworkers;
+            break;
+        }
+    }
+    work(true);
+    // the workers refer to us, so wait until they're all gone..
+    std::unique_lock<std::mutex> lock(mmutex);
+    mcond.wait(lock, [this]() {
+        return mworkers == 0;
+    });
+}
+}
+
+void calcAll(const std::vector<ObjectCalcer *> &path, const KigDocument &doc)
+{
+    KigTrace::Span span("calc", "calcAll");
+    QThreadPool *pool = QThreadPool::globalInstance();
+    if (path.size() < minparallelpathsize || pool->maxThreadCount() < 2) {
+        for (std::vector<ObjectCalcer *>::const_iterator i = path.begin(); i != path.end(); ++i)
+            (*i)->calc(doc);
+        return;
+    }
+    CalcScheduler(path, doc).run(pool);
+}
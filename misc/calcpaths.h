@@ -13,6 +13,20 @@
  */
 std::vector<ObjectCalcer *> calcPath(const std::vector<ObjectCalcer *> &os);
 
+/**
+ * This function calc()'s all objects in \p path, which must be sorted
+ * by calcPath() already.  For long paths, the objects whose parents are
+ * all calculated are handed to the threads of QThreadPool::globalInstance(),
+ * so that independent parts of the document are calculated
+ * concurrently.  Objects for which ObjectCalcer::isThreadSafe() returns
+ * false, like Python scripts, are still calculated on the calling
+ * thread, which must be the main one.  The results are the same as
+ * those of calc()'ing the objects one after another, except that the
+ * parameter CurveImp::getParam() tries first is kept per thread, so
+ * that e.g. the tangent of a locus may differ in its last digits.
+ */
+void calcAll(const std::vector<ObjectCalcer *> &path, const KigDocument &doc);
+
 /**
  * This is a different function for more or less the same purpose.  It
  * takes a few Objects, which are considered to have been calced
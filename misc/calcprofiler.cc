@@ -0,0 +1,152 @@
+// SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include "calcprofiler.h"
+
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QString>
+
+#include <algorithm>
+#include <vector>
+
+std::atomic<bool> CalcProfiler::senabled(false);
+thread_local unsigned long CalcProfiler::sallocations = 0;
+
+CalcProfiler::CalcProfiler()
+{
+}
+
+CalcProfiler::~CalcProfiler()
+{
+}
+
+CalcProfiler *CalcProfiler::instance()
+{
+    static CalcProfiler t;
+    return &t;
+}
+
+void CalcProfiler::setEnabled(bool enabled)
+{
+    // calcers are only forgotten while we're enabled, so we start over
+    if (enabled)
+        clear();
+    senabled.store(enabled, std::memory_order_relaxed);
+}
+
+void CalcProfiler::clear()
+{
+    std::lock_guard<std::mutex> lock(mmutex);
+    msections.clear();
+    mcalcers.clear();
+}
+
+void CalcProfiler::forget(const ObjectCalcer *calcer)
+{
+    std::lock_guard<std::mutex> lock(mmutex);
+    mcalcers.erase(calcer);
+}
+
+namespace
+{
+void addCall(CalcProfiler::Entry &e, double time, unsigned long allocations)
+{
+    ++e.calls;
+    e.totaltime += time;
+    e.maxtime = std::max(e.maxtime, time);
+    e.allocations += allocations;
+}
+
+QJsonObject entryToJson(const CalcProfiler::Entry &e)
+{
+    QJsonObject ret;
+    ret[QStringLiteral("calls")] = static_cast<double>(e.calls);
+    ret[QStringLiteral("totalMs")] = e.totaltime * 1000;
+    ret[QStringLiteral("maxMs")] = e.maxtime * 1000;
+    ret[QStringLiteral("allocations")] = static_cast<double>(e.allocations);
+    return ret;
+}
+
+bool longerThan(const QJsonValue &a, const QJsonValue &b)
+{
+    return a.toObject()[QStringLiteral("totalMs")].toDouble() > b.toObject()[QStringLiteral("totalMs")].toDouble();
+}
+}
+
+void CalcProfiler::record(Kind kind, const char *name, const ObjectCalcer *calcer, double time, unsigned long allocations)
+{
+    std::lock_guard<std::mutex> lock(mmutex);
+    addCall(msections[Section(kind, name)], time, allocations);
+    if (calcer) {
+        CalcerEntry &e = mcalcers[calcer];
+        if (e.calls == 0) {
+            e.kind = kind;
+            e.name = name;
+        }
+        addCall(e, time, allocations);
+    }
+}
+
+std::map<CalcProfiler::Section, CalcProfiler::Entry> CalcProfiler::sections() const
+{
+    std::lock_guard<std::mutex> lock(mmutex);
+    return msections;
+}
+
+std::map<const ObjectCalcer *, CalcProfiler::CalcerEntry> CalcProfiler::calcers() const
+{
+    std::lock_guard<std::mutex> lock(mmutex);
+    return mcalcers;
+}
+
+const char *CalcProfiler::kindName(Kind kind)
+{
+    switch (kind) {
+    case Type:
+        return "type";
+    case Property:
+        return "property";
+    case Hierarchy:
+        return "hierarchy";
+    case Drawing:
+        return "drawing";
+    }
+    return "";
+}
+
+QJsonObject CalcProfiler::toJson() const
+{
+    const std::map<Section, Entry> s = sections();
+    const std::map<const ObjectCalcer *, CalcerEntry> c = calcers();
+
+    std::vector<QJsonValue> sectionlist;
+    for (std::map<Section, Entry>::const_iterator i = s.begin(); i != s.end(); ++i) {
+        QJsonObject o = entryToJson(i->second);
+        o[QStringLiteral("kind")] = QLatin1String(kindName(i->first.first));
+        o[QStringLiteral("name")] = QString::fromStdString(i->first.second);
+        sectionlist.push_back(o);
+    }
+    std::vector<QJsonValue> calcerlist;
+    for (std::map<const ObjectCalcer *, CalcerEntry>::const_iterator i = c.begin(); i != c.end(); ++i) {
+        QJsonObject o = entryToJson(i->second);
+        o[QStringLiteral("calcer")] = QStringLiteral("0x%1").arg(reinterpret_cast<quintptr>(i->first), 0, 16);
+        o[QStringLiteral("kind")] = QLatin1String(kindName(i->second.kind));
+        o[QStringLiteral("name")] = QString::fromStdString(i->second.name);
+        calcerlist.push_back(o);
+    }
+    std::sort(sectionlist.begin(), sectionlist.end(), longerThan);
+    std::sort(calcerlist.begin(), calcerlist.end(), longerThan);
+
+    QJsonObject ret;
+    QJsonArray a;
+    for (std::vector<QJsonValue>::const_iterator i = sectionlist.begin(); i != sectionlist.end(); ++i)
+        a.append(*i);
+    ret[QStringLiteral("sections")] = a;
+    QJsonArray b;
+    for (std::vector<QJsonValue>::const_iterator i = calcerlist.begin(); i != calcerlist.end(); ++i)
+        b.append(*i);
+    ret[QStringLiteral("calcers")] = b;
+    return ret;
+}
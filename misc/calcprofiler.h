@@ -0,0 +1,134 @@
+// SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <string>
+
+class ObjectCalcer;
+class QJsonObject;
+
+/**
+ * CalcProfiler records how often the calculations of a document are
+ * done, and how long they take, when it is enabled.  The calc()
+ * functions of ObjectTypeCalcer, ObjectPropertyCalcer and
+ * ObjectHierarchy, and KigPainter::drawCurve(), are instrumented with
+ * a CalcProfiler::Scope.  The results are kept per section, e.g. per
+ * ObjectType::fullName(), and per calcer.  The times include those of
+ * nested sections, such as the hierarchy of a locus inside the
+ * calculation of the locus, and the allocations are the ObjectImp's
+ * created meanwhile.
+ */
+class CalcProfiler
+{
+public:
+    enum Kind { Type, Property, Hierarchy, Drawing };
+
+    struct Entry {
+        unsigned long calls = 0;
+        double totaltime = 0.;
+        double maxtime = 0.;
+        unsigned long allocations = 0;
+    };
+    struct CalcerEntry : public Entry {
+        Kind kind;
+        std::string name;
+    };
+
+    typedef std::pair<Kind, std::string> Section;
+
+    static CalcProfiler *instance();
+
+    static bool enabled()
+    {
+        return senabled.load(std::memory_order_relaxed);
+    }
+    /**
+     * enabling the profiler starts a new recording.
+     */
+    void setEnabled(bool enabled);
+    /**
+     * forget everything that was recorded so far.
+     */
+    void clear();
+
+    /**
+     * called by the constructor of ObjectImp.
+     */
+    static void countAllocation()
+    {
+        if (enabled())
+            ++sallocations;
+    }
+    /**
+     * called by the destructor of ObjectCalcer, so that a new calcer
+     * at the same address doesn't inherit its entry.
+     */
+    void forget(const ObjectCalcer *calcer);
+
+    /**
+     * copies of the entries, taken atomically.
+     */
+    std::map<Section, Entry> sections() const;
+    std::map<const ObjectCalcer *, CalcerEntry> calcers() const;
+
+    /**
+     * the entries as a JSON object with a "sections" and a "calcers"
+     * array, sorted by total time.
+     */
+    QJsonObject toJson() const;
+
+    static const char *kindName(Kind kind);
+
+    /**
+     * Measures the code in its scope as a call of the section name of
+     * kind kind, done for calcer if it's not 0.  Nothing is done if the
+     * profiler is disabled.
+     */
+    class Scope
+    {
+        const char *mname;
+        Kind mkind;
+        const ObjectCalcer *mcalcer;
+        std::chrono::steady_clock::time_point mstart;
+        unsigned long mallocations;
+
+    public:
+        Scope(Kind kind, const char *name, const ObjectCalcer *calcer = nullptr)
+            : mname(enabled() ? name : nullptr)
+            , mkind(kind)
+            , mcalcer(calcer)
+        {
+            if (mname) {
+                mallocations = sallocations;
+                mstart = std::chrono::steady_clock::now();
+            }
+        }
+        ~Scope()
+        {
+            if (mname)
+                instance()->record(mkind, mname, mcalcer, std::chrono::duration<double>(std::chrono::steady_clock::now() - mstart).count(),
+                                   sallocations - mallocations);
+        }
+    };
+
+private:
+    CalcProfiler();
+    ~CalcProfiler();
+
+    void record(Kind kind, const char *name, const ObjectCalcer *calcer, double time, unsigned long allocations);
+
+    static std::atomic<bool> senabled;
+    // counted per thread, so that the objects calculated at the same
+    // time on other threads ( see calcAll() ) don't count for a scope
+    static thread_local unsigned long sallocations;
+
+    mutable std::mutex mmutex;
+    std::map<Section, Entry> msections;
+    std::map<const ObjectCalcer *, CalcerEntry> mcalcers;
+};
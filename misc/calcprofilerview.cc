@@ -0,0 +1,170 @@
+// SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include "calcprofilerview.h"
+
+#include "calcprofiler.h"
+
+#include "../kig/kig_document.h"
+#include "../kig/kig_part.h"
+#include "../objects/object_holder.h"
+#include "../objects/object_imp.h"
+
+#include <QCheckBox>
+#include <QFileDialog>
+#include <QHBoxLayout>
+#include <QHeaderView>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QPushButton>
+#include <QSaveFile>
+#include <QTabWidget>
+#include <QTimer>
+#include <QTreeWidget>
+#include <QVBoxLayout>
+
+#include <KLocalizedString>
+#include <KMessageBox>
+
+#include <cmath>
+#include <map>
+
+namespace
+{
+QTreeWidget *newTree(QWidget *parent, const QString &firstcolumn)
+{
+    QTreeWidget *ret = new QTreeWidget(parent);
+    ret->setRootIsDecorated(false);
+    ret->setHeaderLabels(QStringList() << firstcolumn << i18n("Section") << i18n("Calls") << i18n("Total (ms)") << i18n("Longest (ms)")
+                                       << i18n("Allocations"));
+    ret->setToolTip(i18n("The times include those of the sections called from a section, like the hierarchy of a locus."));
+    ret->header()->setSectionResizeMode(0, QHeaderView::Stretch);
+    ret->setSortingEnabled(true);
+    return ret;
+}
+
+void fillItem(QTreeWidgetItem *item, const QString &first, CalcProfiler::Kind kind, const std::string &name, const CalcProfiler::Entry &e)
+{
+    item->setText(0, first);
+    item->setText(1, QStringLiteral("%1: %2").arg(QLatin1String(CalcProfiler::kindName(kind)), QString::fromStdString(name)));
+    item->setData(2, Qt::DisplayRole, static_cast<qulonglong>(e.calls));
+    item->setData(3, Qt::DisplayRole, std::round(e.totaltime * 1e5) / 100);
+    item->setData(4, Qt::DisplayRole, std::round(e.maxtime * 1e5) / 100);
+    item->setData(5, Qt::DisplayRole, static_cast<qulonglong>(e.allocations));
+    for (int i = 2; i < 6; ++i)
+        item->setTextAlignment(i, Qt::AlignRight | Qt::AlignVCenter);
+}
+}
+
+CalcProfilerView::CalcProfilerView(KigPart &part, QWidget *parent)
+    : QDockWidget(i18n("Profiler"), parent)
+    , mpart(part)
+{
+    setObjectName(QStringLiteral("kig_profiler"));
+
+    QWidget *w = new QWidget(this);
+    QVBoxLayout *layout = new QVBoxLayout(w);
+
+    QHBoxLayout *buttons = new QHBoxLayout;
+    mrecord = new QCheckBox(i18n("&Record"), w);
+    mrecord->setChecked(CalcProfiler::enabled());
+    mrecord->setToolTip(i18n("Record how long the calculations of the objects take. Starting a recording forgets the previous one."));
+    buttons->addWidget(mrecord);
+    buttons->addStretch();
+    QPushButton *clearbutton = new QPushButton(QIcon::fromTheme(QStringLiteral("edit-clear")), i18n("&Clear"), w);
+    buttons->addWidget(clearbutton);
+    QPushButton *savebutton = new QPushButton(QIcon::fromTheme(QStringLiteral("document-save")), i18n("&Save..."), w);
+    savebutton->setToolTip(i18n("Save the recorded data as JSON."));
+    buttons->addWidget(savebutton);
+    layout->addLayout(buttons);
+
+    QTabWidget *tabs = new QTabWidget(w);
+    msections = newTree(tabs, i18n("Kind"));
+    msections->hideColumn(0);
+    tabs->addTab(msections, i18n("Sections"));
+    mobjects = newTree(tabs, i18n("Object"));
+    tabs->addTab(mobjects, i18n("Objects"));
+    layout->addWidget(tabs);
+    setWidget(w);
+
+    mtimer = new QTimer(this);
+    mtimer->setInterval(1000);
+
+    connect(mrecord, &QCheckBox::toggled, this, &CalcProfilerView::setRecording);
+    connect(clearbutton, &QPushButton::clicked, this, &CalcProfilerView::clear);
+    connect(savebutton, &QPushButton::clicked, this, &CalcProfilerView::saveJson);
+    connect(mtimer, &QTimer::timeout, this, &CalcProfilerView::refresh);
+    connect(this, &QDockWidget::visibilityChanged, this, &CalcProfilerView::refresh);
+
+    if (CalcProfiler::enabled())
+        mtimer->start();
+    refresh();
+}
+
+CalcProfilerView::~CalcProfilerView()
+{
+}
+
+void CalcProfilerView::setRecording(bool recording)
+{
+    CalcProfiler::instance()->setEnabled(recording);
+    if (recording)
+        mtimer->start();
+    else
+        mtimer->stop();
+    refresh();
+}
+
+void CalcProfilerView::clear()
+{
+    CalcProfiler::instance()->clear();
+    refresh();
+}
+
+void CalcProfilerView::refresh()
+{
+    if (!isVisible())
+        return;
+
+    msections->clear();
+    const std::map<CalcProfiler::Section, CalcProfiler::Entry> sections = CalcProfiler::instance()->sections();
+    for (std::map<CalcProfiler::Section, CalcProfiler::Entry>::const_iterator i = sections.begin(); i != sections.end(); ++i)
+        fillItem(new QTreeWidgetItem(msections), QString(), i->first.first, i->first.second, i->second);
+
+    // the calcers of the objects of the document, the others are
+    // intermediate ones..
+    std::map<const ObjectCalcer *, const ObjectHolder *> holders;
+    const std::vector<ObjectHolder *> &objects = mpart.document().objects();
+    for (std::vector<ObjectHolder *>::const_iterator i = objects.begin(); i != objects.end(); ++i)
+        holders[(*i)->calcer()] = *i;
+
+    mobjects->clear();
+    const std::map<const ObjectCalcer *, CalcProfiler::CalcerEntry> calcers = CalcProfiler::instance()->calcers();
+    for (std::map<const ObjectCalcer *, CalcProfiler::CalcerEntry>::const_iterator i = calcers.begin(); i != calcers.end(); ++i) {
+        QString name;
+        std::map<const ObjectCalcer *, const ObjectHolder *>::const_iterator holder = holders.find(i->first);
+        if (holder == holders.end())
+            name = i18n("(intermediate)");
+        else if (!holder->second->name().isEmpty())
+            name = holder->second->name();
+        else
+            name = holder->second->imp()->type()->translatedName();
+        fillItem(new QTreeWidgetItem(mobjects), name, i->second.kind, i->second.name, i->second);
+    }
+
+    msections->sortByColumn(3, Qt::DescendingOrder);
+    mobjects->sortByColumn(3, Qt::DescendingOrder);
+}
+
+void CalcProfilerView::saveJson()
+{
+    const QString filename = QFileDialog::getSaveFileName(this, i18n("Save Profile"), QString(), i18n("JSON files (*.json)"));
+    if (filename.isEmpty())
+        return;
+    QSaveFile file(filename);
+    if (!file.open(QIODevice::WriteOnly) || file.write(QJsonDocument(CalcProfiler::instance()->toJson()).toJson()) < 0 || !file.commit())
+        KMessageBox::error(this, i18n("The file \"%1\" could not be saved.", filename));
+}
+
+#include "moc_calcprofilerview.cpp"
@@ -0,0 +1,40 @@
+// SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#pragma once
+
+#include <QDockWidget>
+
+class KigPart;
+class QCheckBox;
+class QTimer;
+class QTreeWidget;
+
+/**
+ * A dock widget showing what CalcProfiler recorded, per section and per
+ * object of the document, and refreshing it while it is recording.
+ */
+class CalcProfilerView : public QDockWidget
+{
+    Q_OBJECT
+
+public:
+    CalcProfilerView(KigPart &part, QWidget *parent);
+    ~CalcProfilerView();
+
+public Q_SLOTS:
+    void refresh();
+
+private Q_SLOTS:
+    void setRecording(bool recording);
+    void clear();
+    void saveJson();
+
+private:
+    KigPart &mpart;
+    QCheckBox *mrecord;
+    QTreeWidget *msections;
+    QTreeWidget *mobjects;
+    QTimer *mtimer;
+};
@@ -8,8 +8,10 @@
 #include "common.h"
 
 #include "../kig/kig_view.h"
+#include "../objects/curve_imp.h"
 #include "../objects/object_imp.h"
 
+#include <algorithm>
 #include <cmath>
 #include <limits>
 
@@ -325,6 +327,120 @@ double getDoubleFromUser(const QString &caption, const QString &label, double va
     return ret;
 }
 
+namespace
+{
+struct CurveInterval {
+    double t0;
+    Coordinate p0;
+    double t1;
+    Coordinate p1;
+};
+
+// an interval that calcCurvePolylines() is done with: either the two
+// segments p0-pm and pm-p1 of a polyline, or a break between polylines
+struct CurvePiece {
+    double t0;
+    bool segments;
+    Coordinate p0;
+    Coordinate pm;
+    Coordinate p1;
+};
+
+bool boundsMeetRect(const Coordinate &a, const Coordinate &b, const Coordinate &c, const Rect &r)
+{
+    return std::max(std::max(a.x, b.x), c.x) >= r.left() && std::min(std::min(a.x, b.x), c.x) <= r.right()
+        && std::max(std::max(a.y, b.y), c.y) >= r.bottom() && std::min(std::min(a.y, b.y), c.y) <= r.top();
+}
+}
+
+const std::vector<std::vector<Coordinate>>
+calcCurvePolylines(const CurveImp *curve, const KigDocument &doc, const Rect &r, double precision, int maxnumberofpoints)
+{
+    // every interval larger than hmax is subdivided, so that the curve
+    // can't be missed entirely, and intervals smaller than hmin are
+    // never subdivided, so that the bisection ends at singular points.
+    // maxnumberofpoints guards against pathological loci.
+    const double hmax = 1. / 40;
+    const double hmin = 3e-5;
+    // a piece of the curve this much longer than precision that still
+    // isn't flat at hmin is a jump, not a sharp turn
+    const double jump = 10 * precision;
+
+    // the intervals are bisected a level at a time, so that the midpoints
+    // of a whole level can be calculated in one call to getPoints(),
+    // which is a lot faster for loci of Python scripts..
+    std::vector<CurvePiece> pieces;
+    std::vector<Coordinate> ends = curve->getPoints({0., 1.}, doc);
+    std::vector<CurveInterval> level = {{0., ends[0], 1., ends[1]}};
+    int numberofpoints = 2;
+    std::vector<double> params;
+    while (!level.empty()) {
+        params.clear();
+        for (const CurveInterval &i : level)
+            params.push_back((i.t0 + i.t1) / 2);
+        const std::vector<Coordinate> midpoints = curve->getPoints(params, doc);
+
+        std::vector<CurveInterval> next;
+        for (uint j = 0; j < level.size(); ++j) {
+            const CurveInterval &i = level[j];
+            const double h = i.t1 - i.t0;
+            const double tm = params[j];
+            const Coordinate &pm = midpoints[j];
+            ++numberofpoints;
+            const bool subdivide = h >= hmax || (h >= hmin && numberofpoints < maxnumberofpoints);
+
+            if (i.p0.valid() && pm.valid() && i.p1.valid()) {
+                if (h < hmax && !boundsMeetRect(i.p0, pm, i.p1, r)) {
+                    // outside the rect
+                    pieces.push_back({i.t0, false, i.p0, pm, i.p1});
+                    continue;
+                }
+                const bool flat = ((i.p0 + i.p1) / 2 - pm).length() <= precision;
+                if ((flat && h < hmax) || !subdivide) {
+                    pieces.push_back({i.t0, flat || (i.p1 - i.p0).length() <= jump, i.p0, pm, i.p1});
+                    continue;
+                }
+            } else if (!subdivide || (h < hmax && !i.p0.valid() && !pm.valid() && !i.p1.valid())) {
+                // the curve is interrupted here
+                pieces.push_back({i.t0, false, i.p0, pm, i.p1});
+                continue;
+            }
+            next.push_back({i.t0, i.p0, tm, pm});
+            next.push_back({tm, pm, i.t1, i.p1});
+        }
+        level.swap(next);
+    }
+
+    // the pieces cover the parameter range without overlapping, in order
+    // of t0 they form the polylines..
+    std::sort(pieces.begin(), pieces.end(), [](const CurvePiece &a, const CurvePiece &b) {
+        return a.t0 < b.t0;
+    });
+    std::vector<std::vector<Coordinate>> ret;
+    std::vector<Coordinate> current;
+    auto endPolyline = [&ret, &current]() {
+        if (current.size() > 1)
+            ret.push_back(current);
+        current.clear();
+    };
+    auto addSegment = [&current, &endPolyline](const Coordinate &a, const Coordinate &b) {
+        if (!current.empty() && current.back() != a)
+            endPolyline();
+        if (current.empty())
+            current.push_back(a);
+        current.push_back(b);
+    };
+    for (const CurvePiece &piece : pieces) {
+        if (piece.segments) {
+            addSegment(piece.p0, piece.pm);
+            addSegment(piece.pm, piece.p1);
+        } else
+            endPolyline();
+    }
+    endPolyline();
+    return ret;
+}
+
 const Coordinate calcCenter(const Coordinate &a, const Coordinate &b, const Coordinate &c)
 {
     // this algorithm is written by my brother, Christophe Devriese
@@ -463,4 +579,5 @@ bool isSingular(const double &a, const double &b, const double &c, const double
 }
 
 const double double_inf = HUGE_VAL;
+const double exportCurvePrecision = 1e-3;
 const double test_threshold = 1e-6;
@@ -16,6 +16,8 @@
 #include <QWidget>
 
 class ObjectImp;
+class CurveImp;
+class KigDocument;
 class KigWidget;
 
 extern const double double_inf;
@@ -177,6 +179,28 @@ const LineData calcBorderPoints(const LineData &l, const Rect &r);
  */
 void calcRayBorderPoints(const Coordinate &a, Coordinate &b, const Rect &r);
 
+/**
+ * This function flattens the part of the curve inside the rect r into
+ * a set of polylines, for the exporters that can't draw a CurveImp
+ * directly.  The parameter range of CurveImp::getPoint() is bisected
+ * adaptively, so that no point of the curve is further than precision
+ * ( in document coordinates ) from the polyline approximating it, and
+ * pieces of the curve that lie outside r are skipped.  A new polyline
+ * is started wherever the curve has no valid points, or jumps.  The
+ * polylines are returned in order of increasing parameter.  The points
+ * are calculated with CurveImp::getPoints(), a level of the bisection
+ * at a time, and no more than about maxnumberofpoints of them.
+ */
+const std::vector<std::vector<Coordinate>>
+calcCurvePolylines(const CurveImp *curve, const KigDocument &doc, const Rect &r, double precision, int maxnumberofpoints = 20000);
+
+/**
+ * The exporters flatten curves ( see calcCurvePolylines() and
+ * calcCubicPolylines() ) with a precision of this fraction of the
+ * width of the exported rect.
+ */
+extern const double exportCurvePrecision;
+
 /**
  * This function calculates the center of the circle going through the
  * three given points.
@@ -871,3 +871,99 @@ bool ConicCartesianData::valid() const
 {
     return std::isfinite(coeffs[0]);
 }
+
+/*
+ * The point of the conic with polar angle theta is focus1 + pdimen *
+ * ( cos theta, sin theta ) / z, with z = 1 - ecostheta0 * cos theta -
+ * esintheta0 * sin theta.  In homogeneous coordinates, this is a
+ * linear function of ( 1, cos theta, sin theta ).  An arc of the unit
+ * circle shorter than a half turn is a rational quadratic Bezier
+ * curve, so the image of its three homogeneous control points gives
+ * us the control points and weights of the corresponding conic arc.
+ */
+static void addConicBezierPiece(std::vector<RationalQuadData> &ret, const ConicPolarData &d, double ta, double tb, int depth)
+{
+    const double phi = (tb - ta) / 2;
+    const double tm = (ta + tb) / 2;
+    const double u[3][3] = {{1., cos(ta), sin(ta)}, {cos(phi), cos(tm), sin(tm)}, {1., cos(tb), sin(tb)}};
+    double z[3];
+    for (int i = 0; i < 3; ++i)
+        z[i] = u[i][0] - d.ecostheta0 * u[i][1] - d.esintheta0 * u[i][2];
+
+    // all weights need to have the same sign, otherwise the control
+    // point is at infinity or on the other side of it..
+    if (z[0] * z[1] <= 0 || z[1] * z[2] <= 0) {
+        if (depth < 4) {
+            addConicBezierPiece(ret, d, ta, tm, depth + 1);
+            addConicBezierPiece(ret, d, tm, tb, depth + 1);
+        }
+        return;
+    }
+
+    Coordinate pts[3];
+    for (int i = 0; i < 3; ++i)
+        pts[i] = d.focus1 + Coordinate(u[i][1], u[i][2]) * (d.pdimen / z[i]);
+    ret.push_back(RationalQuadData(pts[0], pts[1], pts[2], fabs(z[1]) / sqrt(z[0] * z[2])));
+}
+
+const std::vector<RationalQuadData> calcConicBezierPieces(const ConicPolarData &d, double maxdist, double startangle, double angle)
+{
+    std::vector<RationalQuadData> ret;
+    if (!(maxdist > 0) || !(angle > 0))
+        return ret;
+
+    // with theta0 the direction of the first focus, z = 1 - e cos(
+    // theta - theta0 ), and the distance of a point to the focus is
+    // |pdimen / z|.  So we only keep the polar angles where |z| >=
+    // delta.  For an ellipse that is small enough, that is all of them,
+    // otherwise it is an interval around the direction opposite to
+    // theta0 ( z > 0 ) and, for a hyperbola, an interval around theta0
+    // ( z < 0, the other branch ).
+    const double e = hypot(d.ecostheta0, d.esintheta0);
+    const double theta0 = atan2(d.esintheta0, d.ecostheta0);
+    const double delta = fabs(d.pdimen) / maxdist;
+    const double endangle = startangle + angle;
+
+    std::vector<std::pair<double, double>> arcs;
+    if (e <= 1 - delta)
+        arcs.push_back(std::make_pair(startangle, endangle));
+    else {
+        std::vector<std::pair<double, double>> ranges;
+        if (e > 0 && 1 - delta >= -e) {
+            const double alpha = acos((1 - delta) / e);
+            ranges.push_back(std::make_pair(alpha, 2 * M_PI - alpha));
+        }
+        if (e > 1 + delta) {
+            const double beta = acos((1 + delta) / e);
+            ranges.push_back(std::make_pair(-beta, beta));
+        }
+
+        // intersect the ranges, repeated every full turn, with the
+        // requested interval..
+        const int base = static_cast<int>(floor((startangle - theta0) / (2 * M_PI)));
+        for (std::vector<std::pair<double, double>>::const_iterator i = ranges.begin(); i != ranges.end(); ++i) {
+            for (int k = base - 1; k <= base + 2; ++k) {
+                const double lo = std::max(theta0 + i->first + 2 * M_PI * k, startangle);
+                const double hi = std::min(theta0 + i->second + 2 * M_PI * k, endangle);
+                if (lo < hi)
+                    arcs.push_back(std::make_pair(lo, hi));
+            }
+        }
+        std::sort(arcs.begin(), arcs.end());
+    }
+
+    // quarter turns are short enough to keep the weights well
+    // conditioned..
+    for (std::vector<std::pair<double, double>>::const_iterator i = arcs.begin(); i != arcs.end(); ++i) {
+        const double lo = i->first;
+        const double hi = i->second;
+        const int n = std::max(1, static_cast<int>(ceil((hi - lo) / (M_PI / 2))));
+        double ta = lo;
+        for (int j = 1; j <= n; ++j) {
+            const double tb = j == n ? hi : lo + (hi - lo) * j / n;
+            addConicBezierPiece(ret, d, ta, tb, 0);
+            ta = tb;
+        }
+    }
+    return ret;
+}
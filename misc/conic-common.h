@@ -104,6 +104,28 @@ public:
 
 bool operator==(const ConicPolarData &lhs, const ConicPolarData &rhs);
 
+/**
+ * A rational quadratic Bezier curve with end points a and c and
+ * control point b.  The end points have weight 1, and the control
+ * point has weight w.  Every arc of a conic can be represented
+ * exactly by a few of these.
+ */
+class RationalQuadData
+{
+public:
+    RationalQuadData(const Coordinate &na, const Coordinate &nb, const Coordinate &nc, double nw)
+        : a(na)
+        , b(nb)
+        , c(nc)
+        , w(nw)
+    {
+    }
+    Coordinate a;
+    Coordinate b;
+    Coordinate c;
+    double w;
+};
+
 /**
  * These are the constraint values that can be passed to the
  * calcConicThroughPoints function.  Their meaning is as follows:
@@ -234,3 +256,14 @@ const LineData calcConicRadical(const ConicCartesianData &cequation1, const Coni
  * conic cannot be calculated.
  */
 const ConicCartesianData calcConicTransformation(const ConicCartesianData &data, const Transformation &t, bool &valid);
+
+/**
+ * This function splits the part of the conic d with polar angle (
+ * the angle around d.focus1 used by ConicImp::getPoint() ) between
+ * startangle and startangle + angle into rational quadratic Bezier
+ * curves.  The parts of the conic that are farther than maxdist from
+ * the focus are left out, so that the branches of parabolas and
+ * hyperbolas are cut at a finite distance.  Consecutive pieces share
+ * their end points, unless there is a gap between them.
+ */
+const std::vector<RationalQuadData> calcConicBezierPieces(const ConicPolarData &d, double maxdist, double startangle, double angle);
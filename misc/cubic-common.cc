@@ -6,6 +6,10 @@
 #include "kignumerics.h"
 #include "kigtransform.h"
 
+#include <algorithm>
+#include <map>
+#include <set>
+
 #include <config-kig.h>
 
 #ifdef HAVE_IEEEFP_H
@@ -501,3 +505,240 @@ bool CubicCartesianData::valid() const
 {
     return std::isfinite(coeffs[0]);
 }
+
+/*
+ * Tracing a cubic as polylines ( see calcCubicPolylines ).
+ */
+
+static double calcCubicValue(const CubicCartesianData &data, double x, double y)
+{
+    const double *a = data.coeffs;
+    return a[0] + x * (a[1] + x * (a[3] + x * a[6] + y * a[7])) + y * (a[2] + y * (a[5] + y * a[9] + x * a[8]) + x * a[4]);
+}
+
+/*
+ * Return whether the cubic may meet the square with center ( x, y )
+ * and half side h.  We write the cubic in terms of u = X - x and v = Y
+ * - y, and check whether the constant term can be compensated by the
+ * others for |u|, |v| <= h.  If we return false, the closed square
+ * does certainly not contain a point of the cubic.
+ */
+static bool cubicMayMeetSquare(const CubicCartesianData &data, double x, double y, double h)
+{
+    const double *a = data.coeffs;
+    const double f = calcCubicValue(data, x, y);
+    const double fx = a[1] + 2 * a[3] * x + a[4] * y + 3 * a[6] * x * x + 2 * a[7] * x * y + a[8] * y * y;
+    const double fy = a[2] + a[4] * x + 2 * a[5] * y + a[7] * x * x + 2 * a[8] * x * y + 3 * a[9] * y * y;
+    const double fxx = a[3] + 3 * a[6] * x + a[7] * y;
+    const double fxy = a[4] + 2 * a[7] * x + 2 * a[8] * y;
+    const double fyy = a[5] + a[8] * x + 3 * a[9] * y;
+    const double third = fabs(a[6]) + fabs(a[7]) + fabs(a[8]) + fabs(a[9]);
+    const double bound = h * (fabs(fx) + fabs(fy) + h * (fabs(fxx) + fabs(fxy) + fabs(fyy) + h * third));
+    // be a little generous, to not lose anything to rounding errors..
+    return fabs(f) <= bound * (1 + 1e-9) + 1e-14;
+}
+
+/*
+ * The state shared by the functions tracing a cubic: the grid of leaf
+ * cells has its origin in ( x0, y0 ), and cells of size cell.  Grid
+ * nodes are numbered by their column i and row j.
+ */
+struct CubicTracer {
+    const CubicCartesianData &data;
+    double x0;
+    double y0;
+    double cell;
+    // the leaf cells that may contain a part of the cubic
+    std::vector<std::pair<int, int>> leaves;
+    // the crossing point of the cubic on every grid edge it crosses,
+    // and the edges that are connected to it through a cell
+    std::map<long long, Coordinate> crossings;
+    std::map<long long, std::vector<long long>> links;
+
+    CubicTracer(const CubicCartesianData &d, double nx0, double ny0, double ncell)
+        : data(d)
+        , x0(nx0)
+        , y0(ny0)
+        , cell(ncell)
+    {
+    }
+
+    Coordinate node(int i, int j) const
+    {
+        return Coordinate(x0 + i * cell, y0 + j * cell);
+    }
+
+    double value(int i, int j) const
+    {
+        const Coordinate c = node(i, j);
+        return calcCubicValue(data, c.x, c.y);
+    }
+
+    // horizontal edges go from node ( i, j ) to ( i + 1, j ), vertical
+    // ones from ( i, j ) to ( i, j + 1 )
+    static long long edgeKey(int i, int j, bool vertical)
+    {
+        return ((static_cast<long long>(i) << 32 | static_cast<unsigned int>(j)) << 1) | (vertical ? 1 : 0);
+    }
+
+    void collectLeaves(int i, int j, int level);
+    void addEdge(int i, int j, bool vertical);
+    void linkEdges(long long a, long long b);
+    void contourLeaf(int i, int j);
+};
+
+void CubicTracer::collectLeaves(int i, int j, int level)
+{
+    // the cell with lower left node ( i, j ) and side 2^level cells
+    const int n = 1 << level;
+    const double h = 0.5 * n * cell;
+    const Coordinate c = node(i, j) + Coordinate(h, h);
+    if (!cubicMayMeetSquare(data, c.x, c.y, h))
+        return;
+    if (level == 0) {
+        leaves.push_back(std::make_pair(i, j));
+        return;
+    }
+    const int m = n / 2;
+    collectLeaves(i, j, level - 1);
+    collectLeaves(i + m, j, level - 1);
+    collectLeaves(i, j + m, level - 1);
+    collectLeaves(i + m, j + m, level - 1);
+}
+
+void CubicTracer::addEdge(int i, int j, bool vertical)
+{
+    const long long key = edgeKey(i, j, vertical);
+    if (crossings.find(key) != crossings.end())
+        return;
+
+    // find the root of the cubic on the edge by Newton's method,
+    // safeguarded by bisection.  The edge is always handled in the
+    // same direction, so neighbouring cells agree on the point.
+    const Coordinate a = node(i, j);
+    const Coordinate dir = vertical ? Coordinate(0, cell) : Coordinate(cell, 0);
+    double lo = 0;
+    double hi = 1;
+    double flo = calcCubicValue(data, a.x, a.y);
+    const double fhi = vertical ? value(i, j + 1) : value(i + 1, j);
+    double t = flo == fhi ? 0.5 : flo / (flo - fhi);
+    for (int k = 0; k < 20; ++k) {
+        const Coordinate p = a + t * dir;
+        const double f = calcCubicValue(data, p.x, p.y);
+        if (f == 0)
+            break;
+        if ((f < 0) == (flo < 0)) {
+            lo = t;
+            flo = f;
+        } else
+            hi = t;
+        // the derivative along the edge..
+        const double *c = data.coeffs;
+        const double fx = c[1] + 2 * c[3] * p.x + c[4] * p.y + 3 * c[6] * p.x * p.x + 2 * c[7] * p.x * p.y + c[8] * p.y * p.y;
+        const double fy = c[2] + c[4] * p.x + 2 * c[5] * p.y + c[7] * p.x * p.x + 2 * c[8] * p.x * p.y + 3 * c[9] * p.y * p.y;
+        const double df = cell * (vertical ? fy : fx);
+        double nt = df != 0 ? t - f / df : -1;
+        if (!(nt > lo && nt < hi))
+            nt = (lo + hi) / 2;
+        if (fabs(nt - t) < 1e-12)
+            break;
+        t = nt;
+    }
+    crossings[key] = a + t * dir;
+}
+
+void CubicTracer::linkEdges(long long a, long long b)
+{
+    links[a].push_back(b);
+    links[b].push_back(a);
+}
+
+void CubicTracer::contourLeaf(int i, int j)
+{
+    // the corners, counterclockwise from the lower left one, and the
+    // edges, where edge k goes from corner k to corner k + 1.  A
+    // point on the cubic counts as positive.
+    const bool pos[4] = {value(i, j) >= 0, value(i + 1, j) >= 0, value(i + 1, j + 1) >= 0, value(i, j + 1) >= 0};
+    const int ei[4] = {i, i + 1, i, i};
+    const int ej[4] = {j, j, j + 1, j};
+    const bool ev[4] = {false, true, false, true};
+
+    long long keys[4];
+    int crossed[4];
+    int numcrossed = 0;
+    for (int k = 0; k < 4; ++k) {
+        keys[k] = edgeKey(ei[k], ej[k], ev[k]);
+        if (pos[k] != pos[(k + 1) % 4]) {
+            addEdge(ei[k], ej[k], ev[k]);
+            crossed[numcrossed++] = k;
+        }
+    }
+
+    if (numcrossed == 2)
+        linkEdges(keys[crossed[0]], keys[crossed[1]]);
+    else if (numcrossed == 4) {
+        // a saddle: the sign in the center tells us which corners are
+        // connected, and we cut off the other ones.  Corner k lies
+        // between edges k - 1 and k.
+        const Coordinate c = node(i, j) + Coordinate(cell / 2, cell / 2);
+        const bool center = calcCubicValue(data, c.x, c.y) >= 0;
+        for (int k = 0; k < 4; ++k)
+            if (pos[k] != center)
+                linkEdges(keys[(k + 3) % 4], keys[k]);
+    }
+}
+
+const std::vector<std::vector<Coordinate>> calcCubicPolylines(const CubicCartesianData &data, const Rect &rect, double precision)
+{
+    std::vector<std::vector<Coordinate>> ret;
+    const Rect r = rect.normalized();
+    if (!data.valid() || !(precision > 0) || !(r.width() > 0) || !(r.height() > 0))
+        return ret;
+
+    // a square of 2^level cells covering r..
+    const double size = std::max(r.width(), r.height());
+    int level = 0;
+    while ((1 << level) * precision < size && level < 16)
+        ++level;
+    const double cell = size / (1 << level);
+
+    CubicTracer tracer(data, r.left(), r.bottom(), cell);
+    tracer.collectLeaves(0, 0, level);
+    for (std::vector<std::pair<int, int>>::const_iterator i = tracer.leaves.begin(); i != tracer.leaves.end(); ++i)
+        tracer.contourLeaf(i->first, i->second);
+
+    // now walk along the links: first from the open ends, then around
+    // the loops that remain..
+    std::set<long long> visited;
+    for (int pass = 0; pass < 2; ++pass) {
+        for (std::map<long long, std::vector<long long>>::const_iterator i = tracer.links.begin(); i != tracer.links.end(); ++i) {
+            if (visited.count(i->first) || (pass == 0 && i->second.size() != 1))
+                continue;
+            std::vector<Coordinate> line;
+            long long prev = -1;
+            long long cur = i->first;
+            for (;;) {
+                visited.insert(cur);
+                line.push_back(tracer.crossings[cur]);
+                const std::vector<long long> &next = tracer.links[cur];
+                long long n = -1;
+                for (std::vector<long long>::const_iterator j = next.begin(); j != next.end(); ++j)
+                    if (*j != prev && !visited.count(*j)) {
+                        n = *j;
+                        break;
+                    }
+                if (n == -1) {
+                    // close the loop if we are back at the start..
+                    if (pass == 1 && std::find(next.begin(), next.end(), i->first) != next.end())
+                        line.push_back(line.front());
+                    break;
+                }
+                prev = cur;
+                cur = n;
+            }
+            if (line.size() > 1)
+                ret.push_back(line);
+        }
+    }
+    return ret;
+}
@@ -92,3 +92,16 @@ const Coordinate calcCubicLineIntersect(const CubicCartesianData &c, const LineD
 void calcCubicLineRestriction(const CubicCartesianData &data, const Coordinate &p1, const Coordinate &dir, double &a, double &b, double &c, double &d);
 
 const CubicCartesianData calcCubicTransformation(const CubicCartesianData &data, const Transformation &t, bool &valid);
+
+/**
+ * This function traces the part of the cubic inside the rect r as a
+ * set of polylines, with the vertices lying exactly on the cubic.  It
+ * works on the implicit equation instead of on the parametrization of
+ * CubicImp::getPoint(), so that it does not break up at nodes and
+ * cusps: the rect is recursively divided into square cells, cells
+ * that provably do not meet the cubic are dropped, and the remaining
+ * cells of size precision are contoured by marching squares.  The
+ * polylines are connected across cells, and are closed ( the last
+ * point equal to the first ) for loops that lie entirely inside r.
+ */
+const std::vector<std::vector<Coordinate>> calcCubicPolylines(const CubicCartesianData &data, const Rect &r, double precision);
@@ -8,6 +8,8 @@
 #include "kignumerics.h"
 #include "common.h"
 
+#include <algorithm>
+
 using std::fabs;
 
 /*
@@ -82,177 +84,166 @@ double calcCubicRoot(double xmin, double xmax, double a, double b, double c, dou
         return rootmiddle - discrim;
     }
 
-    if (xmin < -1e8 || xmax > 1e8) {
-        // compute a bound for all the real roots:
-
-        xmax = fabs(d / a);
-        if (fabs(c / a) + 1 > xmax)
-            xmax = fabs(c / a) + 1;
-        if (fabs(b / a) + 1 > xmax)
-            xmax = fabs(b / a) + 1;
-        xmin = -xmax;
-    }
+    double roots[3];
+    int total = calcCubicRoots(a, b, c, d, roots);
 
-    // computing the coefficients of the Sturm sequence
+    // the roots keep the numbering given by the Sturm sequence, which
+    // starts after the number of variations at -infinity: this is what
+    // makes the parametrization of CubicImp continuous when two roots
+    // collide and disappear.  Only the signs of the leading coefficients
+    // of the sequence are needed for that.
     double p1a = 2 * b * b - 6 * a * c;
     double p1b = b * c - 9 * a * d;
     double p0a = c * p1a * p1a + p1b * (3 * a * p1b - 2 * b * p1a);
-
-    int varbottom = calcCubicVariations(xmin, a, b, c, d, p1a, p1b, p0a);
-    int vartop = calcCubicVariations(xmax, a, b, c, d, p1a, p1b, p0a);
+    bool f1pos = p1a < 0 || (p1a == 0 && p1b >= 0);
+    bool f0pos = p0a >= 0;
+    int varinf = (f1pos ? 1 : 0) + (f1pos != f0pos ? 1 : 0);
+    varinf = std::min(varinf, 3 - total);
+
+    int varbottom = varinf;
+    int vartop = varinf;
+    for (int i = 0; i < total; ++i) {
+        if (roots[i] < xmin)
+            ++varbottom;
+        if (roots[i] <= xmax)
+            ++vartop;
+    }
     numroots = vartop - varbottom;
     valid = false;
     if (root <= varbottom || root > vartop)
         return 0.0;
 
     valid = true;
-
-    // now use bisection to separate the required root
-    double dx = (xmax - xmin) / 2;
-    while (vartop - varbottom > 1) {
-        if (fabs(dx) < 1e-8)
-            return (xmin + xmax) / 2;
-        double xmiddle = xmin + dx;
-        int varmiddle = calcCubicVariations(xmiddle, a, b, c, d, p1a, p1b, p0a);
-        if (varmiddle < root) // I am below
-        {
-            xmin = xmiddle;
-            varbottom = varmiddle;
-        } else {
-            xmax = xmiddle;
-            vartop = varmiddle;
-        }
-        dx /= 2;
-    }
-
-    /*
-     * now [xmin, xmax] enclose a single root, try using Newton
-     */
-    if (vartop - varbottom == 1) {
-        double fval1 = a; // double check...
-        double fval2 = a;
-        fval1 = b + xmin * fval1;
-        fval2 = b + xmax * fval2;
-        fval1 = c + xmin * fval1;
-        fval2 = c + xmax * fval2;
-        fval1 = d + xmin * fval1;
-        fval2 = d + xmax * fval2;
-        assert(fval1 * fval2 <= 0);
-        return calcCubicRootwithNewton(xmin, xmax, a, b, c, d, 1e-8);
-    } else // probably a double root here!
-        return (xmin + xmax) / 2;
+    return roots[root - varinf - 1];
 }
 
 /*
- * computation of the number of sign changes in the sturm sequence for
- * a third degree polynomial at x.  This number counts the number of
- * roots of the polynomial on the left of point x.
- *
- * a, b, c, d: coefficients of the third degree polynomial (a*x^3 + ...)
- *
- * the second degree polynomial in the sturm sequence is just minus the
- * derivative, so we don't need to compute it.
- *
- * p1a*x + p1b: is the third (first degree) polynomial in the sturm sequence.
- *
- * p0a: is the (constant) fourth polynomial of the sturm sequence.
+ * the value and the derivative of a*x^3 + b*x^2 + c*x + d at x
  */
 
-int calcCubicVariations(double x, double a, double b, double c, double d, double p1a, double p1b, double p0a)
+static inline void calcCubicValue(double x, double a, double b, double c, double d, double &fval, double &fpval)
 {
-    double fval, fpval;
     fval = fpval = a;
     fval = b + x * fval;
     fpval = fval + x * fpval;
     fval = c + x * fval;
     fpval = fval + x * fpval;
     fval = d + x * fval;
-
-    double f1val = p1a * x + p1b;
-
-    bool f3pos = fval >= 0;
-    bool f2pos = fpval <= 0;
-    bool f1pos = f1val >= 0;
-    bool f0pos = p0a >= 0;
-
-    int variations = 0;
-    if (f3pos != f2pos)
-        variations++;
-    if (f2pos != f1pos)
-        variations++;
-    if (f1pos != f0pos)
-        variations++;
-    return variations;
 }
 
 /*
- * use newton to solve a third degree equation with already isolated
- * root
+ * polish a root with a Newton step.  The closed formulas only lose
+ * accuracy through cancellation, which one step repairs; a step that
+ * is not small is a sign of a nearly multiple root, where Newton
+ * doesn't help, so we don't take it.
  */
 
-inline void calcCubicDerivatives(double x, double a, double b, double c, double d, double &fval, double &fpval, double &fppval)
+static inline double polishCubicRoot(double x, double a, double b, double c, double d)
 {
-    fval = fpval = fppval = a;
-    fval = b + x * fval;
-    fpval = fval + x * fpval;
-    fppval = fpval + x * fppval; // this is really half the second derivative
-    fval = c + x * fval;
-    fpval = fval + x * fpval;
-    fval = d + x * fval;
+    double fval, fpval;
+    calcCubicValue(x, a, b, c, d, fval, fpval);
+    double dx = fval / fpval;
+    if (fabs(dx) <= 1e-6 * (1 + fabs(x)))
+        x -= dx;
+    return x;
 }
 
-double calcCubicRootwithNewton(double xmin, double xmax, double a, double b, double c, double d, double tol)
+/*
+ * compute all the real roots of a*x^3 + b*x^2 + c*x + d in closed
+ * form: with the trigonometric formula when there are three real
+ * roots, and with Cardano's formula otherwise.  The roots are polished
+ * with Newton and returned in increasing order, a multiple root only
+ * once.
+ */
+
+int calcCubicRoots(double a, double b, double c, double d, double roots[3])
 {
-    double fval, fpval, fppval;
-
-    double fval1, fval2, fpval1, fpval2, fppval1, fppval2;
-    calcCubicDerivatives(xmin, a, b, c, d, fval1, fpval1, fppval1);
-    calcCubicDerivatives(xmax, a, b, c, d, fval2, fpval2, fppval2);
-    assert(fval1 * fval2 <= 0);
-
-    assert(xmax > xmin);
-    while (xmax - xmin > tol) {
-        // compute the values of function, derivative and second derivative:
-        assert(fval1 * fval2 <= 0);
-        if (fppval1 * fppval2 < 0 || fpval1 * fpval2 < 0) {
-            double xmiddle = (xmin + xmax) / 2;
-            calcCubicDerivatives(xmiddle, a, b, c, d, fval, fpval, fppval);
-            if (fval1 * fval <= 0) {
-                xmax = xmiddle;
-                fval2 = fval;
-                fpval2 = fpval;
-                fppval2 = fppval;
-            } else {
-                xmin = xmiddle;
-                fval1 = fval;
-                fpval1 = fpval;
-                fppval1 = fppval;
-            }
+    // renormalize: positive a and infinity norm = 1, and drop the degree
+    // with the same tolerance as calcCubicRoot()
+    double infnorm = std::max(std::max(fabs(a), fabs(b)), std::max(fabs(c), fabs(d)));
+    if (infnorm == 0)
+        return 0;
+    if (a < 0)
+        infnorm = -infnorm;
+    // multiplying by the inverses saves a handful of divisions, which
+    // dominate the cost of the whole computation together with the
+    // transcendental functions
+    double inv = 1 / infnorm;
+    a *= inv;
+    b *= inv;
+    c *= inv;
+    d *= inv;
+
+    const double small = 1e-7;
+    int numroots = 0;
+    if (fabs(a) < small) {
+        if (fabs(b) < small) {
+            if (fabs(c) < small)
+                return 0;
+            roots[0] = -d / c;
+            return 1;
+        }
+        double discrim = c * c - 4 * b * d;
+        if (discrim < 0)
+            return 0;
+        if (discrim == 0) {
+            roots[0] = -c / (2 * b);
+            return 1;
+        }
+        // avoid the cancellation in -c +- sqrt( discrim )
+        double q = -0.5 * (c + (c < 0 ? -1 : 1) * std::sqrt(discrim));
+        roots[0] = q / b;
+        roots[1] = d / q;
+        numroots = 2;
+    } else {
+        // x = t - p/3 gives the depressed cubic t^3 - 3*Q*t + 2*R = 0
+        double inva = 1 / a;
+        double p = b * inva;
+        double q = c * inva;
+        double r = d * inva;
+        double shift = p * (1. / 3);
+        double Q = (p * p - 3 * q) * (1. / 9);
+        double R = (p * (2 * p * p - 9 * q) + 27 * r) * (1. / 54);
+        double Q3 = Q * Q * Q;
+        double R2 = R * R;
+        if (R2 < Q3) {
+            // three distinct real roots: the one of largest modulus of
+            // the depressed cubic with the trigonometric formula, the
+            // other two by deflating to a quadratic, which is cheaper
+            // than two more cosines and as accurate
+            double sqrtQ = std::sqrt(Q);
+            double theta = std::acos(std::max(-1.0, std::min(1.0, R / (sqrtQ * Q))));
+            double t0 = -2 * sqrtQ * std::cos(theta * (1. / 3));
+            double s = -0.5 * (t0 - std::sqrt(std::max(0.0, 12 * Q - 3 * t0 * t0)));
+            roots[0] = t0 - shift;
+            roots[1] = s - shift;
+            roots[2] = (t0 * t0 - 3 * Q) / s - shift;
+            numroots = 3;
         } else {
-            // now we have first and second derivative of constant sign, we
-            // can start with Newton from the Fourier point.
-            double x = xmin;
-            if (fval2 * fppval2 > 0)
-                x = xmax;
-            double p = 1.0;
-            int iterations = 0;
-            while (fabs(p) > tol && iterations++ < 100) {
-                calcCubicDerivatives(x, a, b, c, d, fval, fpval, fppval);
-                p = fval / fpval;
-                x -= p;
+            // one simple real root, and a complex pair which collapses on
+            // a double root when R^2 == Q^3
+            double A = -std::copysign(std::cbrt(fabs(R) + std::sqrt(R2 - Q3)), R);
+            double B = A == 0 ? 0 : Q / A;
+            roots[0] = A + B - shift;
+            numroots = 1;
+            if (fabs(A - B) <= 1e-8 * fabs(A + B)) {
+                roots[1] = -(A + B) / 2 - shift;
+                numroots = 2;
             }
-            if (iterations >= 100) {
-                // Newton scheme did not converge..
-                // we should end up with an invalid Coordinate
-                return double_inf;
-            };
-            return x;
         }
     }
 
-    // we cannot apply Newton, (perhaps we are at an inflection point)
-
-    return (xmin + xmax) / 2;
+    for (int i = 0; i < numroots; ++i)
+        roots[i] = polishCubicRoot(roots[i], a, b, c, d);
+    if (numroots > 1 && roots[1] < roots[0])
+        std::swap(roots[0], roots[1]);
+    if (numroots > 2) {
+        if (roots[2] < roots[1])
+            std::swap(roots[1], roots[2]);
+        if (roots[1] < roots[0])
+            std::swap(roots[0], roots[1]);
+    }
+    return std::unique(roots, roots + numroots) - roots;
 }
 
 /*
@@ -11,9 +11,12 @@
 
 double calcCubicRoot(double xmin, double xmax, double a, double b, double c, double d, int root, bool &valid, int &numroots);
 
-int calcCubicVariations(double x, double a, double b, double c, double d, double p1a, double p1b, double p0a);
-
-double calcCubicRootwithNewton(double ymin, double ymax, double a, double b, double c, double d, double tol);
+/**
+ * Compute all the real roots of a*x^3 + b*x^2 + c*x + d = 0 at once,
+ * in closed form with a final Newton polish.  The distinct roots are
+ * stored in increasing order in roots, and their number is returned.
+ */
+int calcCubicRoots(double a, double b, double c, double d, double roots[3]);
 
 /**
  * Gaussian Elimination.  We return false if the matrix is singular,
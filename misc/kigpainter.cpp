@@ -11,14 +11,17 @@
 #include "../kig/kig_view.h"
 #include "../misc/goniometry.h"
 #include "../objects/curve_imp.h"
+#include "../objects/object_drawer.h"
 #include "../objects/object_holder.h"
 #include "../objects/point_imp.h"
+#include "calcprofiler.h"
 #include "common.h"
 #include "conic-common.h"
 #include "coordinate_system.h"
 #include "cubic-common.h"
 #include "object_hierarchy.h"
 
+#include <QPainterPath>
 #include <QPen>
 #include <QPolygon>
 #include <QTransform>
@@ -26,7 +29,6 @@
 #include <algorithm>
 #include <cmath>
 #include <functional>
-#include <stack>
 
 using std::cos;
 using std::fabs;
@@ -45,8 +47,12 @@ KigPainter::KigPainter(const ScreenInfo &si, QPaintDevice *device, const KigDocu
     , mNeedOverlay(no)
     , overlayenlarge(0)
     , mSelected(false)
+    , mobjectstyle(nullptr)
 {
     mP.setBackground(QBrush(Qt::white));
+    mpen = mP.pen();
+    mbrush = mP.brush();
+    mfont = mP.font();
 }
 
 KigPainter::~KigPainter()
@@ -91,7 +97,7 @@ void KigPainter::drawSegment(const Coordinate &from, const Coordinate &to)
 void KigPainter::drawFatPoint(const Coordinate &p)
 {
     int twidth = width == -1 ? 5 : width;
-    mP.setPen(QPen(color, 1, style));
+    applyPen(QPen(color, 1, style));
     switch (pointstyle) {
     case Kig::Round: {
         double radius = twidth * pixelWidth();
@@ -156,7 +162,7 @@ void KigPainter::drawFatPoint(const Coordinate &p)
         Coordinate br = p + rad;
         Rect r(tl, br);
         QRect qr = toScreen(r);
-        mP.setPen(QPen(color, 2));
+        applyPen(QPen(color, 2));
         mP.drawLine(qr.topLeft(), qr.bottomRight());
         mP.drawLine(qr.topRight(), qr.bottomLeft());
         if (mNeedOverlay)
@@ -167,7 +173,7 @@ void KigPainter::drawFatPoint(const Coordinate &p)
         break;
     }
     }
-    mP.setPen(QPen(color, twidth, style));
+    applyPen(QPen(color, twidth, style));
 }
 
 void KigPainter::drawPoint(const Coordinate &p)
@@ -213,13 +219,13 @@ const Rect KigPainter::boundingRect(const Rect &r, const QString &s, int f) cons
 void KigPainter::setColor(const QColor &c)
 {
     color = c;
-    mP.setPen(QPen(color, width == -1 ? 1 : width, style));
+    applyPen(QPen(color, width == -1 ? 1 : width, style));
 }
 
 void KigPainter::setStyle(Qt::PenStyle c)
 {
     style = c;
-    mP.setPen(QPen(color, width == -1 ? 1 : width, style));
+    applyPen(QPen(color, width == -1 ? 1 : width, style));
 }
 
 void KigPainter::setWidth(int c)
@@ -227,12 +233,13 @@ void KigPainter::setWidth(int c)
     width = c;
     if (c > 0)
         overlayenlarge = c - 1;
-    mP.setPen(QPen(color, width == -1 ? 1 : width, style));
+    applyPen(QPen(color, width == -1 ? 1 : width, style));
 }
 
 void KigPainter::setPointStyle(Kig::PointStyle p)
 {
     pointstyle = p;
+    mobjectstyle = nullptr;
 }
 
 void KigPainter::setPen(const QPen &p)
@@ -240,33 +247,79 @@ void KigPainter::setPen(const QPen &p)
     color = p.color();
     width = p.width();
     style = p.style();
-    mP.setPen(p);
+    applyPen(p);
 }
 
 void KigPainter::setBrush(const QBrush &b)
 {
     brushStyle = b.style();
     brushColor = b.color();
-    mP.setBrush(b);
+    applyBrush(b);
 }
 
 void KigPainter::setBrushStyle(Qt::BrushStyle c)
 {
     brushStyle = c;
-    mP.setBrush(QBrush(brushColor, brushStyle));
+    applyBrush(QBrush(brushColor, brushStyle));
 }
 
 void KigPainter::setBrushColor(const QColor &c)
 {
     brushColor = c;
-    mP.setBrush(QBrush(brushColor, brushStyle));
+    applyBrush(QBrush(brushColor, brushStyle));
 }
 
 void KigPainter::setFont(const QFont &f)
 {
+    mobjectstyle = nullptr;
+    if (f == mfont)
+        return;
+    mfont = f;
     mP.setFont(f);
 }
 
+void KigPainter::applyPen(const QPen &p)
+{
+    mobjectstyle = nullptr;
+    if (p == mpen)
+        return;
+    mpen = p;
+    mP.setPen(p);
+}
+
+void KigPainter::applyBrush(const QBrush &b)
+{
+    mobjectstyle = nullptr;
+    if (b == mbrush)
+        return;
+    mbrush = b;
+    mP.setBrush(b);
+}
+
+void KigPainter::setObjectStyle(const ObjectStyle &s, const QColor &c)
+{
+    if (mobjectstyle == &s && mobjectstylecolor == c)
+        return;
+    // this does what setBrushStyle( Qt::NoBrush ), setBrushColor( c ),
+    // setPen( QPen( c, 1 ) ), setWidth( s.width() ),
+    // setStyle( s.style() ), setPointStyle( s.pointStyle() ) and
+    // setFont( s.font() ) would do, with one call to mP for each of
+    // the pen, the brush and the font at most..
+    color = c;
+    width = s.width();
+    style = s.style();
+    pointstyle = s.pointStyle();
+    brushStyle = Qt::NoBrush;
+    brushColor = c;
+    if (width > 0)
+        overlayenlarge = width - 1;
+    applyPen(QPen(color, width == -1 ? 1 : width, style));
+    applyBrush(QBrush(brushColor, brushStyle));
+    setFont(s.font());
+    mobjectstyle = &s;
+    mobjectstylecolor = c;
+}
+
 bool KigPainter::getNightVision() const
 {
     return mdoc.getNightVision();
@@ -427,6 +480,41 @@ void KigPainter::circleOverlay(const Coordinate &centre, double radius)
     circleOverlayRecurse(centre, radius * radius, rect);
 }
 
+void KigPainter::arcOverlay(const Coordinate &centre, double radius, double startangle, double angle)
+{
+    if (angle < 0) {
+        startangle += angle;
+        angle = -angle;
+    }
+    if (angle > 2 * M_PI) {
+        circleOverlay(centre, radius);
+        return;
+    }
+
+    // we cut the arc in pieces of about overlayRectSize() long, and
+    // cover each of them with the bounding rect of its end points,
+    // enlarged by the distance between the piece and its chord..
+    const int n = std::min(std::max(1, static_cast<int>(std::ceil(radius * angle / overlayRectSize()))), 500);
+    const double step = angle / n;
+    const double sagitta = radius * (1 - cos(step / 2)) + pixelWidth();
+    const Rect border = window();
+
+    Coordinate a = centre + radius * Coordinate(cos(startangle), sin(startangle));
+    for (int i = 1; i <= n; ++i) {
+        const double t = startangle + i * step;
+        const Coordinate b = centre + radius * Coordinate(cos(t), sin(t));
+        Rect r(a, b);
+        r.normalize();
+        r.setLeft(r.left() - sagitta);
+        r.setRight(r.right() + sagitta);
+        r.setBottom(r.bottom() - sagitta);
+        r.setTop(r.top() + sagitta);
+        if (r.intersects(border))
+            mOverlay.push_back(toScreenEnlarge(r));
+        a = b;
+    }
+}
+
 void KigPainter::segmentOverlay(const Coordinate &p1, const Coordinate &p2)
 {
     // this code is based upon what Marc Bartsch wrote for KGeo
@@ -606,20 +694,6 @@ void KigPainter::drawRay(const Coordinate &a, const Coordinate &b)
     drawSegment(a, tb);
 }
 
-typedef std::pair<double, Coordinate> coordparampair;
-
-struct workitem {
-    workitem(const coordparampair &f, const coordparampair &s, Rect *o)
-        : first(f)
-        , second(s)
-        , overlay(o)
-    {
-    }
-    coordparampair first;
-    coordparampair second;
-    Rect *overlay;
-};
-
 void KigPainter::drawLine(const LineData &d)
 {
     if (d.a != d.b) {
@@ -665,9 +739,10 @@ void KigPainter::drawAngle(const Coordinate &point, double startangle, double an
     setBrushStyle(Qt::SolidPattern);
     mP.drawPolygon(arrow);
 
-    //  if ( mNeedOverlay ) mOverlay.push_back( toScreen( r ) );
-    setWholeWinOverlay(); // mp: ugly! why not compute a correct overlay?
-                          //     mOverlay.push_back( arrow.boundingRect() );
+    if (mNeedOverlay) {
+        arcOverlay(point, radius * pixelWidth(), startangle, angle);
+        mOverlay.push_back(arrow.boundingRect().adjusted(-1, -1, 1, 1));
+    }
 }
 
 void KigPainter::drawRightAngle(const Coordinate &point, double startangle, int diagonal)
@@ -686,7 +761,10 @@ void KigPainter::drawRightAngle(const Coordinate &point, double startangle, int
 
     mP.drawPolyline(rightAnglePolygon);
 
-    setWholeWinOverlay();
+    if (mNeedOverlay) {
+        const int enlarge = overlayenlarge + 1;
+        mOverlay.push_back(rightAnglePolygon.boundingRect().adjusted(-enlarge, -enlarge, enlarge, enlarge));
+    }
 }
 
 void KigPainter::drawPolygon(const std::vector<Coordinate> &pts, Qt::FillRule fillRule)
@@ -716,11 +794,11 @@ void KigPainter::drawVector(const Coordinate &a, const Coordinate &b)
     Coordinate c = b - dir + perp;
     Coordinate d = b - dir - perp;
     // draw the arrow lines with a normal style
-    mP.setPen(QPen(color, width == -1 ? 1 : width, Qt::SolidLine));
+    applyPen(QPen(color, width == -1 ? 1 : width, Qt::SolidLine));
     drawSegment(b, c);
     drawSegment(b, d);
     // setting again the original style
-    mP.setPen(QPen(color, width == -1 ? 1 : width, style));
+    applyPen(QPen(color, width == -1 ? 1 : width, style));
 }
 
 /* *** this function is commented out ***
@@ -768,165 +846,157 @@ const double CurveImpPointCalcer::endinterval = 1.;
 
 void KigPainter::drawCurve(const CurveImp *curve)
 {
-    // we manage our own overlay
-    bool tNeedOverlay = mNeedOverlay;
-    mNeedOverlay = false;
+    CalcProfiler::Scope scope(CalcProfiler::Drawing, curve->type()->internalName());
+    // the curve is flattened to within a pixel, the points of a locus
+    // are calculated a level of the bisection at a time..
+    const std::vector<std::vector<Coordinate>> lines = calcCurvePolylines(curve, mdoc, window(), pixelWidth(), 1000);
+
+    for (std::vector<std::vector<Coordinate>>::const_iterator i = lines.begin(); i != lines.end(); ++i) {
+        QPolygonF poly;
+        poly.reserve(i->size());
+        for (std::vector<Coordinate>::const_iterator j = i->begin(); j != i->end(); ++j)
+            poly << toScreenF(*j);
+        mP.drawPolyline(poly);
+        if (mNeedOverlay)
+            polylineOverlay(*i);
+    }
+}
 
-    QPen pen = mP.pen();
-
-    // this stack contains pairs of Coordinates ( parameter intervals )
-    // that we still need to process:
-    std::stack<workitem> workstack;
-    // mp: this stack contains all the generated overlays:
-    // the strategy for generating the overlay structure is the same
-    // recursive-like used to draw the segments: a new rectangle is
-    // generated whenever the length of a segment becomes lower than
-    // overlayRectSize(), or if the segment would be drawn anyway
-    // to avoid strange things from happening we impose that the distance
-    // in parameter space be less than a threshold before generating
-    // any overlay.
-    //
-    // The third parameter in workitem is a pointer into a stack of
-    // all generated rectangles (in real coordinate space); if 0
-    // there is no rectangles associated to that segment yet.
-    //
-    // Using the final mOverlay stack would be much more efficient, but
-    // 1. needs transformations into window space
-    // 2. would be more difficult to drop rectangles not intersecting
-    //    the window.
-    std::stack<Rect> overlaystack;
-
-    // mp: the original version in which an initial set of 20 intervals
-    // were pushed onto the stack is replaced by a single interval and
-    // by forcing subdivision till h < hmax (with more or less the same
-    // final result).
-    // First push the [0,1] interval into the stack:
-
-    Coordinate coo1 = curve->getPoint(0., mdoc);
-    Coordinate coo2 = curve->getPoint(1., mdoc);
-    workstack.push(workitem(coordparampair(0., coo1), coordparampair(1., coo2), nullptr));
-
-    // maxlength is the square of the maximum size that we allow
-    // between two points..
-    double maxlength = 1.5 * pixelWidth();
-    maxlength *= maxlength;
-    // error squared is required to be less that sigma (half pixel)
-    double sigma = maxlength / 4;
-    // distance between two parameter values cannot be too small
-    double hmin = 3e-5;
-    // distance between two parameter values cannot be too large
-    double hmax = 1. / 40;
-    double hmaxoverlay = 1. / 8;
-
-    int count = 1; // the number of segments we've already
-                   // visited...
-    static const int maxnumberofpoints = 1000;
-
-    const Rect &sr = window();
-
-    // what this algorithm does is approximating the curve with a set of
-    // segments.  we don't draw the individual segments, but use
-    // QPainter::drawPolyline() so that the line styles work properly.
-    // Possibly there are performance advantages as well ?  this array
-    // is a buffer of the polyline approximation of the part of the
-    // curve that we are currently processing.
-    QPolygon curpolyline(1000);
-    int curpolylinenextfree = 0;
-
-    // we don't use recursion, but a stack based approach for efficiency
-    // concerns...
-    while (!workstack.empty() && count < maxnumberofpoints) {
-        workitem curitem = workstack.top();
-        workstack.pop();
-        bool curitemok = true;
-        while (curitemok && count++ < maxnumberofpoints) {
-            double t0 = curitem.first.first;
-            double t1 = curitem.second.first;
-            Coordinate p0 = curitem.first.second;
-            bool valid0 = p0.valid();
-            Coordinate p1 = curitem.second.second;
-            bool valid1 = p1.valid();
-
-            // we take the middle parameter of the two previous points...
-            double t2 = (t0 + t1) / 2;
-            double h = fabs(t1 - t0) / 2;
-
-            // if exactly one of the two endpoints is invalid, then
-            // we prefer to find an internal value of the parameter
-            // separating valid points from invalid points.  We use
-            // a bisection strategy (this is not implemented yet!)
-            //      if ( ( valid0 && ! valid1 ) || ( valid1 && ! valid0 ) )
-            //      {
-            //	while ( h >= hmin )
-            //	{
-            //	  .......................................
-            //	}
-            //      }
-
-            Rect *overlaypt = curitem.overlay;
-            Coordinate p2 = curve->getPoint(t2, mdoc);
-            bool allvalid = p2.valid() && valid0 && valid1;
-            bool dooverlay =
-                !overlaypt && h < hmaxoverlay && valid0 && valid1 && fabs(p0.x - p1.x) <= overlayRectSize() && fabs(p0.y - p1.y) <= overlayRectSize();
-            bool addn = sr.contains(p2) || h >= hmax;
-            // estimated error between the curve and the segments
-            double errsq = 1e21;
-            if (allvalid)
-                errsq = (0.5 * p0 + 0.5 * p1 - p2).squareLength();
-            errsq /= 4;
-            curitemok = false;
-            //      bool dodraw = allvalid && h < hmax && ( errsq < sigma || h < hmin );
-            bool dodraw = allvalid && h < hmax && errsq < sigma;
-            if (tNeedOverlay && (dooverlay || dodraw)) {
-                Rect newoverlay(p0, p1);
-                overlaystack.push(newoverlay);
-                overlaypt = &overlaystack.top();
-            }
-            if (overlaypt)
-                overlaypt->setContains(p2);
-            if (dodraw) {
-                // draw the two segments
-                QPoint tp0 = toScreen(p0);
-                QPoint tp1 = toScreen(p1);
-                QPoint tp2 = toScreen(p2);
-                if (curpolylinenextfree > 0 && curpolyline[curpolylinenextfree - 1] != tp1) {
-                    // flush the current part of the curve
-                    mP.drawPolyline(curpolyline.constData(), curpolylinenextfree);
-                    curpolylinenextfree = 0;
-                }
-                if (curpolylinenextfree == 0)
-                    curpolyline[curpolylinenextfree++] = tp1;
-                curpolyline[curpolylinenextfree++] = tp2;
-                curpolyline[curpolylinenextfree++] = tp0;
-            } else if (h >= hmin) // we do not continue to subdivide indefinitely!
-            {
-                // push into stack in order to process both subintervals
-                if (addn || (valid0 && sr.contains(p0)))
-                    workstack.push(workitem(curitem.first, coordparampair(t2, p2), overlaypt));
-                if (addn || (valid1 && sr.contains(p1))) {
-                    curitem = workitem(coordparampair(t2, p2), curitem.second, overlaypt);
-                    curitemok = true;
-                }
-            }
-        }
+void KigPainter::quadOverlay(const QPointF &a, const QPointF &b, const QPointF &c, int depth)
+{
+    // the curve lies in the convex hull of its control points, so
+    // their bounding rect contains it..
+    const double minx = std::min(std::min(a.x(), b.x()), c.x());
+    const double maxx = std::max(std::max(a.x(), b.x()), c.x());
+    const double miny = std::min(std::min(a.y(), b.y()), c.y());
+    const double maxy = std::max(std::max(a.y(), b.y()), c.y());
+
+    const QRect border = msi.viewRect();
+    if (maxx < border.left() || minx > border.right() || maxy < border.top() || miny > border.bottom())
+        return;
+
+    // the overlay rect size, in pixels..
+    const double size = 20;
+    if ((maxx - minx <= size && maxy - miny <= size) || depth > 16) {
+        QRect r(QPoint(static_cast<int>(std::floor(minx)), static_cast<int>(std::floor(miny))),
+                QPoint(static_cast<int>(std::ceil(maxx)), static_cast<int>(std::ceil(maxy))));
+        const int enlarge = overlayenlarge + 1;
+        mOverlay.push_back(r.adjusted(-enlarge, -enlarge, enlarge, enlarge));
+        return;
     }
-    // flush the rest of the curve
-    mP.drawPolyline(curpolyline.constData(), curpolylinenextfree);
-    curpolylinenextfree = 0;
-
-    if (!workstack.empty())
-        qDebug() << "Stack not empty in KigPainter::drawCurve!\n";
-    assert(tNeedOverlay || overlaystack.empty());
-    if (tNeedOverlay) {
-        Rect border = window();
-        while (!overlaystack.empty()) {
-            Rect overlay = overlaystack.top();
-            overlaystack.pop();
-            if (overlay.intersects(border))
-                mOverlay.push_back(toScreenEnlarge(overlay));
+
+    // subdivide the curve in its middle, and handle both halves..
+    const QPointF ab = (a + b) / 2;
+    const QPointF bc = (b + c) / 2;
+    const QPointF m = (ab + bc) / 2;
+    quadOverlay(a, ab, m, depth + 1);
+    quadOverlay(m, bc, c, depth + 1);
+}
+
+void KigPainter::rationalQuadTo(QPainterPath &path, const QPointF &a, const QPointF &b, const QPointF &c, double w, int level)
+{
+    if (level == 0) {
+        path.quadTo(b, c);
+        if (mNeedOverlay)
+            quadOverlay(a, b, c);
+        return;
+    }
+    // split in the middle: both halves are again rational quadratic
+    // curves, with a weight closer to 1..
+    const double scale = 1 / (1 + w);
+    const double nw = std::sqrt(0.5 + 0.5 * w);
+    const QPointF wb = w * b;
+    const QPointF m = (a + 2 * wb + c) * (0.5 * scale);
+    rationalQuadTo(path, a, (a + wb) * scale, m, nw, level - 1);
+    rationalQuadTo(path, m, (wb + c) * scale, c, nw, level - 1);
+}
+
+void KigPainter::drawConic(const ConicPolarData &data, double startangle, double angle)
+{
+    // no point of the conic farther from the focus than every corner
+    // of the window can be visible..
+    const Rect sr = window();
+    const Coordinate corners[4] = {sr.topLeft(), sr.topRight(), sr.bottomLeft(), sr.bottomRight()};
+    double maxdist = 0;
+    for (int i = 0; i < 4; ++i)
+        maxdist = std::max(maxdist, (corners[i] - data.focus1).length());
+    maxdist += overlayRectSize();
+
+    const std::vector<RationalQuadData> pieces = calcConicBezierPieces(data, maxdist, startangle, angle);
+
+    QPainterPath path;
+    QPointF last;
+    for (std::vector<RationalQuadData>::const_iterator i = pieces.begin(); i != pieces.end(); ++i) {
+        const QPointF a = toScreenF(i->a);
+        const QPointF b = toScreenF(i->b);
+        const QPointF c = toScreenF(i->c);
+        if (i == pieces.begin() || a != last)
+            path.moveTo(a);
+
+        // replacing a rational quadratic curve by a plain quadratic one
+        // makes an error of about ( w - 1 ) / ( 4 ( w + 1 ) ) | a - 2b +
+        // c |, and splitting it in two divides that by about 4.  We want
+        // it below a quarter of a pixel.
+        const QPointF ev = (a - 2 * b + c) * ((i->w - 1) / (4 * (i->w + 1)));
+        double error = std::sqrt(ev.x() * ev.x() + ev.y() * ev.y());
+        int level = 0;
+        for (; level < 5 && error > 0.25; ++level)
+            error /= 4;
+
+        rationalQuadTo(path, a, b, c, i->w, level);
+        last = c;
+    }
+
+    QBrush oldbrush = mP.brush();
+    applyBrush(Qt::NoBrush);
+    mP.drawPath(path);
+    applyBrush(oldbrush);
+}
+
+void KigPainter::polylineOverlay(const std::vector<Coordinate> &pts)
+{
+    if (pts.empty())
+        return;
+    // we grow a rect along the polyline, and start a new one from the
+    // last point whenever it gets larger than overlayRectSize()..
+    const Rect border = window();
+    Rect r(pts.front(), 0, 0);
+    for (std::vector<Coordinate>::const_iterator i = pts.begin() + 1; i != pts.end(); ++i) {
+        Rect nr = r;
+        nr.setContains(*i);
+        if (nr.width() > overlayRectSize() || nr.height() > overlayRectSize()) {
+            if (r.intersects(border))
+                mOverlay.push_back(toScreenEnlarge(r));
+            nr = Rect(*(i - 1), 0, 0);
+            nr.setContains(*i);
         }
+        r = nr;
+    }
+    if (r.intersects(border))
+        mOverlay.push_back(toScreenEnlarge(r));
+}
+
+void KigPainter::drawCubic(const CubicCartesianData &data)
+{
+    // cells of a few pixels are enough to get the topology of the
+    // curve right, the vertices are computed exactly anyway..
+    const double cell = 3 * pixelWidth();
+    Rect r = window();
+    r.setLeft(r.left() - cell);
+    r.setRight(r.right() + cell);
+    r.setBottom(r.bottom() - cell);
+    r.setTop(r.top() + cell);
+    const std::vector<std::vector<Coordinate>> lines = calcCubicPolylines(data, r, cell);
+
+    for (std::vector<std::vector<Coordinate>>::const_iterator i = lines.begin(); i != lines.end(); ++i) {
+        QPolygonF poly;
+        poly.reserve(i->size());
+        for (std::vector<Coordinate>::const_iterator j = i->begin(); j != i->end(); ++j)
+            poly << toScreenF(*j);
+        mP.drawPolyline(poly);
+        if (mNeedOverlay)
+            polylineOverlay(*i);
     }
-    mNeedOverlay = tNeedOverlay;
 }
 
 void KigPainter::drawTextFrame(const Rect &frame, const QString &s, bool needframe)
@@ -968,6 +1038,7 @@ void KigPainter::drawArc(const Coordinate &center, double radius, double dstarta
         QRectF rect = toScreenF(krect);
 
         mP.drawArc(rect, startangle, angle);
-        setWholeWinOverlay();
+        if (mNeedOverlay)
+            arcOverlay(center, radius, dstartangle, dangle);
     }
 }
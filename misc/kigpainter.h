@@ -20,11 +20,15 @@
 
 class KigWidget;
 class QPaintDevice;
+class QPainterPath;
 class CoordinateSystem;
 class LineData;
+class ConicPolarData;
+class CubicCartesianData;
 class CurveImp;
 class KigDocument;
 class ObjectHolder;
+class ObjectStyle;
 
 /**
  * KigPainter is an extended QPainter.
@@ -56,6 +60,18 @@ protected:
     int overlayenlarge;
     bool mSelected;
 
+    // what we last gave mP, so that we don't give it the same again..
+    QPen mpen;
+    QBrush mbrush;
+    QFont mfont;
+    // the style that we're set up for by setObjectStyle(), or 0 if
+    // anything changed since..
+    const ObjectStyle *mobjectstyle;
+    QColor mobjectstylecolor;
+
+    void applyPen(const QPen &p);
+    void applyBrush(const QBrush &b);
+
 public:
     /**
      * construct a new KigPainter:
@@ -96,6 +112,15 @@ public:
 
     void setFont(const QFont &f);
 
+    /**
+     * set up the color, width, pen style, point style, brush and font for
+     * drawing an object of style \p s in color \p c .  This does
+     * nothing if the painter is still set up like that for the previous
+     * object, which is common since most objects of a document share a
+     * few styles.
+     */
+    void setObjectStyle(const ObjectStyle &s, const QColor &c);
+
     void setSelected(bool selected);
 
     QColor getColor() const;
@@ -129,6 +154,21 @@ public:
      */
     void drawCurve(const CurveImp *curve);
 
+    /**
+     * draw the part of a conic between the polar angles startangle and
+     * startangle + angle ( as used by ConicImp::getPoint(), in
+     * radians ).  The conic is drawn exactly, as a path of a few
+     * Bezier curves, instead of sampling it like drawCurve() does.
+     */
+    void drawConic(const ConicPolarData &data, double startangle, double angle);
+
+    /**
+     * draw a cubic, by contouring its cartesian equation over the
+     * window ( see calcCubicPolylines() ) instead of sampling its
+     * parametrization like drawCurve() does.
+     */
+    void drawCubic(const CubicCartesianData &data);
+
     /**
      * draws text in a standard manner, convenience function...
      */
@@ -256,6 +296,13 @@ protected:
     // this works recursively...
     void circleOverlayRecurse(const Coordinate &centre, double radius, const Rect &currentRect);
 
+    /**
+     * adds a number of rects to mOverlay so that they cover the arc of
+     * the circle with centre centre and radius radius, starting at
+     * startangle, with size angle ( in radians )...
+     */
+    void arcOverlay(const Coordinate &centre, double radius, double startangle, double angle);
+
     /**
      * adds some rects to mOverlay, so that they cover the segment p1p2
      * completely...
@@ -263,6 +310,25 @@ protected:
      */
     void segmentOverlay(const Coordinate &p1, const Coordinate &p2);
 
+    /**
+     * adds some rects to mOverlay, so that they cover the quadratic
+     * Bezier curve with screen control points a, b and c...
+     */
+    void quadOverlay(const QPointF &a, const QPointF &b, const QPointF &c, int depth = 0);
+
+    /**
+     * adds some rects to mOverlay, so that they cover the polyline
+     * through pts...
+     */
+    void polylineOverlay(const std::vector<Coordinate> &pts);
+
+    /**
+     * appends the rational quadratic Bezier curve from a to c with
+     * control point b of weight w to path, approximated by 2^level
+     * quadratic ones.
+     */
+    void rationalQuadTo(QPainterPath &path, const QPointF &a, const QPointF &b, const QPointF &c, double w, int level);
+
     /**
      * ...
      */
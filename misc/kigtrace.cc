@@ -0,0 +1,98 @@
+// SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include "kigtrace.h"
+
+#include <QCoreApplication>
+#include <QDebug>
+#include <QFile>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QThread>
+
+KigTrace *KigTrace::instance()
+{
+    static KigTrace t;
+    return &t;
+}
+
+KigTrace::KigTrace()
+    : mfile(nullptr)
+{
+    const QString filename = qEnvironmentVariable("KIG_TRACE");
+    if (filename.isEmpty())
+        return;
+    mfile = new QFile(filename);
+    if (!mfile->open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qWarning() << "Could not open the trace file" << filename;
+        delete mfile;
+        mfile = nullptr;
+        return;
+    }
+    // the closing bracket is optional in the array format, so the file
+    // is valid even if we never get to write it..
+    mfile->write("[");
+    QJsonObject args;
+    args[QStringLiteral("name")] = QStringLiteral("kig");
+    QJsonObject o;
+    o[QStringLiteral("ph")] = QStringLiteral("M");
+    o[QStringLiteral("name")] = QStringLiteral("process_name");
+    o[QStringLiteral("pid")] = QCoreApplication::applicationPid();
+    o[QStringLiteral("args")] = args;
+    mfile->write(QJsonDocument(o).toJson(QJsonDocument::Compact));
+    mfile->flush();
+    mtimer.start();
+}
+
+KigTrace::~KigTrace()
+{
+    if (mfile) {
+        mfile->write("\n]\n");
+        delete mfile;
+    }
+}
+
+qint64 KigTrace::now() const
+{
+    // the timestamps are in microseconds
+    return mtimer.nsecsElapsed() / 1000;
+}
+
+void KigTrace::write(const char *category, const char *name, const QString &detail, qint64 start, qint64 duration)
+{
+    QJsonObject o;
+    o[QStringLiteral("ph")] = QStringLiteral("X");
+    o[QStringLiteral("cat")] = QLatin1String(category);
+    o[QStringLiteral("name")] = QLatin1String(name);
+    o[QStringLiteral("ts")] = start;
+    o[QStringLiteral("dur")] = duration;
+    o[QStringLiteral("pid")] = QCoreApplication::applicationPid();
+    o[QStringLiteral("tid")] = static_cast<qint64>(reinterpret_cast<quintptr>(QThread::currentThreadId()));
+    if (!detail.isEmpty()) {
+        QJsonObject args;
+        args[QStringLiteral("detail")] = detail;
+        o[QStringLiteral("args")] = args;
+    }
+    const QByteArray event = QJsonDocument(o).toJson(QJsonDocument::Compact);
+
+    std::lock_guard<std::mutex> lock(mmutex);
+    mfile->write(",\n");
+    mfile->write(event);
+    mfile->flush();
+}
+
+KigTrace::Span::Span(const char *category, const char *name, const QString &detail)
+    : mtrace(KigTrace::instance()->enabled() ? KigTrace::instance() : nullptr)
+    , mcategory(category)
+    , mname(name)
+    , mdetail(detail)
+    , mstart(mtrace ? mtrace->now() : 0)
+{
+}
+
+KigTrace::Span::~Span()
+{
+    if (mtrace)
+        mtrace->write(mcategory, mname, mdetail, mstart, mtrace->now() - mstart);
+}
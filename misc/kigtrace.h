@@ -0,0 +1,60 @@
+// SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#pragma once
+
+#include <QElapsedTimer>
+#include <QString>
+
+#include <mutex>
+
+class QFile;
+
+/**
+ * KigTrace writes spans of the phases of Kig's work, like loading,
+ * recalculating, drawing and saving, to a file in the Chrome trace event
+ * format, which chrome://tracing and Perfetto show as a timeline.
+ * Tracing is on when the environment variable KIG_TRACE holds the name
+ * of that file, the --trace command line option sets it.  The events
+ * are written as soon as they end, so that the trace of a crashed
+ * session is usable too.
+ */
+class KigTrace
+{
+public:
+    static KigTrace *instance();
+
+    bool enabled() const
+    {
+        return mfile != nullptr;
+    }
+
+    /**
+     * Traces its scope as a span called name, of category category, with
+     * detail as its argument if it isn't empty.
+     */
+    class Span
+    {
+        KigTrace *mtrace;
+        const char *mcategory;
+        const char *mname;
+        QString mdetail;
+        qint64 mstart;
+
+    public:
+        Span(const char *category, const char *name, const QString &detail = QString());
+        ~Span();
+    };
+
+private:
+    KigTrace();
+    ~KigTrace();
+
+    qint64 now() const;
+    void write(const char *category, const char *name, const QString &detail, qint64 start, qint64 duration);
+
+    QFile *mfile;
+    QElapsedTimer mtimer;
+    std::mutex mmutex;
+};
@@ -10,15 +10,188 @@
 #include "object_constructor.h"
 #include "object_hierarchy.h"
 
+#include "../objects/object_imp.h"
+#include "../objects/object_type.h"
+#include "../objects/object_type_factory.h"
+
 #include <KMessageBox>
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
 #include <QFile>
+#include <QFileInfo>
 #include <QRegularExpression>
+#include <QSaveFile>
+#include <QStandardPaths>
 #include <QTextStream>
 #include <algorithm>
 #include <iterator>
+#include <map>
 #include <qdom.h>
 using namespace std;
 
+/**
+ * what the macro cache remembers of a macro: everything its ctor and
+ * action need, except for the hierarchy, which is kept as the text of
+ * its \<Construction\> element, along with the names of the object
+ * types it uses.
+ */
+struct MacroData {
+    QString name;
+    QString description;
+    QByteArray actionname;
+    QByteArray iconfile;
+    quint32 numberofresults;
+    QByteArray lastresult;
+    QString construction;
+    QList<QByteArray> types;
+};
+
+namespace
+{
+struct MacroFileData {
+    qint64 mtime;
+    qint64 size;
+    QByteArray hash;
+    std::vector<MacroData> macros;
+};
+typedef std::map<QString, MacroFileData> MacroCache;
+
+/*
+ * the cache file starts with a magic number, its format version and
+ * the Kig version that wrote it.  If any of these doesn't match, the
+ * cache is ignored.
+ */
+const quint32 macroCacheMagic = 0x4b49474d; // "KIGM"
+const quint32 macroCacheVersion = 2;
+
+bool macroCacheDirty = false;
+}
+
+static QString macroCacheFile()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + QLatin1String("/macros.cache");
+}
+
+static QDataStream &operator<<(QDataStream &stream, const MacroData &d)
+{
+    return stream << d.name << d.description << d.actionname << d.iconfile << d.numberofresults << d.lastresult << d.construction << d.types;
+}
+
+static QDataStream &operator>>(QDataStream &stream, MacroData &d)
+{
+    return stream >> d.name >> d.description >> d.actionname >> d.iconfile >> d.numberofresults >> d.lastresult >> d.construction >> d.types;
+}
+
+static MacroCache &macroCache()
+{
+    static MacroCache cache;
+    static bool loaded = false;
+    if (loaded)
+        return cache;
+    loaded = true;
+
+    QFile file(macroCacheFile());
+    if (!file.open(QIODevice::ReadOnly))
+        return cache;
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_6_0);
+    quint32 magic, version, nfiles;
+    QString kigversion;
+    stream >> magic >> version >> kigversion;
+    if (magic != macroCacheMagic || version != macroCacheVersion || kigversion != QLatin1String(KIG_VERSION_STRING))
+        return cache;
+    stream >> nfiles;
+    for (quint32 i = 0; i < nfiles && stream.status() == QDataStream::Ok; ++i) {
+        QString path;
+        MacroFileData data;
+        quint32 nmacros;
+        stream >> path >> data.mtime >> data.size >> data.hash >> nmacros;
+        for (quint32 j = 0; j < nmacros && stream.status() == QDataStream::Ok; ++j) {
+            MacroData macro;
+            stream >> macro;
+            data.macros.push_back(macro);
+        }
+        cache[path] = data;
+    }
+    if (stream.status() != QDataStream::Ok)
+        cache.clear();
+    return cache;
+}
+
+static QByteArray macroFileHash(const QString &f)
+{
+    QFile file(f);
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    if (file.open(QIODevice::ReadOnly))
+        hash.addData(&file);
+    return hash.result();
+}
+
+static QList<QByteArray> usedTypeNames(const ObjectHierarchy &hier)
+{
+    QList<QByteArray> ret;
+    const std::vector<const ObjectType *> types = hier.usedTypes();
+    for (std::vector<const ObjectType *>::const_iterator i = types.begin(); i != types.end(); ++i)
+        if (!ret.contains((*i)->fullName()))
+            ret.append((*i)->fullName());
+    return ret;
+}
+
+/**
+ * remember the macro's in \p macros as the contents of the macro file
+ * \p f in the cache
+ */
+static void rememberMacroFile(const QString &f, const std::vector<MacroData> &macros)
+{
+    const QFileInfo info(f);
+    MacroFileData &data = macroCache()[info.absoluteFilePath()];
+    data.mtime = info.lastModified().toMSecsSinceEpoch();
+    data.size = info.size();
+    data.hash = macroFileHash(f);
+    data.macros = macros;
+    macroCacheDirty = true;
+}
+
+/**
+ * return what the cache remembers of the macro file \p f, or 0 if it
+ * doesn't know the file, or the file has changed since.  If one of the
+ * macro's uses types that this Kig doesn't know ( e.g. Python scripts,
+ * when the cache was written by a Kig with Python scripting ), the
+ * hierarchy couldn't be built from the cache, and the file is forgotten.
+ */
+static const MacroFileData *cachedMacroFile(const QString &f)
+{
+    const QFileInfo info(f);
+    MacroCache &cache = macroCache();
+    MacroCache::iterator i = cache.find(info.absoluteFilePath());
+    if (i == cache.end())
+        return nullptr;
+    MacroFileData &data = i->second;
+    for (std::vector<MacroData>::const_iterator j = data.macros.begin(); j != data.macros.end(); ++j) {
+        bool known = ObjectImpType::typeFromInternalName(j->lastresult.constData());
+        for (QList<QByteArray>::const_iterator t = j->types.begin(); known && t != j->types.end(); ++t)
+            known = ObjectTypeFactory::instance()->find(t->constData());
+        if (!known) {
+            cache.erase(i);
+            macroCacheDirty = true;
+            return nullptr;
+        }
+    }
+    const qint64 mtime = info.lastModified().toMSecsSinceEpoch();
+    if (mtime == data.mtime && info.size() == data.size)
+        return &data;
+    // the file has been written again, but its contents may not have
+    // changed
+    if (info.size() != data.size || macroFileHash(f) != data.hash)
+        return nullptr;
+    data.mtime = mtime;
+    macroCacheDirty = true;
+    return &data;
+}
+
 template<typename T>
 void vect_remove(std::vector<T> &v, const T &t)
 {
@@ -229,6 +402,7 @@ bool MacroList::save(const std::vector<Macro *> &ms, const QString &f)
     docelem.setAttribute(QStringLiteral("Version"), KIG_VERSION_STRING);
     docelem.setAttribute(QStringLiteral("Number"), static_cast<uint>(ms.size()));
 
+    std::vector<MacroData> data;
     for (uint i = 0; i < ms.size(); ++i) {
         MacroConstructor *ctor = ms[i]->ctor;
 
@@ -254,23 +428,112 @@ bool MacroList::save(const std::vector<Macro *> &ms, const QString &f)
 
         // data
         QDomElement hierelem = doc.createElement(QStringLiteral("Construction"));
-        ctor->hierarchy().serialize(hierelem, doc);
+        ctor->serializeHierarchy(hierelem, doc);
         macroelem.appendChild(hierelem);
 
         docelem.appendChild(macroelem);
+
+        MacroData d;
+        d.name = ctor->descriptiveName();
+        d.description = ctor->description();
+        d.iconfile = icon.isNull() ? QByteArray("system-run") : icon.toUtf8();
+        d.numberofresults = ctor->numberOfResults();
+        d.lastresult = ctor->idOfLastResult()->internalName();
+        QTextStream construction(&d.construction);
+        hierelem.save(construction, 0);
+        d.types = usedTypeNames(ctor->hierarchy());
+        data.push_back(d);
     };
 
     doc.appendChild(docelem);
 
-    QFile file(f);
-    if (!file.open(QIODevice::WriteOnly))
-        return false;
-    QTextStream stream(&file);
-    stream << doc.toByteArray();
+    {
+        QFile file(f);
+        if (!file.open(QIODevice::WriteOnly))
+            return false;
+        QTextStream stream(&file);
+        stream << doc.toByteArray();
+    }
+
+    // if the file is loaded at startup, keep the cache up to date, so
+    // that the macro's don't have to be parsed again
+    if (macroCache().count(QFileInfo(f).absoluteFilePath())) {
+        rememberMacroFile(f, data);
+        saveCache();
+    }
     return true;
 }
 
 bool MacroList::load(const QString &f, std::vector<Macro *> &ret, const KigPart &kdoc)
+{
+    return load(f, ret, kdoc, nullptr);
+}
+
+bool MacroList::loadCached(const QString &f, std::vector<Macro *> &ret, const KigPart &kdoc)
+{
+    const MacroFileData *cached = cachedMacroFile(f);
+    if (!cached) {
+        std::vector<MacroData> data;
+        if (!load(f, ret, kdoc, &data))
+            return false;
+        if (!data.empty())
+            rememberMacroFile(f, data);
+        return true;
+    }
+
+    int unnamedindex = 1;
+    for (std::vector<MacroData>::const_iterator i = cached->macros.begin(); i != cached->macros.end(); ++i) {
+        // the same as in loadNew()
+        bool name_i18ned = false;
+        QString name = i->name;
+        if (name.isEmpty()) {
+            name = i18n("Unnamed Macro #%1", unnamedindex++);
+            name_i18ned = true;
+        }
+        MacroConstructor *ctor = new MacroConstructor(i->construction,
+                                                      i->numberofresults,
+                                                      ObjectImpType::typeFromInternalName(i->lastresult.constData()),
+                                                      name_i18ned ? name : i18n(name.toUtf8()),
+                                                      i->description.isEmpty() ? QString() : i18n(i->description.toUtf8()),
+                                                      i->iconfile);
+        GUIAction *act = new ConstructibleAction(ctor, i->actionname);
+        ret.push_back(new Macro(act, ctor));
+    }
+    return true;
+}
+
+void MacroList::saveCache()
+{
+    if (!macroCacheDirty)
+        return;
+    MacroCache &cache = macroCache();
+    // forget about the files that are gone
+    for (MacroCache::iterator i = cache.begin(); i != cache.end();) {
+        if (QFile::exists(i->first))
+            ++i;
+        else
+            i = cache.erase(i);
+    }
+
+    const QString f = macroCacheFile();
+    QDir().mkpath(QFileInfo(f).absolutePath());
+    QSaveFile file(f);
+    if (!file.open(QIODevice::WriteOnly))
+        return;
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_6_0);
+    stream << macroCacheMagic << macroCacheVersion << QStringLiteral(KIG_VERSION_STRING) << static_cast<quint32>(cache.size());
+    for (MacroCache::const_iterator i = cache.begin(); i != cache.end(); ++i) {
+        const MacroFileData &data = i->second;
+        stream << i->first << data.mtime << data.size << data.hash << static_cast<quint32>(data.macros.size());
+        for (std::vector<MacroData>::const_iterator j = data.macros.begin(); j != data.macros.end(); ++j)
+            stream << *j;
+    }
+    if (file.commit())
+        macroCacheDirty = false;
+}
+
+bool MacroList::load(const QString &f, std::vector<Macro *> &ret, const KigPart &kdoc, std::vector<MacroData> *data)
 {
     QFile file(f);
     if (!file.open(QIODevice::ReadOnly)) {
@@ -286,7 +549,7 @@ bool MacroList::load(const QString &f, std::vector<Macro *> &ret, const KigPart
     QDomElement main = doc.documentElement();
 
     if (main.tagName() == QLatin1String("KigMacroFile"))
-        return loadNew(main, ret, kdoc);
+        return loadNew(main, ret, kdoc, data);
     else {
         KMessageBox::detailedError(nullptr,
                                    i18n("Kig cannot open the macro file \"%1\".", f),
@@ -299,7 +562,7 @@ bool MacroList::load(const QString &f, std::vector<Macro *> &ret, const KigPart
     }
 }
 
-bool MacroList::loadNew(const QDomElement &docelem, std::vector<Macro *> &ret, const KigPart &)
+bool MacroList::loadNew(const QDomElement &docelem, std::vector<Macro *> &ret, const KigPart &, std::vector<MacroData> *data)
 {
     bool sok = true;
     // unused..
@@ -322,6 +585,7 @@ bool MacroList::loadNew(const QDomElement &docelem, std::vector<Macro *> &ret, c
     for (QDomElement macroelem = docelem.firstChild().toElement(); !macroelem.isNull(); macroelem = macroelem.nextSibling().toElement()) {
         QString name, description;
         ObjectHierarchy *hierarchy = nullptr;
+        QDomElement construction;
         QByteArray actionname;
         QByteArray iconfile("system-run");
         if (macroelem.tagName() != QLatin1String("Macro"))
@@ -331,8 +595,10 @@ bool MacroList::loadNew(const QDomElement &docelem, std::vector<Macro *> &ret, c
                 name = dataelem.text();
             else if (dataelem.tagName() == QLatin1String("Description"))
                 description = dataelem.text();
-            else if (dataelem.tagName() == QLatin1String("Construction"))
+            else if (dataelem.tagName() == QLatin1String("Construction")) {
                 hierarchy = ObjectHierarchy::buildSafeObjectHierarchy(dataelem, tmp);
+                construction = dataelem;
+            }
             else if (dataelem.tagName() == QLatin1String("ActionName"))
                 actionname = dataelem.text().toLatin1();
             else if (dataelem.tagName() == QLatin1String("IconFileName"))
@@ -340,7 +606,29 @@ bool MacroList::loadNew(const QDomElement &docelem, std::vector<Macro *> &ret, c
             else
                 continue;
         };
-        assert(hierarchy);
+        if (!hierarchy) {
+            qWarning() << "Skipping the macro" << name << ":" << tmp;
+            // the file isn't cached then, another Kig may be able to
+            // load the macro
+            if (data) {
+                data->clear();
+                data = nullptr;
+            }
+            continue;
+        }
+        if (data) {
+            MacroData d;
+            d.name = name;
+            d.description = description;
+            d.actionname = actionname;
+            d.iconfile = iconfile;
+            d.numberofresults = hierarchy->numberOfResults();
+            d.lastresult = hierarchy->idOfLastResult()->internalName();
+            QTextStream stream(&d.construction);
+            construction.save(stream, 0);
+            d.types = usedTypeNames(*hierarchy);
+            data->push_back(d);
+        }
         // if the macro has no name, we give it a bogus name...
         bool name_i18ned = false;
         if (name.isEmpty()) {
@@ -16,6 +16,7 @@ class KigWidget;
 class QString;
 class QDomElement;
 class ObjectCalcer;
+struct MacroData;
 
 /**
  * List of GUIActions for the parts to show.  Note that the list owns
@@ -151,11 +152,27 @@ public:
      */
     bool load(const QString &f, vectype &ret, const KigPart &);
 
+    /**
+     * load macro's from file \p f like load() does, using the macro
+     * cache.  If the cache knows the file, the macro's are created
+     * from what the cache remembers of them, without parsing the file,
+     * and their hierarchies are only built when they are first used.
+     * Otherwise, the file is loaded, and remembered in the cache.
+     */
+    bool loadCached(const QString &f, vectype &ret, const KigPart &);
+
+    /**
+     * write the macro cache to disk, if it has changed since it was
+     * read.
+     */
+    void saveCache();
+
     /**
      * get access to the list of macro's.
      */
     const vectype &macros() const;
 
 private:
-    bool loadNew(const QDomElement &docelem, std::vector<Macro *> &ret, const KigPart &);
+    bool load(const QString &f, vectype &ret, const KigPart &, std::vector<MacroData> *data);
+    bool loadNew(const QDomElement &docelem, std::vector<Macro *> &ret, const KigPart &, std::vector<MacroData> *data);
 };
@@ -7,6 +7,7 @@
 #include "argsparser.h"
 #include "guiaction.h"
 #include "kigpainter.h"
+#include "kigtrace.h"
 
 #include "../kig/kig_part.h"
 #include "../kig/kig_view.h"
@@ -23,6 +24,7 @@
 
 #include "../modes/construct_mode.h"
 
+#include <QDomDocument>
 #include <QPen>
 
 #include <algorithm>
@@ -315,12 +317,31 @@ KLazyLocalizedString MergeObjectConstructor::selectStatement(const std::vector<O
 
 MacroConstructor::MacroConstructor(const ObjectHierarchy &hier, const QString &name, const QString &desc, const QByteArray &iconfile)
     : ObjectConstructor()
-    , mhier(hier)
+    , mhier(new ObjectHierarchy(hier))
+    , mparser(mhier->argParser())
+    , mnumberofresults(mhier->numberOfResults())
+    , mlastresult(mhier->idOfLastResult())
+    , mname(name)
+    , mdesc(desc)
+    , mbuiltin(false)
+    , miconfile(iconfile)
+{
+}
+
+MacroConstructor::MacroConstructor(const QString &construction,
+                                   uint numberofresults,
+                                   const ObjectImpType *lastresult,
+                                   const QString &name,
+                                   const QString &desc,
+                                   const QByteArray &iconfile)
+    : ObjectConstructor()
+    , mconstruction(construction)
+    , mnumberofresults(numberofresults)
+    , mlastresult(lastresult)
     , mname(name)
     , mdesc(desc)
     , mbuiltin(false)
     , miconfile(iconfile)
-    , mparser(mhier.argParser())
 {
 }
 
@@ -330,12 +351,14 @@ MacroConstructor::MacroConstructor(const std::vector<ObjectCalcer *> &input,
                                    const QString &description,
                                    const QByteArray &iconfile)
     : ObjectConstructor()
-    , mhier(input, output)
+    , mhier(new ObjectHierarchy(input, output))
+    , mparser(mhier->argParser())
+    , mnumberofresults(mhier->numberOfResults())
+    , mlastresult(mhier->idOfLastResult())
     , mname(name)
     , mdesc(description)
     , mbuiltin(false)
     , miconfile(iconfile)
-    , mparser(mhier.argParser())
 {
 }
 
@@ -365,13 +388,13 @@ bool MacroConstructor::isAlreadySelectedOK(const std::vector<ObjectCalcer *> &,
 
 int MacroConstructor::wantArgs(const std::vector<ObjectCalcer *> &os, const KigDocument &, const KigWidget &) const
 {
-    return mparser.check(os);
+    return parser().check(os);
 }
 
 void MacroConstructor::handleArgs(const std::vector<ObjectCalcer *> &os, KigPart &d, KigWidget &) const
 {
-    std::vector<ObjectCalcer *> args = mparser.parse(os);
-    std::vector<ObjectCalcer *> bos = mhier.buildObjects(args, d.document());
+    std::vector<ObjectCalcer *> args = parser().parse(os);
+    std::vector<ObjectCalcer *> bos = hierarchy().buildObjects(args, d.document());
     std::vector<ObjectHolder *> hos;
     for (std::vector<ObjectCalcer *>::iterator i = bos.begin(); i != bos.end(); ++i) {
         hos.push_back(new ObjectHolder(*i));
@@ -386,7 +409,7 @@ KLazyLocalizedString MacroConstructor::selectStatement(const std::vector<ObjectC
     using namespace std;
     Args args;
     transform(sel.begin(), sel.end(), back_inserter(args), std::mem_fn(&ObjectCalcer::imp));
-    KLazyLocalizedString ret = mparser.selectStatement(args);
+    KLazyLocalizedString ret = parser().selectStatement(args);
     if (ret.isEmpty())
         return KLazyLocalizedString();
     else
@@ -398,7 +421,7 @@ KLazyLocalizedString MacroConstructor::useText(const ObjectCalcer &o, const std:
     using namespace std;
     Args args;
     transform(sel.begin(), sel.end(), back_inserter(args), std::mem_fn(&ObjectCalcer::imp));
-    KLazyLocalizedString ret = mparser.usetext(o.imp(), args);
+    KLazyLocalizedString ret = parser().usetext(o.imp(), args);
     if (ret.isEmpty())
         return KLazyLocalizedString();
     else
@@ -407,14 +430,14 @@ KLazyLocalizedString MacroConstructor::useText(const ObjectCalcer &o, const std:
 
 void MacroConstructor::handlePrelim(KigPainter &p, const std::vector<ObjectCalcer *> &sel, const KigDocument &doc, const KigWidget &) const
 {
-    if (sel.size() != mhier.numberOfArgs())
+    if (sel.size() != hierarchy().numberOfArgs())
         return;
 
     using namespace std;
     Args args;
     transform(sel.begin(), sel.end(), back_inserter(args), std::mem_fn(&ObjectCalcer::imp));
     args = mparser.parse(args);
-    std::vector<ObjectImp *> ret = mhier.calc(args, doc);
+    std::vector<ObjectImp *> ret = mhier->calc(args, doc);
     for (uint i = 0; i < ret.size(); ++i) {
         ObjectDrawer d;
         d.draw(*ret[i], p, true);
@@ -439,19 +462,19 @@ void MacroConstructor::plug(KigPart *doc, KigGUIAction *kact)
 {
     if (mbuiltin)
         return;
-    if (mhier.numberOfResults() != 1)
+    if (mnumberofresults != 1)
         doc->aMNewOther.append(kact);
     else {
-        if (mhier.idOfLastResult() == SegmentImp::stype())
+        if (mlastresult == SegmentImp::stype())
             doc->aMNewSegment.append(kact);
-        else if (mhier.idOfLastResult() == PointImp::stype())
+        else if (mlastresult == PointImp::stype())
             doc->aMNewPoint.append(kact);
-        else if (mhier.idOfLastResult() == CircleImp::stype())
+        else if (mlastresult == CircleImp::stype())
             doc->aMNewCircle.append(kact);
-        else if (mhier.idOfLastResult()->inherits(AbstractLineImp::stype()))
+        else if (mlastresult->inherits(AbstractLineImp::stype()))
             // line or ray
             doc->aMNewLine.append(kact);
-        else if (mhier.idOfLastResult() == ConicImp::stype())
+        else if (mlastresult == ConicImp::stype())
             doc->aMNewConic.append(kact);
         else
             doc->aMNewOther.append(kact);
@@ -461,7 +484,47 @@ void MacroConstructor::plug(KigPart *doc, KigGUIAction *kact)
 
 const ObjectHierarchy &MacroConstructor::hierarchy() const
 {
-    return mhier;
+    if (!mhier) {
+        KigTrace::Span span("macros", "MacroConstructor::hierarchy", mname);
+        QDomDocument doc;
+        doc.setContent(mconstruction);
+        QString error;
+        mhier.reset(ObjectHierarchy::buildSafeObjectHierarchy(doc.documentElement(), error));
+        // MacroList only creates the ctor from a construction that the
+        // hierarchy can be built from
+        if (!mhier)
+            qFatal("Could not build the macro %s: %s", qPrintable(mname), qPrintable(error));
+        mparser = mhier->argParser();
+    }
+    return *mhier;
+}
+
+const ArgsParser &MacroConstructor::parser() const
+{
+    hierarchy();
+    return mparser;
+}
+
+uint MacroConstructor::numberOfResults() const
+{
+    return mnumberofresults;
+}
+
+const ObjectImpType *MacroConstructor::idOfLastResult() const
+{
+    return mlastresult;
+}
+
+void MacroConstructor::serializeHierarchy(QDomElement &parent, QDomDocument &doc) const
+{
+    if (mhier) {
+        mhier->serialize(parent, doc);
+        return;
+    }
+    QDomDocument construction;
+    construction.setContent(mconstruction);
+    for (QDomNode n = construction.documentElement().firstChild(); !n.isNull(); n = n.nextSibling())
+        parent.appendChild(doc.importNode(n, true));
 }
 
 bool SimpleObjectTypeConstructor::isTransform() const
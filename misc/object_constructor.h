@@ -8,6 +8,8 @@
 #include "object_hierarchy.h"
 #include <KLazyLocalizedString>
 
+#include <memory>
+
 class KigPainter;
 class KigDocument;
 class KigGUIAction;
@@ -18,6 +20,9 @@ class BaseConstructMode;
 
 class QString;
 class QByteArray;
+class QDomDocument;
+class QDomElement;
+class ObjectImpType;
 
 /**
  * This class represents a way to construct a set of objects from a
@@ -278,12 +283,20 @@ public:
  */
 class MacroConstructor : public ObjectConstructor
 {
-    ObjectHierarchy mhier;
+    // the hierarchy and the args parser are only built when they are
+    // first needed, if the ctor was created from the macro's
+    // construction data.
+    mutable std::unique_ptr<ObjectHierarchy> mhier;
+    mutable ArgsParser mparser;
+    QString mconstruction;
+    uint mnumberofresults;
+    const ObjectImpType *mlastresult;
     QString mname;
     QString mdesc;
     bool mbuiltin;
     QByteArray miconfile;
-    ArgsParser mparser;
+
+    const ArgsParser &parser() const;
 
 public:
     MacroConstructor(const std::vector<ObjectCalcer *> &input,
@@ -292,9 +305,34 @@ public:
                      const QString &description,
                      const QByteArray &iconfile = nullptr);
     MacroConstructor(const ObjectHierarchy &hier, const QString &name, const QString &desc, const QByteArray &iconfile = nullptr);
+    /**
+     * construct a MacroConstructor whose hierarchy is built from the
+     * \<Construction\> element \p construction of a macro file when it is
+     * first needed.  \p numberofresults and \p lastresult are the
+     * numberOfResults() and idOfLastResult() of that hierarchy, which
+     * are needed to plug the ctor.
+     */
+    MacroConstructor(const QString &construction,
+                     uint numberofresults,
+                     const ObjectImpType *lastresult,
+                     const QString &name,
+                     const QString &desc,
+                     const QByteArray &iconfile = nullptr);
     ~MacroConstructor();
 
     const ObjectHierarchy &hierarchy() const;
+    /**
+     * saves the hierarchy in children xml tags of \p parent, like
+     * ObjectHierarchy::serialize() does, without building it if it
+     * hasn't been built yet.
+     */
+    void serializeHierarchy(QDomElement &parent, QDomDocument &doc) const;
+    /**
+     * the numberOfResults() and idOfLastResult() of the hierarchy,
+     * which are known without building it.
+     */
+    uint numberOfResults() const;
+    const ObjectImpType *idOfLastResult() const;
 
     const QString descriptiveName() const override;
     const QString description() const override;
@@ -5,6 +5,9 @@
 #include "object_hierarchy.h"
 
 #include <algorithm>
+#include <atomic>
+
+#include "calcprofiler.h"
 
 #include "../objects/bogus_imp.h"
 #include "../objects/object_holder.h"
@@ -18,6 +21,7 @@
 #include <qdom.h>
 #include <QChar>
 #include <QString>
+#include <QXmlStreamWriter>
 #include <KLazyLocalizedString>
 
 class ObjectHierarchy::Node
@@ -30,6 +34,9 @@ public:
     virtual Node *copy() const = 0;
 
     virtual void apply(std::vector<const ObjectImp *> &stack, int loc, const KigDocument &) const = 0;
+    // the same for a number of stacks at once, see
+    // ObjectHierarchy::calcBatch()
+    virtual void applyBatch(std::vector<std::vector<const ObjectImp *>> &stacks, int loc, const KigDocument &) const;
 
     virtual void apply(std::vector<ObjectCalcer *> &stack, int loc) const = 0;
 
@@ -52,6 +59,12 @@ ObjectHierarchy::Node::~Node()
 {
 }
 
+void ObjectHierarchy::Node::applyBatch(std::vector<std::vector<const ObjectImp *>> &stacks, int loc, const KigDocument &doc) const
+{
+    for (uint i = 0; i < stacks.size(); ++i)
+        apply(stacks[i], loc, doc);
+}
+
 class PushStackNode : public ObjectHierarchy::Node
 {
     ObjectImp *mimp;
@@ -137,6 +150,7 @@ public:
 
     int id() const override;
     void apply(std::vector<const ObjectImp *> &stack, int loc, const KigDocument &) const override;
+    void applyBatch(std::vector<std::vector<const ObjectImp *>> &stacks, int loc, const KigDocument &) const override;
     void apply(std::vector<ObjectCalcer *> &stack, int loc) const override;
 
     void checkDependsOnGiven(std::vector<bool> &dependsstack, int loc) const override;
@@ -190,9 +204,23 @@ void ApplyTypeNode::apply(std::vector<const ObjectImp *> &stack, int loc, const
     stack[loc] = mtype->calc(args, doc);
 }
 
+void ApplyTypeNode::applyBatch(std::vector<std::vector<const ObjectImp *>> &stacks, int loc, const KigDocument &doc) const
+{
+    std::vector<Args> argsets(stacks.size());
+    for (uint i = 0; i < stacks.size(); ++i) {
+        for (uint j = 0; j < mparents.size(); ++j)
+            argsets[i].push_back(stacks[i][mparents[j]]);
+        argsets[i] = mtype->sortArgs(argsets[i]);
+    }
+    std::vector<ObjectImp *> results = mtype->calcBatch(argsets, doc);
+    assert(results.size() == stacks.size());
+    for (uint i = 0; i < stacks.size(); ++i)
+        stacks[i][loc] = results[i];
+}
+
 class FetchPropertyNode : public ObjectHierarchy::Node
 {
-    mutable int mpropgid;
+    mutable std::atomic<int> mpropgid;
     int mparent;
     const QByteArray mname;
 
@@ -275,6 +303,7 @@ std::vector<ObjectImp *> ObjectHierarchy::calc(const Args &a, const KigDocument
     for (uint i = 0; i < a.size(); ++i)
         assert(a[i]->inherits(margrequirements[i]));
 
+    CalcProfiler::Scope scope(CalcProfiler::Hierarchy, "calc");
     std::vector<const ObjectImp *> stack;
     stack.resize(mnodes.size() + mnumberofargs, nullptr);
     std::copy(a.begin(), a.end(), stack.begin());
@@ -295,6 +324,32 @@ std::vector<ObjectImp *> ObjectHierarchy::calc(const Args &a, const KigDocument
     };
 }
 
+std::vector<std::vector<ObjectImp *>> ObjectHierarchy::calcBatch(const std::vector<Args> &a, const KigDocument &doc) const
+{
+    CalcProfiler::Scope scope(CalcProfiler::Hierarchy, "calcBatch");
+    std::vector<std::vector<const ObjectImp *>> stacks(a.size());
+    for (uint i = 0; i < a.size(); ++i) {
+        assert(a[i].size() == mnumberofargs);
+        stacks[i].resize(mnodes.size() + mnumberofargs, nullptr);
+        std::copy(a[i].begin(), a[i].end(), stacks[i].begin());
+    }
+    for (uint i = 0; i < mnodes.size(); ++i)
+        mnodes[i]->applyBatch(stacks, mnumberofargs + i, doc);
+
+    std::vector<std::vector<ObjectImp *>> ret(a.size());
+    for (uint j = 0; j < stacks.size(); ++j) {
+        std::vector<const ObjectImp *> &stack = stacks[j];
+        for (uint i = mnumberofargs; i < stack.size() - mnumberofresults; ++i)
+            delete stack[i];
+        if (stack.size() < mnumberofargs + mnumberofresults)
+            ret[j].push_back(new InvalidImp);
+        else
+            for (uint i = stack.size() - mnumberofresults; i < stack.size(); ++i)
+                ret[j].push_back(const_cast<ObjectImp *>(stack[i]));
+    }
+    return ret;
+}
+
 int ObjectHierarchy::visit(const ObjectCalcer *o, std::map<const ObjectCalcer *, int> &seenmap, bool needed, bool neededatend)
 {
     using namespace std;
@@ -416,60 +471,67 @@ ObjectHierarchy::ObjectHierarchy(const std::vector<ObjectCalcer *> &from, const
     init(from, to);
 }
 
-void ObjectHierarchy::serialize(QDomElement &parent, QDomDocument &doc) const
+void ObjectHierarchy::serialize(QXmlStreamWriter &xml) const
 {
     int id = 1;
     for (uint i = 0; i < mnumberofargs; ++i) {
-        QDomElement e = doc.createElement(QStringLiteral("input"));
-        e.setAttribute(QStringLiteral("id"), id++);
-        e.setAttribute(QStringLiteral("requirement"), margrequirements[i]->internalName());
+        xml.writeStartElement(QLatin1String("input"));
+        xml.writeAttribute(QLatin1String("id"), QString::number(id++));
+        xml.writeAttribute(QLatin1String("requirement"), QLatin1String(margrequirements[i]->internalName()));
         // we don't save these atm, since the user can't define them.
         // we only load them from builtin macro's.
         if (msaveinputtags) {
-            QDomElement ut = doc.createElement(QStringLiteral("UseText"));
-            ut.appendChild(doc.createTextNode(QString(musetexts[i])));
-            e.appendChild(ut);
-            QDomElement ss = doc.createElement(QStringLiteral("SelectStatement"));
-            ss.appendChild(doc.createTextNode(QString(mselectstatements[i])));
-            e.appendChild(ss);
+            xml.writeTextElement(QLatin1String("UseText"), QString(musetexts[i]));
+            xml.writeTextElement(QLatin1String("SelectStatement"), QString(mselectstatements[i]));
         }
-        parent.appendChild(e);
+        xml.writeEndElement();
     }
 
     for (uint i = 0; i < mnodes.size(); ++i) {
         bool result = mnodes.size() - (id - mnumberofargs - 1) <= mnumberofresults;
-        QDomElement e = doc.createElement(result ? "result" : "intermediate");
-        e.setAttribute(QStringLiteral("id"), id++);
+        xml.writeStartElement(QLatin1String(result ? "result" : "intermediate"));
+        xml.writeAttribute(QLatin1String("id"), QString::number(id++));
 
         if (mnodes[i]->id() == Node::ID_ApplyType) {
             const ApplyTypeNode *node = static_cast<const ApplyTypeNode *>(mnodes[i]);
-            e.setAttribute(QStringLiteral("action"), QStringLiteral("calc"));
-            e.setAttribute(QStringLiteral("type"), QString::fromLatin1(node->type()->fullName()));
+            xml.writeAttribute(QLatin1String("action"), QLatin1String("calc"));
+            xml.writeAttribute(QLatin1String("type"), QLatin1String(node->type()->fullName()));
             for (uint i = 0; i < node->parents().size(); ++i) {
                 int parent = node->parents()[i] + 1;
-                QDomElement arge = doc.createElement(QStringLiteral("arg"));
-                arge.appendChild(doc.createTextNode(QString::number(parent)));
-                e.appendChild(arge);
+                xml.writeTextElement(QLatin1String("arg"), QString::number(parent));
             };
         } else if (mnodes[i]->id() == Node::ID_FetchProp) {
             const FetchPropertyNode *node = static_cast<const FetchPropertyNode *>(mnodes[i]);
-            e.setAttribute(QStringLiteral("action"), QStringLiteral("fetch-property"));
-            e.setAttribute(QStringLiteral("property"), QString(node->propinternalname()));
-            QDomElement arge = doc.createElement(QStringLiteral("arg"));
-            arge.appendChild(doc.createTextNode(QString::number(node->parent() + 1)));
-            e.appendChild(arge);
+            xml.writeAttribute(QLatin1String("action"), QLatin1String("fetch-property"));
+            xml.writeAttribute(QLatin1String("property"), QString(node->propinternalname()));
+            xml.writeTextElement(QLatin1String("arg"), QString::number(node->parent() + 1));
         } else {
             assert(mnodes[i]->id() == ObjectHierarchy::Node::ID_PushStack);
             const PushStackNode *node = static_cast<const PushStackNode *>(mnodes[i]);
-            e.setAttribute(QStringLiteral("action"), QStringLiteral("push"));
-            QString type = ObjectImpFactory::instance()->serialize(*node->imp(), e, doc);
-            e.setAttribute(QStringLiteral("type"), type);
+            xml.writeAttribute(QLatin1String("action"), QLatin1String("push"));
+            ObjectImpFactory::instance()->serialize(*node->imp(), xml);
         };
 
-        parent.appendChild(e);
+        xml.writeEndElement();
     };
 }
 
+void ObjectHierarchy::serialize(QDomElement &parent, QDomDocument &doc) const
+{
+    // written like the native files are, and read back into the DOM
+    QByteArray data;
+    {
+        QXmlStreamWriter xml(&data);
+        xml.writeStartElement(QLatin1String("Construction"));
+        serialize(xml);
+        xml.writeEndElement();
+    }
+    QDomDocument construction;
+    construction.setContent(data, QDomDocument::ParseOption::PreserveSpacingOnlyNodes);
+    for (QDomNode n = construction.documentElement().firstChild(); !n.isNull(); n = n.nextSibling())
+        parent.appendChild(doc.importNode(n, true));
+}
+
 ObjectHierarchy::ObjectHierarchy()
     : mnumberofargs(0)
     , mnumberofresults(0)
@@ -774,3 +836,23 @@ bool ObjectHierarchy::allGivenObjectsUsed() const
             return false;
     return true;
 }
+
+bool ObjectHierarchy::isThreadSafe() const
+{
+    for (uint i = 0; i < mnodes.size(); ++i) {
+        if (mnodes[i]->id() == Node::ID_ApplyType && !static_cast<const ApplyTypeNode *>(mnodes[i])->type()->isThreadSafe())
+            return false;
+        if (mnodes[i]->id() == Node::ID_PushStack && !static_cast<const PushStackNode *>(mnodes[i])->imp()->hasThreadSafeProperties())
+            return false;
+    }
+    return true;
+}
+
+std::vector<const ObjectType *> ObjectHierarchy::usedTypes() const
+{
+    std::vector<const ObjectType *> ret;
+    for (uint i = 0; i < mnodes.size(); ++i)
+        if (mnodes[i]->id() == Node::ID_ApplyType)
+            ret.push_back(static_cast<const ApplyTypeNode *>(mnodes[i])->type());
+    return ret;
+}
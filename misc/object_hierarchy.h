@@ -62,9 +62,22 @@ public:
     ObjectHierarchy withFixedArgs(const Args &a) const;
 
     std::vector<ObjectImp *> calc(const Args &a, const KigDocument &doc) const;
+    /**
+     * does the same as calc() for every set of arguments in \p a, but
+     * calculates the nodes of the hierarchy one at a time for all of
+     * the sets, so that the types can handle them together ( see
+     * ObjectType::calcBatch() ).  This is used for the points of loci.
+     */
+    std::vector<std::vector<ObjectImp *>> calcBatch(const std::vector<Args> &a, const KigDocument &doc) const;
 
     /**
-     * saves the ObjectHierarchy data in children xml tags of \p parent .
+     * writes the ObjectHierarchy data as children of the element that
+     * was just started on \p xml .
+     */
+    void serialize(QXmlStreamWriter &xml) const;
+    /**
+     * saves the ObjectHierarchy data in children xml tags of \p parent ,
+     * as the function above writes them.
      */
     void serialize(QDomElement &parent, QDomDocument &doc) const;
     /**
@@ -99,6 +112,18 @@ public:
 
     bool resultDependsOnGiven() const;
     bool allGivenObjectsUsed() const;
+    /**
+     * whether calc() can be called from another thread than the main
+     * one, which is the case if all of the types in the hierarchy are
+     * thread safe ( see ObjectType::isThreadSafe() ).
+     */
+    bool isThreadSafe() const;
+    /**
+     * the object types that the hierarchy applies.  It can only be
+     * built again from its serialized form if all of them are known to
+     * the ObjectTypeFactory.
+     */
+    std::vector<const ObjectType *> usedTypes() const;
 
     ObjectHierarchy transformFinalObject(const Transformation &t) const;
 };
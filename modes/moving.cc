@@ -13,6 +13,7 @@
 #include "../misc/calcpaths.h"
 #include "../misc/coordinate_system.h"
 #include "../misc/kigpainter.h"
+#include "../misc/kigtrace.h"
 #include "../objects/object_factory.h"
 #include "../objects/object_imp.h"
 
@@ -30,31 +31,45 @@ void MovingModeBase::initScreen(const std::vector<ObjectCalcer *> &in)
 
     // don't try to move objects that have been deleted from the
     // document or internal objects that the user is not aware of..
-    std::vector<ObjectHolder *> docobjs = mdoc.document().objects();
-    for (std::vector<ObjectHolder *>::iterator i = docobjs.begin(); i != docobjs.end(); ++i)
+    const std::vector<ObjectHolder *> &docobjs = mdoc.document().objects();
+    for (std::vector<ObjectHolder *>::const_iterator i = docobjs.begin(); i != docobjs.end(); ++i)
         if (calcableset.find((*i)->calcer()) != calcableset.end())
             mdrawable.push_back(*i);
 
-    std::set<ObjectHolder *> docobjsset(docobjs.begin(), docobjs.end());
-    std::set<ObjectHolder *> drawableset(mdrawable.begin(), mdrawable.end());
-    std::set<ObjectHolder *> notmovingobjs;
-    std::set_difference(docobjsset.begin(), docobjsset.end(), drawableset.begin(), drawableset.end(), std::inserter(notmovingobjs, notmovingobjs.begin()));
+    // in night vision mode, the hidden objects are drawn too..
+    const bool nightvision = mdoc.document().getNightVision();
+    std::vector<ObjectCalcer *> showncalcers;
+    for (std::vector<ObjectHolder *>::iterator i = mdrawable.begin(); i != mdrawable.end(); ++i)
+        if (nightvision || (*i)->shown())
+            showncalcers.push_back((*i)->calcer());
+    const std::vector<ObjectCalcer *> needed = getAllParents(showncalcers);
+    const std::set<ObjectCalcer *> neededset(needed.begin(), needed.end());
+    for (std::vector<ObjectCalcer *>::iterator i = mcalcable.begin(); i != mcalcable.end(); ++i)
+        if (neededset.find(*i) != neededset.end())
+            mshowncalcable.push_back(*i);
+
+    // mdrawable is in the order of the document, so is this..
+    const std::set<ObjectHolder *> drawableset(mdrawable.begin(), mdrawable.end());
+    std::vector<ObjectHolder *> notmovingobjs;
+    for (std::vector<ObjectHolder *>::const_iterator i = docobjs.begin(); i != docobjs.end(); ++i)
+        if (drawableset.find(*i) == drawableset.end())
+            notmovingobjs.push_back(*i);
 
     mview.clearStillPix();
     KigPainter p(mview.screenInfo(), &mview.stillPix, mdoc.document());
     p.drawGrid(mdoc.document().coordinateSystem(), mdoc.document().grid(), mdoc.document().axes());
-    p.drawObjects(notmovingobjs.begin(), notmovingobjs.end(), false);
+    p.drawObjects(notmovingobjs, false);
     mview.updateCurPix();
 
     KigPainter p2(mview.screenInfo(), &mview.curPix, mdoc.document());
-    p2.drawObjects(drawableset.begin(), drawableset.end(), true);
+    p2.drawObjects(mdrawable, true);
 }
 
 void MovingModeBase::leftReleased(QMouseEvent *, KigWidget *v)
 {
-    // clean up after ourselves:
-    for (std::vector<ObjectCalcer *>::iterator i = mcalcable.begin(); i != mcalcable.end(); ++i)
-        (*i)->calc(mdoc.document());
+    // clean up after ourselves, this also brings the hidden objects
+    // up to date:
+    calcAll(mcalcable, mdoc.document());
     stopMove();
     mdoc.setModified(true);
 
@@ -67,13 +82,17 @@ void MovingModeBase::leftReleased(QMouseEvent *, KigWidget *v)
 
 void MovingModeBase::mouseMoved(QMouseEvent *e, KigWidget *v)
 {
+    KigTrace::Span span("interaction", "MovingModeBase::mouseMoved");
     v->updateCurPix();
     Coordinate c = v->fromScreen(e->pos());
 
     bool snaptogrid = e->modifiers() & Qt::ShiftModifier;
-    moveTo(c, snaptogrid);
-    for (std::vector<ObjectCalcer *>::iterator i = mcalcable.begin(); i != mcalcable.end(); ++i)
-        (*i)->calc(mdoc.document());
+    {
+        KigTrace::Span calcspan("calc", "move and recalculate");
+        moveTo(c, snaptogrid);
+        calcAll(mshowncalcable, mdoc.document());
+    }
+    KigTrace::Span drawspan("render", "draw moving objects");
     KigPainter p(v->screenInfo(), &v->curPix, mdoc.document());
     // TODO: only draw the explicitly moving objects as selected, the
     // other ones as deselected. Needs some support from the
@@ -33,6 +33,11 @@ private:
     // called.
     std::vector<ObjectCalcer *> mcalcable;
     std::vector<ObjectHolder *> mdrawable;
+    // the part of mcalcable that the drawn objects depend on.  Only
+    // these are calc()'ed while moving, the hidden helper objects that
+    // nothing drawn needs are calc()'ed when the move is done.  In night
+    // vision mode, the hidden objects are drawn as well..
+    std::vector<ObjectCalcer *> mshowncalcable;
 
 protected:
     MovingModeBase(KigPart &doc, KigWidget &v);
@@ -90,8 +90,9 @@ void NormalMode::redrawScreen(KigWidget *w)
 {
     // unselect removed objects..
     std::vector<ObjectHolder *> nsos;
-    const std::set<ObjectHolder *> docobjs = mdoc.document().objectsSet();
-    std::set_intersection(docobjs.begin(), docobjs.end(), sos.begin(), sos.end(), std::back_inserter(nsos));
+    for (std::set<ObjectHolder *>::const_iterator i = sos.begin(); i != sos.end(); ++i)
+        if (mdoc.document().contains(*i))
+            nsos.push_back(*i);
     sos = std::set<ObjectHolder *>(nsos.begin(), nsos.end());
     w->redrawScreen(nsos, true);
     w->updateScrollBars();
@@ -265,7 +266,7 @@ void NormalMode::deselectAll()
 
 void NormalMode::invertSelection()
 {
-    std::vector<ObjectHolder *> os = mdoc.document().objects();
+    const std::vector<ObjectHolder *> &os = mdoc.document().objects();
     std::set<ObjectHolder *> oldsel = sos;
     clearSelection();
     for (std::vector<ObjectHolder *>::const_iterator i = os.begin(); i != os.end(); ++i)
@@ -28,14 +28,13 @@
 #include <KIconLoader>
 #include <KMessageBox>
 
-#ifdef WITH_GEOGEBRA
 #include "../geogebra/geogebratransformer.h"
 
 #include <QDebug>
-#include <QXmlQuery>
 
 #include <KZip>
-#endif // WITH_GEOGEBRA
+
+#include <memory>
 
 static QString wrapAt(const QString &str, int col = 50)
 {
@@ -473,9 +472,7 @@ void TypesDialog::importTypes()
     // TODO : Do this through MIME types
     QStringList toolFilters;
     toolFilters << i18n("Kig Types Files (*.kigt)");
-#ifdef WITH_GEOGEBRA
     toolFilters << i18n("Geogebra Tool Files (*.ggt)");
-#endif // WITH_GEOGEBRA
     toolFilters << i18n("All Files (*)");
     QStringList file_names = QFileDialog::getOpenFileNames(this,
                                                            i18n("Import Types"),
@@ -485,13 +482,11 @@ void TypesDialog::importTypes()
     std::vector<Macro *> macros;
     for (QStringList::const_iterator i = file_names.constBegin(); i != file_names.constEnd(); ++i) {
         std::vector<Macro *> nmacros;
-#ifdef WITH_GEOGEBRA
         if (i->endsWith(QLatin1String(".ggt"))) // The input file is a Geogebra Tool file..
         {
             loadGeogebraTools(*i, macros, mpart);
             continue;
         }
-#endif // WITH_GEOGEBRA
         bool ok = MacroList::instance()->load(*i, nmacros, mpart);
         if (!ok)
             continue;
@@ -564,7 +559,6 @@ void TypesDialog::typeListContextMenu(const QPoint &pos)
     popup->exec(mtypeswidget->typeList->viewport()->mapToGlobal(pos));
 }
 
-#ifdef WITH_GEOGEBRA
 bool TypesDialog::loadGeogebraTools(const QString &sFrom, std::vector<Macro *> &vec, KigPart & /*kigpart*/)
 {
     KZip geogebraFile(sFrom);
@@ -574,17 +568,14 @@ bool TypesDialog::loadGeogebraTools(const QString &sFrom, std::vector<Macro *> &
 
         if (geogebraXMLEntry) {
             KigDocument *document = new KigDocument();
-            QXmlNamePool np;
-            QXmlQuery geogebraXSLT(QXmlQuery::XSLT20, np);
-            const QString encodedData = QString::fromUtf8(geogebraXMLEntry->data().constData());
-            QFile queryDevice(QStringLiteral(":/kig/geogebra/geogebra.xsl"));
-            GeogebraTransformer ggttransformer(document, np);
-
-            queryDevice.open(QFile::ReadOnly);
-            geogebraXSLT.setFocus(encodedData);
-            geogebraXSLT.setQuery(&queryDevice);
-            geogebraXSLT.evaluateTo(&ggttransformer);
-            queryDevice.close();
+            std::unique_ptr<QIODevice> device(geogebraXMLEntry->createDevice());
+            GeogebraTransformer ggttransformer(document);
+
+            if (!device || !ggttransformer.read(*device)) {
+                qWarning() << "Failed to read Geogebra tools:" << ggttransformer.errorString();
+                delete document;
+                return false;
+            }
 
             const size_t nmacros = ggttransformer.getNumberOfSections();
 
@@ -605,6 +596,4 @@ bool TypesDialog::loadGeogebraTools(const QString &sFrom, std::vector<Macro *> &
 
     return true;
 }
-#endif // WITH_GEOEBRA
-
 #include "moc_typesdialog.cpp"
@@ -29,6 +29,7 @@ class ObjectType;
 class ObjectTypeCalcer;
 class QDomDocument;
 class QDomElement;
+class QXmlStreamWriter;
 class Rect;
 class ScreenInfo;
 class Transformation;
@@ -30,7 +30,7 @@ ObjectImp *ConicImp::transform(const Transformation &t) const
 
 void ConicImp::draw(KigPainter &p) const
 {
-    p.drawCurve(this);
+    p.drawConic(polarData(), 0., 2 * M_PI);
 }
 
 bool ConicImp::valid() const
@@ -138,6 +138,13 @@ double ConicImp::getParam(const Coordinate &p, const KigDocument &) const
     return getParam(p);
 }
 
+double ConicImp::getParamNear(const Coordinate &p, double, const KigDocument &doc) const
+{
+    // getParam is exact for conics ( and conic arcs ), no need for a
+    // local search..
+    return getParam(p, doc);
+}
+
 double ConicImp::getParam(const Coordinate &p) const
 {
     const ConicPolarData d = polarData();
@@ -508,6 +515,11 @@ ObjectImp *ConicArcImp::transform(const Transformation &t) const
     return result;
 }
 
+void ConicArcImp::draw(KigPainter &p) const
+{
+    p.drawConic(polarData(), msa, ma);
+}
+
 bool ConicArcImp::contains(const Coordinate &o, int width, const KigWidget &w) const
 {
     return internalContainsPoint(o, w.screenInfo().normalMiss(width), w.document());
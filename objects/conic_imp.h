@@ -51,6 +51,7 @@ public:
     ObjectImp *property(int which, const KigDocument &w) const override;
 
     double getParam(const Coordinate &point, const KigDocument &) const override;
+    double getParamNear(const Coordinate &point, double hint, const KigDocument &) const override;
     const Coordinate getPoint(double param, const KigDocument &) const override;
 
     // getPoint and getParam do not really need the KigDocument arg...
@@ -175,6 +176,7 @@ public:
     ConicArcImp *copy() const override;
 
     ObjectImp *transform(const Transformation &t) const override;
+    void draw(KigPainter &p) const override;
     bool contains(const Coordinate &p, int width, const KigWidget &) const override;
     bool containsPoint(const Coordinate &p, const KigDocument &doc) const override;
     bool internalContainsPoint(const Coordinate &p, double threshold, const KigDocument &doc) const;
@@ -206,6 +208,20 @@ public:
     {
         ma = a;
     }
+    /**
+     * Return the start angle in radians of this arc.
+     */
+    double startAngle() const
+    {
+        return msa;
+    }
+    /**
+     * Return the dimension in radians of this arc.
+     */
+    double angle() const
+    {
+        return ma;
+    }
     /**
      * Return the start point of this arc.
      */
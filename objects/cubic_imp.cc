@@ -40,7 +40,7 @@ ObjectImp *CubicImp::transform(const Transformation &t) const
 
 void CubicImp::draw(KigPainter &p) const
 {
-    p.drawCurve(this);
+    p.drawCubic(mdata);
 }
 
 bool CubicImp::contains(const Coordinate &o, int width, const KigWidget &w) const
@@ -91,22 +91,16 @@ double CubicImp::getParam(const Coordinate &p, const KigDocument &) const
             v = -v; // the line points away from the intersection
         double a, b, c, d;
         calcCubicLineRestriction(mdata, p, v, a, b, c, d);
-        if (a < 0) {
-            a *= -1;
-            b *= -1;
-            c *= -1;
-            d *= -1;
-        }
 
-        // computing the coefficients of the Sturm sequence
-        double p1a = 2 * b * b - 6 * a * c;
-        double p1b = b * c - 9 * a * d;
-        double p0a = c * p1a * p1a + p1b * (3 * a * p1b - 2 * b * p1a);
-        // compute the number of roots for negative lambda
-        int variations = calcCubicVariations(0, a, b, c, d, p1a, p1b, p0a);
-        bool valid;
-        int numroots;
-        double lambda = calcCubicRoot(-1e10, 1e10, a, b, c, d, variations, valid, numroots);
+        // the nearest intersection for negative lambda
+        double roots[3];
+        int numroots = calcCubicRoots(a, b, c, d, roots);
+        bool valid = false;
+        double lambda = 0;
+        for (int i = 0; i < numroots && roots[i] < 0; ++i) {
+            lambda = roots[i];
+            valid = true;
+        }
         if (valid) {
             Coordinate pnew = p + lambda * v;
             x = pnew.x;
@@ -9,6 +9,7 @@
 #include "../misc/equationstring.h"
 #include "../misc/kignumerics.h"
 
+#include <algorithm>
 #include <cmath>
 #include <QRandomGenerator>
 
@@ -120,6 +121,15 @@ double CurveImp::getDist(double param, const Coordinate &p, const KigDocument &d
     return p1.valid() ? (p1 - p).length() : +double_inf;
 }
 
+std::vector<Coordinate> CurveImp::getPoints(const std::vector<double> &params, const KigDocument &doc) const
+{
+    std::vector<Coordinate> ret;
+    ret.reserve(params.size());
+    for (double param : params)
+        ret.push_back(getPoint(param, doc));
+    return ret;
+}
+
 double CurveImp::getParam(const Coordinate &p, const KigDocument &doc) const
 {
     // this function ( and related functions like getInterval etc. ) is
@@ -206,6 +216,42 @@ double CurveImp::getParam(const Coordinate &p, const KigDocument &doc) const
     return xm;
 }
 
+double CurveImp::getParamNear(const Coordinate &p, double hint, const KigDocument &doc) const
+{
+    if (!(hint >= 0. && hint <= 1.))
+        return getParam(p, doc);
+
+    // how far the cursor is from the previous position of the point..
+    const double moved = getDist(hint, p, doc);
+    if (moved == double_inf)
+        return getParam(p, doc);
+
+    // look for a local minimum of the distance in a small window around
+    // hint, widening it a few times before giving up.  The minimum
+    // found by getParamofmin is only trusted if it is strictly closer
+    // than both ends of the window ( unless that end is also an end of
+    // the curve ), otherwise the real minimum may lie outside of it.
+    for (double w = 1. / 256.; w <= 1. / 16.; w *= 4.) {
+        const double a = std::max(hint - w, 0.);
+        const double b = std::min(hint + w, 1.);
+        const double t = getParamofmin(a, b, p, doc);
+        const double ft = getDist(t, p, doc);
+        if (ft == double_inf)
+            break;
+        if ((a != 0. && ft >= getDist(a, p, doc)) || (b != 1. && ft >= getDist(b, p, doc)))
+            continue;
+        // the point followed the cursor along this part of the curve..
+        if (ft <= moved / 2)
+            return t;
+        // otherwise the cursor may have gone over to another part of the
+        // curve, far from this one, so take the local minimum only if it
+        // is as close as the global one
+        const double g = getParam(p, doc);
+        return getDist(g, p, doc) < ft ? g : t;
+    }
+    return getParam(p, doc);
+}
+
 // This function is used to obtain a pseudo-random number using bitwise operators
 // it probably should be moved elsewhere, or made completely local...
 //
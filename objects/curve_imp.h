@@ -35,11 +35,31 @@ public:
     // infinite point.  getPoint(0.5) should return the point in the
     // middle.
     virtual double getParam(const Coordinate &point, const KigDocument &) const;
+    /**
+     * Like getParam(), but first looks for the parameter of the point
+     * closest to \p point in a neighbourhood of \p hint, and only falls
+     * back to the global search in getParam() if no local minimum of
+     * the distance is found there, or if that one is not much closer
+     * to \p point than the previous position and the global minimum is
+     * closer still.  This is meant for dragging a point along the
+     * curve: \p hint is the parameter of the previous position, so the
+     * point moves continuously, and only jumps to another branch of the
+     * curve when the cursor goes there.  The default implementation is
+     * suitable for curves using the generic getParam(); curves with an
+     * exact getParam() simply forward to it.
+     */
+    virtual double getParamNear(const Coordinate &point, double hint, const KigDocument &) const;
     // this should be the inverse function of getPoint().
     // Note that it should also do something reasonable when p is not on
     // the curve.  You can return an invalid Coordinate(
     // Coordinate::invalidCoord() ) if you need to in some cases.
     virtual const Coordinate getPoint(double param, const KigDocument &) const = 0;
+    /**
+     * Return the points for all of \p params, as getPoint() does for
+     * each of them.  Curves that can calculate many points at once
+     * faster than one by one, like loci, reimplement this.
+     */
+    virtual std::vector<Coordinate> getPoints(const std::vector<double> &params, const KigDocument &) const;
 
     CurveImp *copy() const override = 0;
 
@@ -32,6 +32,12 @@ bool AbstractLineImp::inRect(const Rect &r, int width, const KigWidget &w) const
     return lineInRect(r, mdata.a, mdata.b, width, this, w);
 }
 
+double AbstractLineImp::getParamNear(const Coordinate &p, double, const KigDocument &doc) const
+{
+    // getParam is exact for lines, no need for a local search..
+    return getParam(p, doc);
+}
+
 int AbstractLineImp::numberOfProperties() const
 {
     return Parent::numberOfProperties() + 2;
@@ -33,6 +33,8 @@ public:
 
     bool inRect(const Rect &r, int width, const KigWidget &) const override;
 
+    double getParamNear(const Coordinate &p, double hint, const KigDocument &) const override;
+
     int numberOfProperties() const override;
     const QList<KLazyLocalizedString> properties() const override;
     const QByteArrayList propertiesInternalNames() const override;
@@ -68,6 +68,38 @@ const Coordinate LocusImp::getPoint(double param, const KigDocument &doc) const
     return ret;
 }
 
+std::vector<Coordinate> LocusImp::getPoints(const std::vector<double> &params, const KigDocument &doc) const
+{
+    const std::vector<Coordinate> args = mcurve->getPoints(params, doc);
+    std::vector<Coordinate> ret(params.size(), Coordinate::invalidCoord());
+
+    // the hierarchy is only calculated for the valid points of the curve
+    std::vector<uint> indices;
+    std::vector<PointImp> argimps;
+    argimps.reserve(args.size());
+    for (uint i = 0; i < args.size(); ++i) {
+        if (args[i].valid()) {
+            indices.push_back(i);
+            argimps.push_back(PointImp(args[i]));
+        }
+    }
+    std::vector<Args> argsets(argimps.size());
+    for (uint i = 0; i < argimps.size(); ++i)
+        argsets[i].push_back(&argimps[i]);
+
+    const vector<vector<ObjectImp *>> calcret = mhier.calcBatch(argsets, doc);
+    for (uint i = 0; i < calcret.size(); ++i) {
+        assert(calcret[i].size() == 1);
+        ObjectImp *imp = calcret[i].front();
+        if (imp->inherits(PointImp::stype())) {
+            doc.mcachedparam = params[indices[i]];
+            ret[indices[i]] = static_cast<PointImp *>(imp)->coordinate();
+        }
+        delete imp;
+    }
+    return ret;
+}
+
 LocusImp::LocusImp(CurveImp *curve, const ObjectHierarchy &hier)
     : mcurve(curve)
     , mhier(hier)
@@ -217,6 +249,13 @@ bool LocusImp::isPropertyDefinedOnOrThroughThisImp(int which) const
     return Parent::isPropertyDefinedOnOrThroughThisImp(which);
 }
 
+bool LocusImp::hasThreadSafeProperties() const
+{
+    // the cartesian equation is computed from points of the locus, and
+    // those from points of its curve..
+    return mhier.isThreadSafe() && mcurve->hasThreadSafeProperties();
+}
+
 Rect LocusImp::surroundingRect() const
 {
     // it's probably possible to calculate this, if it exists, but we
@@ -62,6 +62,11 @@ public:
     Rect surroundingRect() const override;
     bool inRect(const Rect &r, int width, const KigWidget &) const override;
     const Coordinate getPoint(double param, const KigDocument &) const override;
+    /**
+     * Calculates the hierarchy for all the points at once, see
+     * ObjectHierarchy::calcBatch().
+     */
+    std::vector<Coordinate> getPoints(const std::vector<double> &params, const KigDocument &) const override;
 
     // TODO ?
     int numberOfProperties() const override;
@@ -71,6 +76,7 @@ public:
     const char *iconForProperty(int which) const override;
     const ObjectImpType *impRequirementForProperty(int which) const override;
     bool isPropertyDefinedOnOrThroughThisImp(int which) const override;
+    bool hasThreadSafeProperties() const override;
 
     const CurveImp *curve() const;
     const ObjectHierarchy &hierarchy() const;
@@ -4,6 +4,7 @@
 
 #include "object_calcer.h"
 
+#include "../misc/calcprofiler.h"
 #include "../misc/coordinate.h"
 #include "bogus_imp.h"
 #include "common.h"
@@ -11,6 +12,8 @@
 #include "object_imp.h"
 #include "object_type.h"
 
+#include <QtGlobal>
+
 #include <algorithm>
 #include <iterator>
 #include <set>
@@ -21,23 +24,27 @@ void ObjectTypeCalcer::calc(const KigDocument &doc)
     Args a;
     a.reserve(mparents.size());
     std::transform(mparents.begin(), mparents.end(), std::back_inserter(a), std::mem_fn(&ObjectCalcer::imp));
+    CalcProfiler::Scope scope(CalcProfiler::Type, mtype->fullName(), this);
     ObjectImp *n = mtype->calc(a, doc);
     delete mimp;
     mimp = n;
 }
 
 ObjectTypeCalcer::ObjectTypeCalcer(const ObjectType *type, const std::vector<ObjectCalcer *> &parents, bool sort)
-    : mparents((sort) ? type->sortArgs(parents) : parents)
-    , mtype(type)
+    : mtype(type)
     , mimp(nullptr)
 {
-    std::for_each(mparents.begin(), mparents.end(), [this](ObjectCalcer* parent) {
-        parent->addChild(this);
-    });
+    const std::vector<ObjectCalcer *> sorted = sort ? type->sortArgs(parents) : parents;
+    mparents.append(sorted.data(), sorted.size());
+    mchildindices.resize(mparents.size());
+    for (uint i = 0; i < mparents.size(); ++i)
+        mchildindices[i] = mparents[i]->addChild(this, i);
 }
 
 ObjectCalcer::~ObjectCalcer()
 {
+    if (CalcProfiler::enabled())
+        CalcProfiler::instance()->forget(this);
 }
 
 ObjectConstCalcer::ObjectConstCalcer(ObjectImp *imp)
@@ -59,10 +66,10 @@ void ObjectConstCalcer::calc(const KigDocument &)
 {
 }
 
-std::vector<ObjectCalcer *> ObjectConstCalcer::parents() const
+std::span<ObjectCalcer *const> ObjectConstCalcer::parentsView() const
 {
     // we have no parents..
-    return std::vector<ObjectCalcer *>();
+    return {};
 }
 
 void ObjectCalcer::ref()
@@ -91,31 +98,58 @@ const ObjectImp *ObjectTypeCalcer::imp() const
     return mimp;
 }
 
-std::vector<ObjectCalcer *> ObjectTypeCalcer::parents() const
+std::span<ObjectCalcer *const> ObjectTypeCalcer::parentsView() const
 {
-    return mparents;
+    return std::span<ObjectCalcer *const>(mparents.data(), mparents.size());
 }
 
-void ObjectCalcer::addChild(ObjectCalcer *c)
+std::vector<ObjectCalcer *> ObjectCalcer::parents() const
+{
+    const std::span<ObjectCalcer *const> ps = parentsView();
+    return std::vector<ObjectCalcer *>(ps.begin(), ps.end());
+}
+
+uint ObjectCalcer::addChild(ObjectCalcer *c, uint slot)
 {
     mchildren.push_back(c);
+    mchildslots.push_back(slot);
     ref();
+    return mchildren.size() - 1;
 }
 
-void ObjectCalcer::delChild(ObjectCalcer *c)
+void ObjectCalcer::delChild(uint index)
 {
-    std::vector<ObjectCalcer *>::iterator i = std::find(mchildren.begin(), mchildren.end(), c);
-    assert(i != mchildren.end());
+    assert(index < mchildren.size());
 
-    mchildren.erase(i);
+    // move the last child into the hole, and tell it about its new index..
+    const uint last = mchildren.size() - 1;
+    if (index != last) {
+        mchildren[index] = mchildren[last];
+        mchildslots[index] = mchildslots[last];
+        mchildren[index]->setChildIndex(mchildslots[index], index);
+    }
+    mchildren.pop_back();
+    mchildslots.pop_back();
     deref();
 }
 
+void ObjectCalcer::setChildIndex(uint, uint)
+{
+    // only a calcer that is the child of something has to keep track of
+    // its index, so the children of some calcer are corrupt.  Going on
+    // would leave a stale index behind, and free the wrong child later..
+    qFatal("ObjectCalcer::setChildIndex() called on a calcer that has no parents");
+}
+
+void ObjectTypeCalcer::setChildIndex(uint slot, uint index)
+{
+    mchildindices[slot] = index;
+}
+
 ObjectTypeCalcer::~ObjectTypeCalcer()
 {
-    std::for_each(mparents.begin(), mparents.end(), [this](ObjectCalcer* parent) {
-        parent->delChild(this);
-    });
+    for (uint i = 0; i < mparents.size(); ++i)
+        mparents[i]->delChild(mchildindices[i]);
     delete mimp;
 }
 
@@ -129,7 +163,7 @@ ObjectPropertyCalcer::ObjectPropertyCalcer(ObjectCalcer *parent, const char *pna
     , mparent(parent)
     , mparenttype(nullptr)
 {
-    mparent->addChild(this);
+    mchildindex = mparent->addChild(this, 0);
     mpropgid = mparent->imp()->getPropGid(pname);
 }
 
@@ -138,7 +172,7 @@ ObjectPropertyCalcer::ObjectPropertyCalcer(ObjectCalcer *parent, int propid, boo
     , mparent(parent)
     , mparenttype(nullptr)
 {
-    mparent->addChild(this);
+    mchildindex = mparent->addChild(this, 0);
     if (islocal) {
         mpropgid = parent->imp()->getPropGid(parent->imp()->propertiesInternalNames()[propid]);
     } else {
@@ -148,7 +182,7 @@ ObjectPropertyCalcer::ObjectPropertyCalcer(ObjectCalcer *parent, int propid, boo
 
 ObjectPropertyCalcer::~ObjectPropertyCalcer()
 {
-    mparent->delChild(this);
+    mparent->delChild(mchildindex);
     delete mimp;
 }
 
@@ -157,11 +191,14 @@ const ObjectImp *ObjectPropertyCalcer::imp() const
     return mimp;
 }
 
-std::vector<ObjectCalcer *> ObjectPropertyCalcer::parents() const
+std::span<ObjectCalcer *const> ObjectPropertyCalcer::parentsView() const
 {
-    std::vector<ObjectCalcer *> ret;
-    ret.push_back(mparent);
-    return ret;
+    return std::span<ObjectCalcer *const>(&mparent, 1);
+}
+
+void ObjectPropertyCalcer::setChildIndex(uint, uint index)
+{
+    mchildindex = index;
 }
 
 void ObjectPropertyCalcer::calc(const KigDocument &doc)
@@ -175,6 +212,7 @@ void ObjectPropertyCalcer::calc(const KigDocument &doc)
     }
     ObjectImp *n;
     if (mpropid >= 0) {
+        CalcProfiler::Scope scope(CalcProfiler::Property, mparent->imp()->getPropName(mpropgid), this);
         n = mparent->imp()->property(mpropid, doc);
     } else
         n = new InvalidImp;
@@ -222,13 +260,16 @@ void ObjectConstCalcer::setImp(ObjectImp *newimp)
 
 void ObjectTypeCalcer::setParents(const std::vector<ObjectCalcer *> &np)
 {
-    std::for_each(np.begin(), np.end(), [this](ObjectCalcer* obj) {
-        obj->addChild(this);
-    });
-    std::for_each(mparents.begin(), mparents.end(), [this](ObjectCalcer* obj) {
-        obj->delChild(this);
-    });
-    mparents = np;
+    // keep the old parents alive while we unregister from them, some of
+    // them may only be referenced by us..
+    std::vector<ObjectCalcer::shared_ptr> old(mparents.begin(), mparents.end());
+    for (uint i = 0; i < mparents.size(); ++i)
+        mparents[i]->delChild(mchildindices[i]);
+    mparents.clear();
+    mparents.append(np.data(), np.size());
+    mchildindices.resize(mparents.size());
+    for (uint i = 0; i < mparents.size(); ++i)
+        mchildindices[i] = mparents[i]->addChild(this, i);
 }
 
 void ObjectTypeCalcer::setType(const ObjectType *t)
@@ -332,3 +373,25 @@ int ObjectPropertyCalcer::propGid() const
 {
     return mpropgid;
 }
+
+bool ObjectCalcer::isThreadSafe() const
+{
+    return true;
+}
+
+bool ObjectTypeCalcer::isThreadSafe() const
+{
+    if (!mtype->isThreadSafe())
+        return false;
+    // the type may call the parents, e.g. a ConstrainedPointType asks a
+    // locus for its points, and that may run a Python script..
+    for (uint i = 0; i < mparents.size(); ++i)
+        if (!mparents[i]->imp()->hasThreadSafeProperties())
+            return false;
+    return true;
+}
+
+bool ObjectPropertyCalcer::isThreadSafe() const
+{
+    return mparent->imp()->hasThreadSafeProperties();
+}
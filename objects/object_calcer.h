@@ -6,6 +6,10 @@
 
 #include "../misc/boost_intrusive_pointer.hpp"
 #include "common.h"
+
+#include <QVarLengthArray>
+
+#include <span>
 #include <typeinfo>
 
 class ObjectCalcer;
@@ -68,35 +72,68 @@ protected:
     // the dependency graph..
 
     std::vector<ObjectCalcer *> mchildren;
+    // mchildslots[i] is which of the parents of mchildren[i] we are,
+    // so that we can tell it where its entry moves in delChild()..
+    std::vector<uint> mchildslots;
 
     ObjectCalcer();
 
+    /**
+     * called when the index in the children of its \p slot 'th parent of
+     * this calcer changes to \p index , because an other child of that
+     * parent was removed.  The default implementation aborts the
+     * program, also in release builds, since calcers without parents
+     * are nobody's child.
+     */
+    virtual void setChildIndex(uint slot, uint index);
+
 public:
     /**
      * a calcer should call this to register itself as a child of this
-     * calcer.  This automatically takes a reference.
+     * calcer, which is its \p slot 'th parent.  This automatically takes
+     * a reference.  It returns the index of the child in children(),
+     * which the child has to keep up to date in setChildIndex(), and
+     * give back to delChild().
      */
-    void addChild(ObjectCalcer *c);
+    uint addChild(ObjectCalcer *c, uint slot);
     /**
      * a calcer should call this in its destructor, to inform its parent
-     * that it is no longer a child of this calcer.  This will release
-     * the reference taken in addChild.
+     * that it is no longer a child of this calcer.  \p index is the
+     * index of the child, as returned by addChild().  This will release
+     * the reference taken in addChild.  This takes constant time, the
+     * last child takes the place of the removed one.
      */
-    void delChild(ObjectCalcer *c);
+    void delChild(uint index);
 
     // use this pointer type to keep a reference to an ObjectCalcer...
     typedef myboost::intrusive_ptr<ObjectCalcer> shared_ptr;
 
     /**
-     * Returns the child ObjectCalcer's of this ObjectCalcer.
+     * Returns the child ObjectCalcer's of this ObjectCalcer.  This is
+     * a copy of childrenView().
      */
     std::vector<ObjectCalcer *> children() const;
+    /**
+     * Returns the child ObjectCalcer's of this ObjectCalcer, without
+     * copying them.  The span is valid until a child is added or
+     * removed.  The order of the children is unspecified.
+     */
+    std::span<ObjectCalcer *const> childrenView() const
+    {
+        return mchildren;
+    }
 
     virtual ~ObjectCalcer();
     /**
-     * Returns the parent ObjectCalcer's of this ObjectCalcer.
+     * Returns the parent ObjectCalcer's of this ObjectCalcer.  This is
+     * a copy of parentsView().
      */
-    virtual std::vector<ObjectCalcer *> parents() const = 0;
+    std::vector<ObjectCalcer *> parents() const;
+    /**
+     * Returns the parent ObjectCalcer's of this ObjectCalcer, without
+     * copying them.  The span is valid until the parents change.
+     */
+    virtual std::span<ObjectCalcer *const> parentsView() const = 0;
     /**
      * Returns the ObjectImp of this ObjectCalcer.
      */
@@ -159,6 +196,14 @@ public:
      * on the given curve.
      */
     virtual bool isDefinedOnOrThrough(const ObjectCalcer *o) const = 0;
+
+    /**
+     * Returns whether calc() can be called from another thread than
+     * the main one, while other ObjectCalcer's are calculated.  This
+     * is asked when the parents are calculated already.  The default
+     * implementation returns true.
+     */
+    virtual bool isThreadSafe() const;
 };
 
 /**
@@ -168,10 +213,16 @@ public:
  */
 class ObjectTypeCalcer : public ObjectCalcer
 {
-    std::vector<ObjectCalcer *> mparents;
+    // most objects have at most three parents, these are kept without
+    // allocating anything..
+    QVarLengthArray<ObjectCalcer *, 3> mparents;
+    // our indices in the children of mparents, see addChild()
+    QVarLengthArray<uint, 3> mchildindices;
     const ObjectType *mtype;
     ObjectImp *mimp;
 
+    void setChildIndex(uint slot, uint index) override;
+
 public:
     typedef myboost::intrusive_ptr<ObjectTypeCalcer> shared_ptr;
     /**
@@ -186,7 +237,7 @@ public:
     ~ObjectTypeCalcer();
 
     const ObjectImp *imp() const override;
-    std::vector<ObjectCalcer *> parents() const override;
+    std::span<ObjectCalcer *const> parentsView() const override;
     void calc(const KigDocument &doc) override;
 
     /**
@@ -206,6 +257,7 @@ public:
     std::vector<ObjectCalcer *> movableParents() const override;
     Coordinate moveReferencePoint() const override;
     void move(const Coordinate &to, const KigDocument &doc) override;
+    bool isThreadSafe() const override;
 };
 
 /**
@@ -234,7 +286,7 @@ public:
 
     const ObjectImp *imp() const override;
     void calc(const KigDocument &doc) override;
-    std::vector<ObjectCalcer *> parents() const override;
+    std::span<ObjectCalcer *const> parentsView() const override;
 
     /**
      * Set the ObjectImp of this ObjectConstCalcer to the given
@@ -261,6 +313,8 @@ class ObjectPropertyCalcer : public ObjectCalcer
 {
     ObjectImp *mimp;
     ObjectCalcer *mparent;
+    // our index in the children of mparent, see addChild()
+    uint mchildindex;
     int mpropgid;
     /*
      * The following two variables are used for a caching
@@ -279,6 +333,8 @@ class ObjectPropertyCalcer : public ObjectCalcer
     //  mutable const ObjectImpType* mparenttype;
     mutable const std::type_info *mparenttype;
 
+    void setChildIndex(uint slot, uint index) override;
+
 public:
     /**
      * Construct a new ObjectPropertyCalcer, that will get the property
@@ -289,13 +345,14 @@ public:
     ~ObjectPropertyCalcer();
 
     const ObjectImp *imp() const override;
-    std::vector<ObjectCalcer *> parents() const override;
+    std::span<ObjectCalcer *const> parentsView() const override;
     void calc(const KigDocument &doc) override;
 
     ObjectCalcer *parent() const;
 
     const ObjectImpType *impRequirement(ObjectCalcer *o, const std::vector<ObjectCalcer *> &os) const override;
     bool isDefinedOnOrThrough(const ObjectCalcer *o) const override;
+    bool isThreadSafe() const override;
 
     int propLid() const;
     int propGid() const;
@@ -7,22 +7,65 @@
 #include "../misc/kigpainter.h"
 #include "object_imp.h"
 
+#include <QHash>
 #include <QPen>
 #include <cassert>
+#include <deque>
 #include <qnamespace.h>
 
 
+namespace
+{
+QString styleKey(const QColor &color, int width, Qt::PenStyle style, Kig::PointStyle pointStyle, const QFont &f)
+{
+    return QStringLiteral("%1 %2 %3 %4 %5").arg(color.name(QColor::HexArgb)).arg(width).arg(int(style)).arg(int(pointStyle)).arg(f.key());
+}
+}
+
+class ObjectStyleTable
+{
+public:
+    // a deque, so that the styles never move..
+    std::deque<ObjectStyle> styles;
+    QHash<QString, const ObjectStyle *> index;
+
+    static ObjectStyleTable *instance()
+    {
+        static ObjectStyleTable t;
+        return &t;
+    }
+
+    const ObjectStyle *intern(const QColor &color, int width, Qt::PenStyle style, Kig::PointStyle pointStyle, const QFont &f)
+    {
+        const QString key = styleKey(color, width, style, pointStyle, f);
+        QHash<QString, const ObjectStyle *>::const_iterator i = index.constFind(key);
+        if (i != index.constEnd())
+            return i.value();
+        styles.push_back(ObjectStyle(color, width, style, pointStyle, f));
+        index.insert(key, &styles.back());
+        return &styles.back();
+    }
+};
+
+ObjectStyle::ObjectStyle(const QColor &color, int width, Qt::PenStyle style, Kig::PointStyle pointStyle, const QFont &f)
+    : mcolor(color)
+    , mwidth(width)
+    , mstyle(style)
+    , mpointstyle(pointStyle)
+    , mfont(f)
+{
+}
+
+const ObjectStyle *ObjectStyle::intern(const QColor &color, int width, Qt::PenStyle style, Kig::PointStyle pointStyle, const QFont &f)
+{
+    return ObjectStyleTable::instance()->intern(color, width, style, pointStyle, f);
+}
+
 void ObjectDrawer::draw(const ObjectImp &imp, KigPainter &p, bool sel) const
 {
     bool nv = p.getNightVision();
     if (mshown || nv) {
-        p.setBrushStyle(Qt::NoBrush);
-        p.setBrushColor(sel ? Qt::red : (mshown ? mcolor : Qt::gray));
-        p.setPen(QPen(sel ? Qt::red : (mshown ? mcolor : Qt::gray), 1));
-        p.setWidth(mwidth);
-        p.setStyle(mstyle);
-        p.setPointStyle(mpointstyle);
-        p.setFont(mfont);
+        p.setObjectStyle(*mobjectstyle, sel ? QColor(Qt::red) : (mshown ? mobjectstyle->color() : QColor(Qt::gray)));
         p.setSelected(sel);
         imp.draw(p);
     }
@@ -31,7 +74,7 @@ void ObjectDrawer::draw(const ObjectImp &imp, KigPainter &p, bool sel) const
 bool ObjectDrawer::contains(const ObjectImp &imp, const Coordinate &pt, const KigWidget &w, bool nv) const
 {
     bool shownornv = mshown || nv;
-    return shownornv && imp.contains(pt, mwidth, w);
+    return shownornv && imp.contains(pt, mobjectstyle->width(), w);
 }
 
 bool ObjectDrawer::shown() const
@@ -41,124 +84,81 @@ bool ObjectDrawer::shown() const
 
 QColor ObjectDrawer::color() const
 {
-    return mcolor;
+    return mobjectstyle->color();
 }
 
 ObjectDrawer *ObjectDrawer::getCopyShown(bool s) const
 {
-    ObjectDrawer *ret = new ObjectDrawer;
-    ret->mcolor = mcolor;
+    ObjectDrawer *ret = new ObjectDrawer(*this);
     ret->mshown = s;
-    ret->mwidth = mwidth;
-    ret->mstyle = mstyle;
-    ret->mpointstyle = mpointstyle;
-    ret->mfont = mfont;
     return ret;
 }
 
 ObjectDrawer *ObjectDrawer::getCopyColor(const QColor &c) const
 {
-    ObjectDrawer *ret = new ObjectDrawer;
-    ret->mcolor = c;
-    ret->mshown = mshown;
-    ret->mwidth = mwidth;
-    ret->mstyle = mstyle;
-    ret->mpointstyle = mpointstyle;
-    ret->mfont = mfont;
-    return ret;
+    return new ObjectDrawer(c, width(), mshown, style(), pointStyle(), font());
 }
 
 ObjectDrawer *ObjectDrawer::getCopyWidth(int w) const
 {
-    ObjectDrawer *ret = new ObjectDrawer;
-    ret->mcolor = mcolor;
-    ret->mshown = mshown;
-    ret->mwidth = w;
-    ret->mstyle = mstyle;
-    ret->mpointstyle = mpointstyle;
-    ret->mfont = mfont;
-    return ret;
+    return new ObjectDrawer(color(), w, mshown, style(), pointStyle(), font());
 }
 
 ObjectDrawer *ObjectDrawer::getCopyStyle(Qt::PenStyle s) const
 {
-    ObjectDrawer *ret = new ObjectDrawer;
-    ret->mcolor = mcolor;
-    ret->mshown = mshown;
-    ret->mwidth = mwidth;
-    ret->mstyle = s;
-    ret->mpointstyle = mpointstyle;
-    ret->mfont = mfont;
-    return ret;
+    return new ObjectDrawer(color(), width(), mshown, s, pointStyle(), font());
 }
 
 ObjectDrawer *ObjectDrawer::getCopyPointStyle(Kig::PointStyle p) const
 {
-    ObjectDrawer *ret = new ObjectDrawer;
-    ret->mcolor = mcolor;
-    ret->mshown = mshown;
-    ret->mwidth = mwidth;
-    ret->mstyle = mstyle;
-    ret->mpointstyle = p;
-    ret->mfont = mfont;
-    return ret;
+    return new ObjectDrawer(color(), width(), mshown, style(), p, font());
 }
 
 ObjectDrawer *ObjectDrawer::getCopyFont(const QFont &f) const
 {
-    ObjectDrawer *ret = new ObjectDrawer;
-    ret->mcolor = mcolor;
-    ret->mshown = mshown;
-    ret->mwidth = mwidth;
-    ret->mstyle = mstyle;
-    ret->mpointstyle = mpointstyle;
-    ret->mfont = f;
-    return ret;
+    return new ObjectDrawer(color(), width(), mshown, style(), pointStyle(), f);
 }
 
 int ObjectDrawer::width() const
 {
-    return mwidth;
+    return mobjectstyle->width();
 }
 
 Qt::PenStyle ObjectDrawer::style() const
 {
-    return mstyle;
+    return mobjectstyle->style();
 }
 
 Kig::PointStyle ObjectDrawer::pointStyle() const
 {
-    return mpointstyle;
+    return mobjectstyle->pointStyle();
 }
 
 QFont ObjectDrawer::font() const
 {
-    return mfont;
+    return mobjectstyle->font();
+}
+
+const ObjectStyle *ObjectDrawer::objectStyle() const
+{
+    return mobjectstyle;
 }
 
 ObjectDrawer::ObjectDrawer(const QColor &color, int width, bool shown, Qt::PenStyle style, Kig::PointStyle pointStyle, const QFont &f)
-    : mcolor(color)
+    : mobjectstyle(ObjectStyle::intern(color, width, style, pointStyle, f))
     , mshown(shown)
-    , mwidth(width)
-    , mstyle(style)
-    , mpointstyle(pointStyle)
-    , mfont(f)
 {
 }
 
 ObjectDrawer::ObjectDrawer()
-    : mcolor(Qt::blue)
+    : mobjectstyle(ObjectStyle::intern(Qt::blue, -1, Qt::SolidLine, Kig::Round, QFont()))
     , mshown(true)
-    , mwidth(-1)
-    , mstyle(Qt::SolidLine)
-    , mpointstyle(Kig::Round)
-    , mfont(QFont())
 {
 }
 
 bool ObjectDrawer::inRect(const ObjectImp &imp, const Rect &r, const KigWidget &w) const
 {
-    return mshown && imp.inRect(r, mwidth, w);
+    return mshown && imp.inRect(r, mobjectstyle->width(), w);
 }
 
 Qt::PenStyle ObjectDrawer::styleFromString(const QString &style)
@@ -179,15 +179,16 @@ Qt::PenStyle ObjectDrawer::styleFromString(const QString &style)
 
 QString ObjectDrawer::styleToString() const
 {
-    if (mstyle == Qt::SolidLine)
+    const Qt::PenStyle s = style();
+    if (s == Qt::SolidLine)
         return QStringLiteral("SolidLine");
-    else if (mstyle == Qt::DashLine)
+    else if (s == Qt::DashLine)
         return QStringLiteral("DashLine");
-    else if (mstyle == Qt::DotLine)
+    else if (s == Qt::DotLine)
         return QStringLiteral("DotLine");
-    else if (mstyle == Qt::DashDotLine)
+    else if (s == Qt::DashDotLine)
         return QStringLiteral("DashDotLine");
-    else if (mstyle == Qt::DashDotDotLine)
+    else if (s == Qt::DashDotDotLine)
         return QStringLiteral("DashDotDotLine");
     return QStringLiteral("SolidLine");
 }
@@ -16,6 +16,55 @@ class Coordinate;
 class KigWidget;
 class Rect;
 
+/**
+ * The look of an object: its color, width, pen style, point style and
+ * font.  ObjectStyle's are interned, there is only one ObjectStyle for
+ * every combination of them, and the ObjectDrawer's that use it share
+ * it.  Documents use few different styles, so this saves memory, and
+ * KigPainter can tell by comparing pointers whether it is still set up
+ * for drawing an object ( see KigPainter::setObjectStyle() ).
+ * ObjectStyle's live until the program exits.
+ */
+class ObjectStyle
+{
+    QColor mcolor;
+    int mwidth;
+    Qt::PenStyle mstyle;
+    Kig::PointStyle mpointstyle;
+    QFont mfont;
+
+    ObjectStyle(const QColor &color, int width, Qt::PenStyle style, Kig::PointStyle pointStyle, const QFont &f);
+    friend class ObjectStyleTable;
+
+public:
+    /**
+     * Return the ObjectStyle with the given properties, creating it if
+     * it doesn't exist yet.
+     */
+    static const ObjectStyle *intern(const QColor &color, int width, Qt::PenStyle style, Kig::PointStyle pointStyle, const QFont &f);
+
+    const QColor &color() const
+    {
+        return mcolor;
+    }
+    int width() const
+    {
+        return mwidth;
+    }
+    Qt::PenStyle style() const
+    {
+        return mstyle;
+    }
+    Kig::PointStyle pointStyle() const
+    {
+        return mpointstyle;
+    }
+    const QFont &font() const
+    {
+        return mfont;
+    }
+};
+
 /**
  * A class holding some information about how a certain object is
  * drawn on the window.
@@ -89,6 +138,11 @@ public:
      * return the font
      */
     QFont font() const;
+    /**
+     * return the interned style, which holds all of the above except
+     * the shown state
+     */
+    const ObjectStyle *objectStyle() const;
     /**
      * return style transformed in a string
      */
@@ -132,10 +186,6 @@ public:
     static Qt::PenStyle styleFromString(const QString &style);
 
 private:
-    QColor mcolor;
+    const ObjectStyle *mobjectstyle;
     bool mshown;
-    int mwidth;
-    Qt::PenStyle mstyle;
-    Kig::PointStyle mpointstyle;
-    QFont mfont;
 };
@@ -6,10 +6,12 @@
 
 #include "bogus_imp.h"
 
+#include "../misc/calcprofiler.h"
 #include "../misc/coordinate.h"
 
 #include <KLazyLocalizedString>
 #include <map>
+#include <mutex>
 
 class ObjectImpType::StaticPrivate
 {
@@ -19,6 +21,7 @@ public:
 
 ObjectImp::ObjectImp()
 {
+    CalcProfiler::countAllocation();
 }
 
 ObjectImp::~ObjectImp()
@@ -299,6 +302,11 @@ bool ObjectImp::isCache() const
     return false;
 }
 
+bool ObjectImp::hasThreadSafeProperties() const
+{
+    return true;
+}
+
 QString ObjectImpType::attachToThisStatement() const
 {
     return mattachtothisstatement.toString();
@@ -320,9 +328,13 @@ bool ObjectImp::isPropertyDefinedOnOrThroughThisImp(int) const
 }
 
 static QByteArrayList propertiesGlobalInternalNames;
+// properties are looked up while objects are calculated on several
+// threads ( see calcAll() ), and new names are added then..
+static std::mutex propertiesGlobalInternalNamesMutex;
 
 int ObjectImp::getPropGid(const char *pname) const
 {
+    std::lock_guard<std::mutex> lock(propertiesGlobalInternalNamesMutex);
     int wp = propertiesGlobalInternalNames.indexOf(pname);
     if (wp >= 0)
         return wp;
@@ -339,14 +351,14 @@ int ObjectImp::getPropGid(const char *pname) const
 
 int ObjectImp::getPropLid(int propgid) const
 {
-    assert(propgid >= 0 && propgid < propertiesGlobalInternalNames.size());
-    int proplid = propertiesInternalNames().indexOf(propertiesGlobalInternalNames[propgid]);
+    int proplid = propertiesInternalNames().indexOf(getPropName(propgid));
     //  printf ("getPropLid: converting %d in %d\n", propgid, proplid);
     return proplid;
 }
 
 const char *ObjectImp::getPropName(int propgid) const
 {
+    std::lock_guard<std::mutex> lock(propertiesGlobalInternalNamesMutex);
     assert(propgid >= 0 && propgid < propertiesGlobalInternalNames.size());
     return propertiesGlobalInternalNames[propgid];
 }
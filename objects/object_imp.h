@@ -396,4 +396,13 @@ public:
      * implementation returns false, which is fine.
      */
     virtual bool isCache() const;
+
+    /**
+     * \internal Return true if property(), and the other const
+     * functions like CurveImp::getPoint(), can be called from another
+     * thread than the main one.  This is true for all imps that don't
+     * run a Python script to compute them, the default implementation
+     * returns true.
+     */
+    virtual bool hasThreadSafeProperties() const;
 };
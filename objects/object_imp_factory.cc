@@ -17,8 +17,11 @@
 
 #include "../misc/coordinate.h"
 
+#include <QXmlStreamWriter>
 #include <qdom.h>
 
+#include <charconv>
+
 const ObjectImpFactory *ObjectImpFactory::instance()
 {
     static const ObjectImpFactory t;
@@ -33,142 +36,151 @@ ObjectImpFactory::~ObjectImpFactory()
 {
 }
 
-static void addXYElements(const Coordinate &c, QDomElement &parent, QDomDocument &doc)
+/*
+ * the shortest representation of d that reads back to exactly d.
+ * QString::number() only keeps six significant digits.
+ */
+static QLatin1String formatDouble(double d, char (&buf)[32])
+{
+    std::to_chars_result r = std::to_chars(buf, buf + sizeof(buf), d);
+    return QLatin1String(buf, r.ptr - buf);
+}
+
+static void writeXYElements(const Coordinate &c, QXmlStreamWriter &xml)
 {
-    QDomElement xe = doc.createElement(QStringLiteral("x"));
-    xe.appendChild(doc.createTextNode(QString::number(c.x)));
-    parent.appendChild(xe);
-    QDomElement ye = doc.createElement(QStringLiteral("y"));
-    ye.appendChild(doc.createTextNode(QString::number(c.y)));
-    parent.appendChild(ye);
+    char buf[32];
+    xml.writeTextElement(QLatin1String("x"), formatDouble(c.x, buf));
+    xml.writeTextElement(QLatin1String("y"), formatDouble(c.y, buf));
 }
 
-static void addDoubleElement(const char *name, double d, QDomElement &parent, QDomDocument &doc)
+static void writeDoubleElement(const char *name, double d, QXmlStreamWriter &xml)
 {
-    QDomElement e = doc.createElement(name);
-    e.appendChild(doc.createTextNode(QString::number(d)));
-    parent.appendChild(e);
+    char buf[32];
+    xml.writeTextElement(QLatin1String(name), formatDouble(d, buf));
 }
 
-static void addCoordinateElement(const char *name, const Coordinate &d, QDomElement &p, QDomDocument &doc)
+static void writeCoordinateElement(const char *name, const Coordinate &d, QXmlStreamWriter &xml)
 {
-    QDomElement e = doc.createElement(name);
-    addXYElements(d, e, doc);
-    p.appendChild(e);
+    xml.writeStartElement(QLatin1String(name));
+    writeXYElements(d, xml);
+    xml.writeEndElement();
 }
 
-QString ObjectImpFactory::serialize(const ObjectImp &d, QDomElement &parent, QDomDocument &doc) const
+QString ObjectImpFactory::serialize(const ObjectImp &d, QXmlStreamWriter &xml) const
 {
+    char buf[32];
     if (d.inherits(IntImp::stype())) {
-        parent.appendChild(doc.createTextNode(QString::number(static_cast<const IntImp &>(d).data())));
+        xml.writeAttribute(QLatin1String("type"), QLatin1String("int"));
+        xml.writeCharacters(QString::number(static_cast<const IntImp &>(d).data()));
         return QStringLiteral("int");
     } else if (d.inherits(DoubleImp::stype())) {
-        parent.appendChild(doc.createTextNode(QString::number(static_cast<const DoubleImp &>(d).data())));
+        xml.writeAttribute(QLatin1String("type"), QLatin1String("double"));
+        xml.writeCharacters(formatDouble(static_cast<const DoubleImp &>(d).data(), buf));
         return QStringLiteral("double");
     } else if (d.inherits(StringImp::stype())) {
-        parent.appendChild(doc.createTextNode(static_cast<const StringImp &>(d).data()));
+        xml.writeAttribute(QLatin1String("type"), QLatin1String("string"));
+        xml.writeCharacters(static_cast<const StringImp &>(d).data());
         return QStringLiteral("string");
     } else if (d.inherits(TestResultImp::stype())) {
         assert(false);
-        parent.appendChild(doc.createTextNode(static_cast<const TestResultImp &>(d).data()));
+        xml.writeAttribute(QLatin1String("type"), QLatin1String("testresult"));
+        xml.writeCharacters(static_cast<const TestResultImp &>(d).data());
         return QStringLiteral("testresult");
     } else if (d.inherits(HierarchyImp::stype())) {
-        static_cast<const HierarchyImp &>(d).data().serialize(parent, doc);
+        xml.writeAttribute(QLatin1String("type"), QLatin1String("hierarchy"));
+        static_cast<const HierarchyImp &>(d).data().serialize(xml);
         return QStringLiteral("hierarchy");
     } else if (d.inherits(TransformationImp::stype())) {
         const Transformation &trans = static_cast<const TransformationImp &>(d).data();
 
-        QDomElement matrixe = doc.createElement(QStringLiteral("matrix"));
+        xml.writeAttribute(QLatin1String("type"), QLatin1String("transformation"));
+        xml.writeStartElement(QLatin1String("matrix"));
         for (int i = 0; i < 3; ++i) {
             for (int j = 0; j < 3; ++j) {
-                QDomElement elel = doc.createElement(QStringLiteral("element"));
-                elel.setAttribute(QStringLiteral("row"), QString::number(i));
-                elel.setAttribute(QStringLiteral("column"), QString::number(j));
-                elel.appendChild(doc.createTextNode(QString::number(trans.data(i, j))));
-                matrixe.appendChild(elel);
+                xml.writeStartElement(QLatin1String("element"));
+                xml.writeAttribute(QLatin1String("row"), QString::number(i));
+                xml.writeAttribute(QLatin1String("column"), QString::number(j));
+                xml.writeCharacters(formatDouble(trans.data(i, j), buf));
+                xml.writeEndElement();
             };
         }
-        parent.appendChild(matrixe);
+        xml.writeEndElement();
 
-        QDomElement homothetye = doc.createElement(QStringLiteral("homothetic"));
-        const char *ishomothety = trans.isHomothetic() ? "true" : "false";
-        homothetye.appendChild(doc.createTextNode(ishomothety));
-        parent.appendChild(homothetye);
+        xml.writeTextElement(QLatin1String("homothetic"), QLatin1String(trans.isHomothetic() ? "true" : "false"));
 
         return QStringLiteral("transformation");
     } else if (d.inherits(AbstractLineImp::stype())) {
-        LineData l = static_cast<const AbstractLineImp &>(d).data();
-        addCoordinateElement("a", l.a, parent, doc);
-        addCoordinateElement("b", l.b, parent, doc);
+        QString type = QStringLiteral("line");
         if (d.inherits(SegmentImp::stype()))
-            return QStringLiteral("segment");
+            type = QStringLiteral("segment");
         else if (d.inherits(RayImp::stype()))
-            return QStringLiteral("ray");
-        else
-            return QStringLiteral("line");
+            type = QStringLiteral("ray");
+        xml.writeAttribute(QLatin1String("type"), type);
+        LineData l = static_cast<const AbstractLineImp &>(d).data();
+        writeCoordinateElement("a", l.a, xml);
+        writeCoordinateElement("b", l.b, xml);
+        return type;
     } else if (d.inherits(PointImp::stype())) {
-        addXYElements(static_cast<const PointImp &>(d).coordinate(), parent, doc);
+        xml.writeAttribute(QLatin1String("type"), QLatin1String("point"));
+        writeXYElements(static_cast<const PointImp &>(d).coordinate(), xml);
         return QStringLiteral("point");
     } else if (d.inherits(TextImp::stype())) {
-        QString text = static_cast<const TextImp &>(d).text();
-        parent.appendChild(doc.createTextNode(text));
+        xml.writeAttribute(QLatin1String("type"), QLatin1String("text"));
+        xml.writeCharacters(static_cast<const TextImp &>(d).text());
         return QStringLiteral("text");
     } else if (d.inherits(AngleImp::stype())) {
-        addDoubleElement("size", static_cast<const AngleImp &>(d).size(), parent, doc);
+        xml.writeAttribute(QLatin1String("type"), QLatin1String("angle"));
+        writeDoubleElement("size", static_cast<const AngleImp &>(d).size(), xml);
         return QStringLiteral("angle");
     } else if (d.inherits(ArcImp::stype())) {
         const ArcImp &a = static_cast<const ArcImp &>(d);
-        addCoordinateElement("center", a.center(), parent, doc);
-        addDoubleElement("radius", a.radius(), parent, doc);
-        addDoubleElement("startangle", a.startAngle(), parent, doc);
-        addDoubleElement("angle", a.angle(), parent, doc);
+        xml.writeAttribute(QLatin1String("type"), QLatin1String("arc"));
+        writeCoordinateElement("center", a.center(), xml);
+        writeDoubleElement("radius", a.radius(), xml);
+        writeDoubleElement("startangle", a.startAngle(), xml);
+        writeDoubleElement("angle", a.angle(), xml);
         return QStringLiteral("arc");
     } else if (d.inherits(VectorImp::stype())) {
-        Coordinate dir = static_cast<const VectorImp &>(d).dir();
-        addXYElements(dir, parent, doc);
+        xml.writeAttribute(QLatin1String("type"), QLatin1String("vector"));
+        writeXYElements(static_cast<const VectorImp &>(d).dir(), xml);
         return QStringLiteral("vector");
     } else if (d.inherits(LocusImp::stype())) {
         const LocusImp &locus = static_cast<const LocusImp &>(d);
+        xml.writeAttribute(QLatin1String("type"), QLatin1String("locus"));
 
         // serialize the curve..
-        QDomElement curve = doc.createElement(QStringLiteral("curve"));
-        const CurveImp &curveimp = *locus.curve();
-        QString type = serialize(curveimp, curve, doc);
-        curve.setAttribute(QStringLiteral("type"), type);
-        parent.appendChild(curve);
+        xml.writeStartElement(QLatin1String("curve"));
+        serialize(*locus.curve(), xml);
+        xml.writeEndElement();
 
         // serialize the hierarchy..
-        QDomElement hier = doc.createElement(QStringLiteral("calculation"));
-        locus.hierarchy().serialize(hier, doc);
-        parent.appendChild(hier);
+        xml.writeStartElement(QLatin1String("calculation"));
+        locus.hierarchy().serialize(xml);
+        xml.writeEndElement();
 
         return QStringLiteral("locus");
     } else if (d.inherits(CircleImp::stype())) {
         const CircleImp &c = static_cast<const CircleImp &>(d);
-        addCoordinateElement("center", c.center(), parent, doc);
-        addDoubleElement("radius", c.radius(), parent, doc);
+        xml.writeAttribute(QLatin1String("type"), QLatin1String("circle"));
+        writeCoordinateElement("center", c.center(), xml);
+        writeDoubleElement("radius", c.radius(), xml);
         return QStringLiteral("circle");
     } else if (d.inherits(ConicImp::stype())) {
         const ConicPolarData data = static_cast<const ConicImp &>(d).polarData();
-        addCoordinateElement("focus1", data.focus1, parent, doc);
-        addDoubleElement("pdimen", data.pdimen, parent, doc);
-        addDoubleElement("ecostheta0", data.ecostheta0, parent, doc);
-        addDoubleElement("esintheta0", data.esintheta0, parent, doc);
+        xml.writeAttribute(QLatin1String("type"), QLatin1String("conic"));
+        writeCoordinateElement("focus1", data.focus1, xml);
+        writeDoubleElement("pdimen", data.pdimen, xml);
+        writeDoubleElement("ecostheta0", data.ecostheta0, xml);
+        writeDoubleElement("esintheta0", data.esintheta0, xml);
         return QStringLiteral("conic");
     } else if (d.inherits(CubicImp::stype())) {
+        static const char *const names[] = {"a000", "a001", "a002", "a011", "a012", "a022", "a111", "a112", "a122", "a222"};
         const CubicCartesianData data = static_cast<const CubicImp &>(d).data();
-        QDomElement coeffs = doc.createElement(QStringLiteral("coefficients"));
-        addDoubleElement("a000", data.coeffs[0], coeffs, doc);
-        addDoubleElement("a001", data.coeffs[1], coeffs, doc);
-        addDoubleElement("a002", data.coeffs[2], coeffs, doc);
-        addDoubleElement("a011", data.coeffs[3], coeffs, doc);
-        addDoubleElement("a012", data.coeffs[4], coeffs, doc);
-        addDoubleElement("a022", data.coeffs[5], coeffs, doc);
-        addDoubleElement("a111", data.coeffs[6], coeffs, doc);
-        addDoubleElement("a112", data.coeffs[7], coeffs, doc);
-        addDoubleElement("a122", data.coeffs[8], coeffs, doc);
-        addDoubleElement("a222", data.coeffs[9], coeffs, doc);
-        parent.appendChild(coeffs);
+        xml.writeAttribute(QLatin1String("type"), QLatin1String("cubic"));
+        xml.writeStartElement(QLatin1String("coefficients"));
+        for (int i = 0; i < 10; ++i)
+            writeDoubleElement(names[i], data.coeffs[i], xml);
+        xml.writeEndElement();
         return QStringLiteral("cubic");
     }
     assert(false);
@@ -419,7 +431,7 @@ ObjectImp *ObjectImpFactory::deserialize(const QString &type, const QDomElement
             KIG_GENERIC_PARSE_ERROR;
 
         n = n.nextSibling();
-        double a122 = readDoubleElement(n, ok, "a112");
+        double a122 = readDoubleElement(n, ok, "a122");
         if (!ok)
             KIG_GENERIC_PARSE_ERROR;
 
@@ -440,3 +452,94 @@ ObjectImp *ObjectImpFactory::deserialize(const QString &type, const QDomElement
         type);
     return nullptr;
 }
+
+QString ObjectImpFactory::serialize(const ObjectImp &d, std::vector<double> &data) const
+{
+    data.clear();
+    if (d.inherits(IntImp::stype())) {
+        data.push_back(static_cast<const IntImp &>(d).data());
+        return QStringLiteral("int");
+    } else if (d.inherits(DoubleImp::stype())) {
+        data.push_back(static_cast<const DoubleImp &>(d).data());
+        return QStringLiteral("double");
+    } else if (d.inherits(TransformationImp::stype())) {
+        const Transformation &trans = static_cast<const TransformationImp &>(d).data();
+        for (int i = 0; i < 3; ++i)
+            for (int j = 0; j < 3; ++j)
+                data.push_back(trans.data(i, j));
+        data.push_back(trans.isHomothetic() ? 1 : 0);
+        return QStringLiteral("transformation");
+    } else if (d.inherits(AbstractLineImp::stype())) {
+        LineData l = static_cast<const AbstractLineImp &>(d).data();
+        data = {l.a.x, l.a.y, l.b.x, l.b.y};
+        if (d.inherits(SegmentImp::stype()))
+            return QStringLiteral("segment");
+        else if (d.inherits(RayImp::stype()))
+            return QStringLiteral("ray");
+        else
+            return QStringLiteral("line");
+    } else if (d.inherits(PointImp::stype())) {
+        const Coordinate c = static_cast<const PointImp &>(d).coordinate();
+        data = {c.x, c.y};
+        return QStringLiteral("point");
+    } else if (d.inherits(AngleImp::stype())) {
+        data.push_back(static_cast<const AngleImp &>(d).size());
+        return QStringLiteral("angle");
+    } else if (d.inherits(ArcImp::stype())) {
+        const ArcImp &a = static_cast<const ArcImp &>(d);
+        data = {a.center().x, a.center().y, a.radius(), a.startAngle(), a.angle()};
+        return QStringLiteral("arc");
+    } else if (d.inherits(VectorImp::stype())) {
+        const Coordinate dir = static_cast<const VectorImp &>(d).dir();
+        data = {dir.x, dir.y};
+        return QStringLiteral("vector");
+    } else if (d.inherits(CircleImp::stype())) {
+        const CircleImp &c = static_cast<const CircleImp &>(d);
+        data = {c.center().x, c.center().y, c.radius()};
+        return QStringLiteral("circle");
+    } else if (d.inherits(ConicImp::stype())) {
+        const ConicPolarData p = static_cast<const ConicImp &>(d).polarData();
+        data = {p.focus1.x, p.focus1.y, p.pdimen, p.ecostheta0, p.esintheta0};
+        return QStringLiteral("conic");
+    } else if (d.inherits(CubicImp::stype())) {
+        const CubicCartesianData c = static_cast<const CubicImp &>(d).data();
+        data.assign(c.coeffs, c.coeffs + 10);
+        return QStringLiteral("cubic");
+    }
+    return QString();
+}
+
+ObjectImp *ObjectImpFactory::deserialize(const QString &type, const double *data, int n) const
+{
+    if (type == QLatin1String("int") && n == 1)
+        return new IntImp(static_cast<int>(data[0]));
+    else if (type == QLatin1String("double") && n == 1)
+        return new DoubleImp(data[0]);
+    else if (type == QLatin1String("transformation") && n == 10) {
+        double m[3][3];
+        for (int i = 0; i < 3; ++i)
+            for (int j = 0; j < 3; ++j)
+                m[i][j] = data[3 * i + j];
+        return new TransformationImp(Transformation(m, data[9] != 0));
+    } else if (type == QLatin1String("point") && n == 2)
+        return new PointImp(Coordinate(data[0], data[1]));
+    else if (type == QLatin1String("line") && n == 4)
+        return new LineImp(Coordinate(data[0], data[1]), Coordinate(data[2], data[3]));
+    else if (type == QLatin1String("segment") && n == 4)
+        return new SegmentImp(Coordinate(data[0], data[1]), Coordinate(data[2], data[3]));
+    else if (type == QLatin1String("ray") && n == 4)
+        return new RayImp(Coordinate(data[0], data[1]), Coordinate(data[2], data[3]));
+    else if (type == QLatin1String("angle") && n == 1)
+        return new AngleImp(Coordinate(), 0, data[0], false);
+    else if (type == QLatin1String("arc") && n == 5)
+        return new ArcImp(Coordinate(data[0], data[1]), data[2], data[3], data[4]);
+    else if (type == QLatin1String("vector") && n == 2)
+        return new VectorImp(Coordinate(), Coordinate(data[0], data[1]));
+    else if (type == QLatin1String("circle") && n == 3)
+        return new CircleImp(Coordinate(data[0], data[1]), data[2]);
+    else if (type == QLatin1String("conic") && n == 5)
+        return new ConicImpPolar(ConicPolarData(Coordinate(data[0], data[1]), data[2], data[3], data[4]));
+    else if (type == QLatin1String("cubic") && n == 10)
+        return new CubicImp(CubicCartesianData(data));
+    return nullptr;
+}
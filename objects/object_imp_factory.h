@@ -19,7 +19,20 @@ public:
      */
     ObjectImp *deserialize(const QString &type, const QDomElement &parent, QString &error) const;
     /**
-     * adds data to \p parent , and returns a type string.
+     * writes the type attribute and the data of \p d to the element
+     * that was just started on \p xml , and returns the type string.
      */
-    QString serialize(const ObjectImp &d, QDomElement &parent, QDomDocument &doc) const;
+    QString serialize(const ObjectImp &d, QXmlStreamWriter &xml) const;
+    /**
+     * for the types of ObjectImp's that consist of numbers only, stores
+     * the numbers of \p d in \p data , and returns a type string.  For
+     * the other types, an empty string is returned.
+     */
+    QString serialize(const ObjectImp &d, std::vector<double> &data) const;
+    /**
+     * builds a new ObjectImp of type \p type from the \p n numbers in
+     * \p data , as stored by the function above.  Returns 0 if they
+     * don't match the type.
+     */
+    ObjectImp *deserialize(const QString &type, const double *data, int n) const;
 };
@@ -28,6 +28,15 @@ ObjectType::ObjectType(const char fulltypename[])
     ObjectTypeFactory::instance()->add(this);
 }
 
+std::vector<ObjectImp *> ObjectType::calcBatch(const std::vector<Args> &parents, const KigDocument &d) const
+{
+    std::vector<ObjectImp *> ret;
+    ret.reserve(parents.size());
+    for (const Args &args : parents)
+        ret.push_back(calc(args, d));
+    return ret;
+}
+
 bool ObjectType::canMove(const ObjectTypeCalcer &) const
 {
     return false;
@@ -72,6 +81,11 @@ bool ObjectType::isTransform() const
     return false;
 }
 
+bool ObjectType::isThreadSafe() const
+{
+    return true;
+}
+
 QList<KLazyLocalizedString> ObjectType::specialActions() const
 {
     return QList<KLazyLocalizedString>();
@@ -30,6 +30,15 @@ public:
     virtual bool inherits(int type) const;
 
     virtual ObjectImp *calc(const Args &parents, const KigDocument &d) const = 0;
+    /**
+     * Calculate the results for several sets of parents at once, as
+     * calc() does for each of them.  This is used when the hierarchy of
+     * a locus is evaluated for many of its points.  The default
+     * implementation simply calls calc() for every set, types for which
+     * one call is much cheaper than many, like Python scripts,
+     * reimplement it.
+     */
+    virtual std::vector<ObjectImp *> calcBatch(const std::vector<Args> &parents, const KigDocument &d) const;
 
     virtual bool canMove(const ObjectTypeCalcer &ourobj) const;
     virtual bool isFreelyTranslatable(const ObjectTypeCalcer &ourobj) const;
@@ -73,6 +82,16 @@ public:
      */
     virtual bool isTransform() const;
 
+    /**
+     * can calc() and calcBatch() be called from another thread than the
+     * main one, concurrently with other calculations ?  This is true
+     * for all types that only compute their result from their
+     * parents, the default implementation returns true.  Types that
+     * run a Python script return false, they are always calculated on
+     * the main thread.  See calcAll().
+     */
+    virtual bool isThreadSafe() const;
+
     // ObjectType's can define some special actions, that are strictly
     // specific to the type at hand.  E.g. a text label allows to toggle
     // the display of a frame around the text.  Constrained and fixed
@@ -496,6 +496,11 @@ void ArcImp::visit(ObjectImpVisitor *vtor) const
     vtor->visit(this);
 }
 
+double ArcImp::getParamNear(const Coordinate &c, double, const KigDocument &d) const
+{
+    return getParam(c, d);
+}
+
 double ArcImp::getParam(const Coordinate &c, const KigDocument &) const
 {
     Coordinate d = (c - mcenter).normalize();
@@ -753,6 +758,11 @@ double VectorImp::getParam(const Coordinate &p, const KigDocument &) const
     return ((pt - mdata.a).length()) / (dir().length());
 }
 
+double VectorImp::getParamNear(const Coordinate &p, double, const KigDocument &d) const
+{
+    return getParam(p, d);
+}
+
 bool VectorImp::containsPoint(const Coordinate &p, const KigDocument &) const
 {
     return internalContainsPoint(p, test_threshold);
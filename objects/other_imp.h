@@ -117,6 +117,7 @@ public:
 
     const Coordinate getPoint(double param, const KigDocument &) const override;
     double getParam(const Coordinate &, const KigDocument &) const override;
+    double getParamNear(const Coordinate &, double, const KigDocument &) const override;
 
     void draw(KigPainter &p) const override;
     bool contains(const Coordinate &p, int width, const KigWidget &) const override;
@@ -208,6 +209,7 @@ public:
     void visit(ObjectImpVisitor *vtor) const override;
 
     double getParam(const Coordinate &c, const KigDocument &d) const override;
+    double getParamNear(const Coordinate &c, double hint, const KigDocument &d) const override;
     const Coordinate getPoint(double p, const KigDocument &d) const override;
 
     /**
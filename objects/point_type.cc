@@ -199,8 +199,12 @@ void ConstrainedPointType::move(ObjectTypeCalcer &ourobj, const Coordinate &to,
     ObjectConstCalcer *paramo = static_cast<ObjectConstCalcer *>(parents[0]);
     const CurveImp *ci = static_cast<const CurveImp *>(parents[1]->imp());
 
-    // fetch the new param..
-    const double np = ci->getParam(to, d);
+    // fetch the new param..  The param calcer still holds the param of
+    // the previous position, so during a drag we only need to look for
+    // the new one in its neighbourhood.
+    assert(paramo->imp()->inherits(DoubleImp::stype()));
+    const double op = static_cast<const DoubleImp *>(paramo->imp())->data();
+    const double np = ci->getParamNear(to, op, d);
 
     paramo->setImp(new DoubleImp(np));
 }
@@ -551,7 +555,9 @@ void ConstrainedRelativePointType::move(ObjectTypeCalcer &ourobj, const Coordina
     ObjectCalcer *ob = static_cast<ObjectCalcer *>(pa[3]);
 
     const CurveImp *curve = static_cast<const CurveImp *>(ob->imp());
-    double newp = curve->getParam(to, doc);
+    assert(op->imp()->inherits(DoubleImp::stype()));
+    const double oldp = static_cast<const DoubleImp *>(op->imp())->data();
+    double newp = curve->getParamNear(to, oldp, doc);
     Coordinate attach = curve->getPoint(newp, doc);
 
     ox->setImp(new DoubleImp(to.x - attach.x));
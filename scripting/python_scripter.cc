@@ -10,8 +10,11 @@
 #include "python_scripter.h"
 #include <Python.h>
 
+#include <algorithm>
+#include <chrono>
 #include <iostream>
 #include <string>
+#include <unordered_map>
 
 #include <boost/mpl/bool.hpp>
 #include <boost/python.hpp>
@@ -30,6 +33,9 @@
 #include "../objects/polygon_imp.h"
 #include "../objects/text_imp.h"
 
+#include <KConfigGroup>
+#include <KSharedConfig>
+
 using namespace boost::python;
 
 BOOST_PYTHON_MODULE_INIT(kig)
@@ -328,11 +334,17 @@ class PythonScripter::Private : private PythonInitializer
 {
 public:
     dict mainnamespace;
+    // the code objects of the scripts compiled so far, by their source.
+    // Script objects with the same code, in any document, only share
+    // the parsing and compiling: the code is run in a fresh namespace
+    // for every one of them, so module level state isn't shared.
+    std::unordered_map<std::string, handle<>> compiled;
 };
 
 PythonScripter::PythonScripter()
 {
     d = new Private;
+    timebudget = KSharedConfig::openConfig()->group("Python Scripting").readEntry("TimeBudget", 500);
 
     // find the main namespace..
 
@@ -355,6 +367,12 @@ class CompiledPythonScript::Private
 public:
     int ref;
     object calcfunc;
+    // the optional calcBatch function, which takes a list of argument
+    // tuples and returns a list of results
+    object calcbatchfunc;
+    // the tuple of arguments of the last call, which is reused for the
+    // next one as long as the script didn't keep a reference to it
+    handle<> args;
     // TODO
     //  object movefunc;
 };
@@ -364,6 +382,89 @@ ObjectImp *CompiledPythonScript::calc(const Args &args, const KigDocument &)
     return PythonScripter::instance()->calc(*this, args);
 }
 
+std::vector<ObjectImp *> CompiledPythonScript::calcBatch(const std::vector<Args> &argsets, const KigDocument &)
+{
+    return PythonScripter::instance()->calcBatch(*this, argsets);
+}
+
+bool CompiledPythonScript::operator==(const CompiledPythonScript &rhs) const
+{
+    return d == rhs.d && mstatistics == rhs.mstatistics;
+}
+
+const CompiledPythonScript::Statistics &CompiledPythonScript::statistics() const
+{
+    return *mstatistics;
+}
+
+void CompiledPythonScript::resetStatistics()
+{
+    *mstatistics = Statistics();
+}
+
+namespace
+{
+// the state of the call that ScriptTimer is timing, for budgetTrace()
+std::chrono::steady_clock::time_point budgetend;
+bool overbudget = false;
+int budgetevents = 0;
+
+int budgetTrace(PyObject *, PyFrameObject *, int, PyObject *)
+{
+    if (!overbudget) {
+        // looking at the clock on every line would slow the script down
+        // too much..
+        if (++budgetevents % 128 != 0 || std::chrono::steady_clock::now() < budgetend)
+            return 0;
+        overbudget = true;
+    }
+    // raised again for every event, in case the script catches it..
+    PyErr_SetString(PyExc_TimeoutError, "the script took longer than its time budget");
+    return -1;
+}
+
+/**
+ * Times a call of a script, that does evaluations calculations, and
+ * interrupts it once it takes longer than budget milliseconds for each
+ * of them.  A script that is interrupted is marked slow.  Code that is busy in a
+ * C function, like a single huge computation, can't be interrupted.
+ */
+class ScriptTimer
+{
+    CompiledPythonScript::Statistics &mstats;
+    const unsigned long mevaluations;
+    const bool mbudget;
+    const std::chrono::steady_clock::time_point mstart;
+
+public:
+    ScriptTimer(CompiledPythonScript::Statistics &stats, int budget, unsigned long evaluations)
+        : mstats(stats)
+        , mevaluations(evaluations)
+        , mbudget(budget > 0)
+        , mstart(std::chrono::steady_clock::now())
+    {
+        overbudget = false;
+        if (mbudget) {
+            budgetend = mstart + std::chrono::milliseconds(budget) * std::max(evaluations, 1ul);
+            budgetevents = 0;
+            PyEval_SetTrace(budgetTrace, nullptr);
+        }
+    }
+    ~ScriptTimer()
+    {
+        if (mbudget)
+            PyEval_SetTrace(nullptr, nullptr);
+        const double time = std::chrono::duration<double>(std::chrono::steady_clock::now() - mstart).count();
+        mstats.calls += mevaluations;
+        mstats.totaltime += time;
+        // a batch only tells us the average time of its calculations
+        mstats.maxtime = std::max(mstats.maxtime, time / std::max(mevaluations, 1ul));
+        if (overbudget)
+            mstats.slow = true;
+    }
+};
+}
+
 CompiledPythonScript::~CompiledPythonScript()
 {
     --d->ref;
@@ -373,6 +474,7 @@ CompiledPythonScript::~CompiledPythonScript()
 
 CompiledPythonScript::CompiledPythonScript(Private *ind)
     : d(ind)
+    , mstatistics(std::make_shared<Statistics>())
 {
     ++d->ref;
 }
@@ -380,10 +482,19 @@ CompiledPythonScript::CompiledPythonScript(Private *ind)
 CompiledPythonScript PythonScripter::compile(const char *code)
 {
     clearErrors();
+    const std::string source(code);
+    std::unordered_map<std::string, handle<>>::iterator cached = d->compiled.find(source);
+    handle<> codeobject;
+    if (cached != d->compiled.end())
+        codeobject = cached->second;
+
     dict retdict;
     bool error = false;
     try {
-        (void)PyRun_String(const_cast<char *>(code), Py_file_input, d->mainnamespace.ptr(), retdict.ptr());
+        if (!codeobject.get())
+            codeobject = handle<>(allow_null(Py_CompileString(code, "<string>", Py_file_input)));
+        if (codeobject.get())
+            handle<>(allow_null(PyEval_EvalCode(codeobject.get(), d->mainnamespace.ptr(), retdict.ptr())));
     } catch (...) {
         error = true;
     };
@@ -393,17 +504,27 @@ CompiledPythonScript PythonScripter::compile(const char *code)
         retdict.clear();
     }
 
+    // scripts that don't compile are not cached, so that the errors are
+    // reported again the next time..
+    if (cached == d->compiled.end() && codeobject.get()) {
+        if (d->compiled.size() >= 64)
+            d->compiled.clear();
+        d->compiled.emplace(source, codeobject);
+    }
+
     // debugging stuff, removed.
     //  std::string dictstring = extract<std::string>( str( retdict ) );
 
     CompiledPythonScript::Private *ret = new CompiledPythonScript::Private;
     ret->ref = 0;
     ret->calcfunc = retdict.get("calc");
+    ret->calcbatchfunc = retdict.get("calcBatch");
     return CompiledPythonScript(ret);
 }
 
 CompiledPythonScript::CompiledPythonScript(const CompiledPythonScript &s)
     : d(s.d)
+    , mstatistics(s.mstatistics)
 {
     ++d->ref;
 }
@@ -426,36 +547,32 @@ std::string PythonScripter::lastErrorExceptionTraceback() const
 ObjectImp *PythonScripter::calc(CompiledPythonScript &script, const Args &args)
 {
     clearErrors();
-    object calcfunc = script.d->calcfunc;
+    CompiledPythonScript::Private *sd = script.d;
+    CompiledPythonScript::Statistics &stats = *script.mstatistics;
+    if (stats.slow)
+        return new InvalidImp;
     try {
-        std::vector<object> objectvect;
-        objectvect.reserve(args.size());
+        // PyTuple_SetItem() only works on tuples nobody else refers to..
+        if (!sd->args.get() || Py_REFCNT(sd->args.get()) != 1 || PyTuple_GET_SIZE(sd->args.get()) != static_cast<Py_ssize_t>(args.size()))
+            sd->args = handle<>(PyTuple_New(args.size()));
 
-        for (int i = 0; i < (int)args.size(); ++i) {
+        for (uint i = 0; i < args.size(); ++i) {
             object o(boost::ref(*args[i]));
-            objectvect.push_back(o);
-        }
-
-        handle<> argstuph(PyTuple_New(args.size()));
-        for (int i = 0; i < (int)objectvect.size(); ++i) {
             /*
              * this fixes bug https://bugs.kde.org/show_bug.cgi?id=401512
              *
-             * it isn't completely clear whether we need XINCREF (test for null pointer)
-             * instead of INCREF.  However I think that the arguments should never be
-             * null pointers
-             *    mp
+             * PyTuple_SetItem steals a reference ( and releases the argument
+             * of the previous call ), so we give it one of its own.
              */
-            Py_INCREF((objectvect.begin() + i)->ptr());
-            PyTuple_SetItem(argstuph.get(), i, (objectvect.begin() + i)->ptr());
+            PyTuple_SetItem(sd->args.get(), i, incref(o.ptr()));
         };
-        tuple argstup(argstuph);
 
-        handle<> reth(PyObject_CallObject(calcfunc.ptr(), argstup.ptr()));
-        //    object resulto = calcfunc( argstup );
-        //    handle<> reth( PyObject_CallObject( calcfunc.ptr(), args ) );
+        ScriptTimer timer(stats, timebudget, 1);
+        handle<> reth(PyObject_CallObject(sd->calcfunc.ptr(), sd->args.get()));
         object resulto(reth);
 
+        // the result is held by value in its Python object, so we can't
+        // take it over and need a copy..
         extract<ObjectImp &> result(resulto);
         if (!result.check())
             return new InvalidImp;
@@ -470,6 +587,64 @@ ObjectImp *PythonScripter::calc(CompiledPythonScript &script, const Args &args)
     };
 }
 
+std::vector<ObjectImp *> PythonScripter::calcBatch(CompiledPythonScript &script, const std::vector<Args> &argsets)
+{
+    CompiledPythonScript::Private *sd = script.d;
+    std::vector<ObjectImp *> ret;
+    ret.reserve(argsets.size());
+    if (!sd->calcbatchfunc) {
+        for (uint i = 0; i < argsets.size(); ++i)
+            ret.push_back(calc(script, argsets[i]));
+        return ret;
+    }
+
+    clearErrors();
+    CompiledPythonScript::Statistics &stats = *script.mstatistics;
+    if (stats.slow) {
+        for (uint i = 0; i < argsets.size(); ++i)
+            ret.push_back(new InvalidImp);
+        return ret;
+    }
+    try {
+        list argslist;
+        for (uint i = 0; i < argsets.size(); ++i) {
+            const Args &args = argsets[i];
+            handle<> argstuple(PyTuple_New(args.size()));
+            for (uint j = 0; j < args.size(); ++j) {
+                object o(boost::ref(*args[j]));
+                // see calc() above..
+                PyTuple_SetItem(argstuple.get(), j, incref(o.ptr()));
+            };
+            argslist.append(object(argstuple));
+        };
+
+        ScriptTimer timer(stats, timebudget, argsets.size());
+        object resultso = sd->calcbatchfunc(argslist);
+        if (len(resultso) != static_cast<ssize_t>(argsets.size())) {
+            PyErr_SetString(PyExc_ValueError, "calcBatch must return one result for every argument tuple");
+            throw_error_already_set();
+        }
+        for (uint i = 0; i < argsets.size(); ++i) {
+            object resulto = resultso[i];
+            extract<ObjectImp &> result(resulto);
+            if (!result.check())
+                ret.push_back(new InvalidImp);
+            else
+                ret.push_back(result().copy());
+        };
+        return ret;
+    } catch (...) {
+        saveErrors();
+
+        for (uint i = 0; i < ret.size(); ++i)
+            delete ret[i];
+        ret.clear();
+        for (uint i = 0; i < argsets.size(); ++i)
+            ret.push_back(new InvalidImp);
+        return ret;
+    };
+}
+
 void PythonScripter::saveErrors()
 {
     erroroccurred = true;
@@ -523,6 +698,18 @@ bool CompiledPythonScript::valid()
     return !!d->calcfunc;
 }
 
+int PythonScripter::timeBudget() const
+{
+    return timebudget;
+}
+
+void PythonScripter::setTimeBudget(int msecs)
+{
+    timebudget = msecs;
+    KConfigGroup cg = KSharedConfig::openConfig()->group("Python Scripting");
+    cg.writeEntry("TimeBudget", timebudget);
+}
+
 bool PythonScripter::errorOccurred() const
 {
     return erroroccurred;
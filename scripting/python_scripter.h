@@ -6,7 +6,9 @@
 
 #include "../objects/common.h"
 
+#include <memory>
 #include <string>
+#include <vector>
 
 class KigDocument;
 class ObjectImp;
@@ -18,12 +20,44 @@ class CompiledPythonScript
     Private *const d;
     CompiledPythonScript(Private *);
 
+public:
+    /**
+     * How long the calls of a script took so far, and whether it was
+     * interrupted for going over PythonScripter::timeBudget().  A slow
+     * script isn't run any more until its statistics are reset.  The
+     * times are in seconds.
+     */
+    struct Statistics {
+        unsigned long calls = 0;
+        double totaltime = 0.;
+        double maxtime = 0.;
+        bool slow = false;
+    };
+
+private:
+    // the statistics are not shared with the other objects that run
+    // the same code, only with the copies of this script
+    std::shared_ptr<Statistics> mstatistics;
+
 public:
     CompiledPythonScript(const CompiledPythonScript &s);
     ~CompiledPythonScript();
     ObjectImp *calc(const Args &a, const KigDocument &doc);
+    /**
+     * Calculate the script for a number of argument lists at once, in a
+     * single call to its calcBatch function if it defines one.
+     */
+    std::vector<ObjectImp *> calcBatch(const std::vector<Args> &argsets, const KigDocument &doc);
 
     bool valid();
+    /**
+     * Two scripts are equal if they are copies of the same one, and so
+     * share their code and statistics.
+     */
+    bool operator==(const CompiledPythonScript &rhs) const;
+
+    const Statistics &statistics() const;
+    void resetStatistics();
 };
 
 class PythonScripter
@@ -38,6 +72,7 @@ class PythonScripter
     void saveErrors();
 
     bool erroroccurred;
+    int timebudget;
     std::string lastexceptiontype;
     std::string lastexceptionvalue;
     std::string lastexceptiontraceback;
@@ -50,6 +85,16 @@ public:
     std::string lastErrorExceptionValue() const;
     std::string lastErrorExceptionTraceback() const;
 
+    /**
+     * The time in milliseconds a single calculation of a script may
+     * take before it is interrupted and marked slow, 0 means no limit.
+     * A call of calcBatch() gets this for every argument list.  It is
+     * kept in the application's configuration.
+     */
+    int timeBudget() const;
+    void setTimeBudget(int msecs);
+
     CompiledPythonScript compile(const char *code);
     ObjectImp *calc(CompiledPythonScript &script, const Args &args);
+    std::vector<ObjectImp *> calcBatch(CompiledPythonScript &script, const std::vector<Args> &argsets);
 };
@@ -7,6 +7,7 @@
 #include "python_scripter.h"
 
 #include "../objects/bogus_imp.h"
+#include "../objects/object_calcer.h"
 #include "../objects/object_imp.h"
 
 class PythonCompiledScriptImp : public BogusImp
@@ -114,6 +115,12 @@ ObjectImp *PythonCompileType::calc(const Args &parents, const KigDocument &) con
         return new InvalidImp();
 }
 
+bool PythonCompileType::isThreadSafe() const
+{
+    // the interpreter only runs on the main thread..
+    return false;
+}
+
 KIG_INSTANTIATE_OBJECT_TYPE_INSTANCE(PythonExecuteType)
 
 PythonExecuteType::PythonExecuteType()
@@ -143,6 +150,46 @@ ObjectImp *PythonExecuteType::calc(const Args &parents, const KigDocument &d) co
     return script.calc(args, d);
 }
 
+bool PythonExecuteType::isThreadSafe() const
+{
+    return false;
+}
+
+CompiledPythonScript *PythonExecuteType::script(const ObjectTypeCalcer &o)
+{
+    assert(o.type() == instance());
+    const std::vector<ObjectCalcer *> parents = o.parents();
+    if (parents.empty() || !parents[0]->imp()->inherits(PythonCompiledScriptImp::stype()))
+        return nullptr;
+    return &static_cast<const PythonCompiledScriptImp *>(parents[0]->imp())->data();
+}
+
+std::vector<ObjectImp *> PythonExecuteType::calcBatch(const std::vector<Args> &parents, const KigDocument &d) const
+{
+    std::vector<ObjectImp *> ret;
+    ret.reserve(parents.size());
+    // hand every run of argument lists for the same script to it at once..
+    uint i = 0;
+    while (i < parents.size()) {
+        assert(parents[i].size() >= 1);
+        if (!parents[i][0]->inherits(PythonCompiledScriptImp::stype())) {
+            ret.push_back(new InvalidImp);
+            ++i;
+            continue;
+        }
+        CompiledPythonScript &script = static_cast<const PythonCompiledScriptImp *>(parents[i][0])->data();
+        std::vector<Args> argsets;
+        for (; i < parents.size(); ++i) {
+            if (!parents[i][0]->inherits(PythonCompiledScriptImp::stype()) || !(static_cast<const PythonCompiledScriptImp *>(parents[i][0])->data() == script))
+                break;
+            argsets.push_back(Args(parents[i].begin() + 1, parents[i].end()));
+        }
+        std::vector<ObjectImp *> results = script.calcBatch(argsets, d);
+        ret.insert(ret.end(), results.begin(), results.end());
+    }
+    return ret;
+}
+
 const ObjectImpType *PythonExecuteType::impRequirement(const ObjectImp *o, const Args &parents) const
 {
     if (o == parents[0])
@@ -6,6 +6,8 @@
 
 #include "../objects/object_type.h"
 
+class CompiledPythonScript;
+
 class PythonCompileType : public ObjectType
 {
     PythonCompileType();
@@ -15,6 +17,7 @@ public:
     static const PythonCompileType *instance();
 
     ObjectImp *calc(const Args &parents, const KigDocument &d) const override;
+    bool isThreadSafe() const override;
 
     const ObjectImpType *impRequirement(const ObjectImp *o, const Args &parents) const override;
     bool isDefinedOnOrThrough(const ObjectImp *o, const Args &parents) const override;
@@ -32,7 +35,16 @@ class PythonExecuteType : public ObjectType
 public:
     static const PythonExecuteType *instance();
 
+    /**
+     * The compiled script of the object o of this type, or 0 if its
+     * code doesn't compile.  Its statistics are those of o alone, other
+     * objects running the same code have their own.
+     */
+    static CompiledPythonScript *script(const ObjectTypeCalcer &o);
+
     ObjectImp *calc(const Args &parents, const KigDocument &d) const override;
+    std::vector<ObjectImp *> calcBatch(const std::vector<Args> &parents, const KigDocument &d) const override;
+    bool isThreadSafe() const override;
 
     const ObjectImpType *impRequirement(const ObjectImp *o, const Args &parents) const override;
     bool isDefinedOnOrThrough(const ObjectImp *o, const Args &parents) const override;
@@ -0,0 +1,138 @@
+// SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include "scriptcostsdialog.h"
+
+#include "python_scripter.h"
+#include "python_type.h"
+
+#include "../objects/object_calcer.h"
+#include "../objects/object_holder.h"
+
+#include <QDialogButtonBox>
+#include <QFormLayout>
+#include <QHeaderView>
+#include <QPushButton>
+#include <QSpinBox>
+#include <QTableWidget>
+#include <QVBoxLayout>
+
+#include <KLocalizedString>
+
+#include <cmath>
+
+namespace
+{
+QTableWidgetItem *numberItem(double value)
+{
+    QTableWidgetItem *item = new QTableWidgetItem;
+    item->setData(Qt::DisplayRole, value);
+    item->setTextAlignment(Qt::AlignRight | Qt::AlignVCenter);
+    return item;
+}
+
+// a time in seconds as milliseconds, rounded to hundredths
+double milliseconds(double seconds)
+{
+    return std::round(seconds * 1e5) / 100;
+}
+}
+
+ScriptCostsDialog::ScriptCostsDialog(const std::vector<ObjectHolder *> &objects, QWidget *parent)
+    : QDialog(parent)
+    , mchanged(false)
+{
+    setWindowTitle(i18nc("@title:window", "Python Script Costs"));
+
+    for (std::vector<ObjectHolder *>::const_iterator i = objects.begin(); i != objects.end(); ++i) {
+        const ObjectTypeCalcer *calcer = dynamic_cast<const ObjectTypeCalcer *>((*i)->calcer());
+        if (!calcer || calcer->type() != PythonExecuteType::instance())
+            continue;
+        CompiledPythonScript *script = PythonExecuteType::script(*calcer);
+        if (!script)
+            continue;
+        mobjects.push_back(*i);
+        mscripts.push_back(script);
+    }
+
+    QVBoxLayout *layout = new QVBoxLayout(this);
+
+    QFormLayout *form = new QFormLayout;
+    mbudget = new QSpinBox(this);
+    mbudget->setRange(0, 60000);
+    mbudget->setSingleStep(100);
+    mbudget->setSuffix(i18nc("milliseconds", " ms"));
+    mbudget->setSpecialValueText(i18n("No limit"));
+    mbudget->setValue(PythonScripter::instance()->timeBudget());
+    mbudget->setToolTip(i18n("A script that takes longer than this for a single calculation is stopped, and not run again until its statistics are reset."));
+    form->addRow(i18n("Time budget per calculation:"), mbudget);
+    layout->addLayout(form);
+
+    mtable = new QTableWidget(this);
+    mtable->setColumnCount(6);
+    mtable->setHorizontalHeaderLabels(QStringList() << i18n("Object") << i18n("Calculations") << i18n("Average (ms)") << i18n("Longest (ms)")
+                                                    << i18n("Total (ms)") << i18n("Status"));
+    mtable->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    mtable->setSelectionMode(QAbstractItemView::NoSelection);
+    mtable->verticalHeader()->hide();
+    mtable->horizontalHeader()->setSectionResizeMode(0, QHeaderView::Stretch);
+    layout->addWidget(mtable);
+
+    QDialogButtonBox *buttons = new QDialogButtonBox(QDialogButtonBox::Reset | QDialogButtonBox::Close, this);
+    buttons->button(QDialogButtonBox::Reset)->setToolTip(i18n("Forget the statistics of the scripts, and run the slow ones again."));
+    layout->addWidget(buttons);
+
+    connect(mbudget, &QSpinBox::valueChanged, this, &ScriptCostsDialog::budgetChanged);
+    connect(buttons->button(QDialogButtonBox::Reset), &QPushButton::clicked, this, &ScriptCostsDialog::resetStatistics);
+    connect(buttons, &QDialogButtonBox::rejected, this, &QDialog::reject);
+
+    fillTable();
+    resize(600, 300);
+}
+
+ScriptCostsDialog::~ScriptCostsDialog()
+{
+}
+
+bool ScriptCostsDialog::changed() const
+{
+    return mchanged;
+}
+
+void ScriptCostsDialog::budgetChanged(int msecs)
+{
+    PythonScripter::instance()->setTimeBudget(msecs);
+    mchanged = true;
+}
+
+void ScriptCostsDialog::resetStatistics()
+{
+    for (std::vector<CompiledPythonScript *>::iterator i = mscripts.begin(); i != mscripts.end(); ++i)
+        (*i)->resetStatistics();
+    mchanged = true;
+    fillTable();
+}
+
+void ScriptCostsDialog::fillTable()
+{
+    mtable->setSortingEnabled(false);
+    mtable->setRowCount(mobjects.size());
+    for (uint i = 0; i < mobjects.size(); ++i) {
+        const CompiledPythonScript::Statistics &stats = mscripts[i]->statistics();
+        const QString name = mobjects[i]->name();
+        mtable->setItem(i, 0, new QTableWidgetItem(name.isEmpty() ? i18n("Python Script %1", i + 1) : name));
+        QTableWidgetItem *calls = new QTableWidgetItem;
+        calls->setData(Qt::DisplayRole, static_cast<qulonglong>(stats.calls));
+        calls->setTextAlignment(Qt::AlignRight | Qt::AlignVCenter);
+        mtable->setItem(i, 1, calls);
+        mtable->setItem(i, 2, numberItem(stats.calls > 0 ? milliseconds(stats.totaltime / stats.calls) : 0.));
+        mtable->setItem(i, 3, numberItem(milliseconds(stats.maxtime)));
+        mtable->setItem(i, 4, numberItem(milliseconds(stats.totaltime)));
+        mtable->setItem(i, 5, new QTableWidgetItem(stats.slow ? i18n("Stopped, too slow") : QString()));
+    }
+    mtable->setSortingEnabled(true);
+    mtable->sortByColumn(4, Qt::DescendingOrder);
+}
+
+#include "moc_scriptcostsdialog.cpp"
@@ -0,0 +1,47 @@
+// SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#pragma once
+
+#include <QDialog>
+
+#include <vector>
+
+class CompiledPythonScript;
+class ObjectHolder;
+class QSpinBox;
+class QTableWidget;
+
+/**
+ * A dialog listing the Python script objects of a document with the
+ * time their scripts took so far, and the scripts that were stopped for
+ * going over the time budget, which can be changed here too.
+ */
+class ScriptCostsDialog : public QDialog
+{
+    Q_OBJECT
+
+public:
+    ScriptCostsDialog(const std::vector<ObjectHolder *> &objects, QWidget *parent);
+    ~ScriptCostsDialog();
+
+    /**
+     * whether the scripts need to be calculated again, because the
+     * budget was changed or the statistics were reset.
+     */
+    bool changed() const;
+
+private Q_SLOTS:
+    void budgetChanged(int msecs);
+    void resetStatistics();
+
+private:
+    void fillTable();
+
+    std::vector<ObjectHolder *> mobjects;
+    std::vector<CompiledPythonScript *> mscripts;
+    QSpinBox *mbudget;
+    QTableWidget *mtable;
+    bool mchanged;
+};
@@ -0,0 +1,115 @@
+/*
+    SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "../kig/kig_document.h"
+#include "../misc/calcpaths.h"
+#include "../objects/bezier_type.h"
+#include "../objects/bogus_imp.h"
+#include "../objects/circle_imp.h"
+#include "../objects/line_type.h"
+#include "../objects/object_calcer.h"
+#include "../objects/object_factory.h"
+#include "../objects/point_type.h"
+#include "../objects/tangent_type.h"
+
+#include <QTest>
+#include <QThreadPool>
+
+#include <algorithm>
+#include <memory>
+
+class CalcAllTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void initTestCase();
+    void testSameAsSerial();
+};
+
+namespace
+{
+/**
+ * Builds a few independent chains of objects, with points constrained
+ * to circles, Bézier curves and loci, which all set
+ * KigDocument::mcachedparam while they are calculated.  The tangents
+ * are those of circles, whose CircleImp::getParam() doesn't depend on
+ * what was calculated before.
+ */
+std::vector<ObjectCalcer::shared_ptr> buildCalcers(const KigDocument &doc)
+{
+    std::vector<ObjectCalcer::shared_ptr> calcers;
+    // the calcers are calculated as they are built, locusCalcer() needs
+    // the imps of the moving point
+    auto add = [&](ObjectCalcer *c) {
+        c->calc(doc);
+        calcers.push_back(c);
+        return c;
+    };
+    const ObjectFactory *factory = ObjectFactory::instance();
+
+    for (int k = 0; k < 8; ++k) {
+        std::vector<ObjectCalcer *> controls;
+        for (int j = 0; j < 4; ++j)
+            controls.push_back(add(factory->fixedPointCalcer(Coordinate(k + j, (j % 2) * (k + 1)))));
+        ObjectCalcer *bezier = add(new ObjectTypeCalcer(BezierCubicType::instance(), controls));
+        ObjectCalcer *onbezier = add(factory->constrainedPointCalcer(bezier, 0.2 + 0.05 * k));
+
+        ObjectCalcer *circle = add(new ObjectConstCalcer(new CircleImp(Coordinate(k, -k), 1 + 0.1 * k)));
+        ObjectCalcer *oncircle = add(factory->constrainedPointCalcer(circle, 0.1 * k));
+        std::vector<ObjectCalcer *> args = {circle, oncircle};
+        add(new ObjectTypeCalcer(TangentCurveType::instance(), args));
+
+        args = {oncircle, onbezier};
+        ObjectCalcer *mid = add(new ObjectTypeCalcer(MidPointType::instance(), args));
+        ObjectCalcer *locus = add(factory->locusCalcer(oncircle, mid));
+        ObjectCalcer *onlocus = add(factory->constrainedPointCalcer(locus, 0.3 + 0.05 * k));
+
+        args = {mid, onlocus};
+        ObjectCalcer *segment = add(new ObjectTypeCalcer(SegmentABType::instance(), args));
+        add(new ObjectPropertyCalcer(segment, "mid-point"));
+    }
+    return calcers;
+}
+}
+
+void CalcAllTest::initTestCase()
+{
+    // calcAll() only uses the threads of the pool, make sure there are
+    // some on every machine
+    QThreadPool::globalInstance()->setMaxThreadCount(std::max(4, QThreadPool::globalInstance()->maxThreadCount()));
+}
+
+void CalcAllTest::testSameAsSerial()
+{
+    KigDocument doc;
+    const std::vector<ObjectCalcer::shared_ptr> calcers = buildCalcers(doc);
+    std::vector<ObjectCalcer *> all;
+    for (const ObjectCalcer::shared_ptr &c : calcers)
+        all.push_back(c.get());
+    const std::vector<ObjectCalcer *> path = calcPath(getAllParents(all));
+    // short paths are calculated serially by calcAll() too
+    QVERIFY(path.size() >= 64);
+
+    for (ObjectCalcer *c : path)
+        c->calc(doc);
+    std::vector<std::unique_ptr<ObjectImp>> serial;
+    for (ObjectCalcer *c : path) {
+        QVERIFY(!c->imp()->inherits(InvalidImp::stype()));
+        serial.emplace_back(c->imp()->copy());
+    }
+
+    // the threads don't take the objects in the same order every time..
+    for (int run = 0; run < 20; ++run) {
+        calcAll(path, doc);
+        for (uint i = 0; i < path.size(); ++i)
+            QVERIFY2(path[i]->imp()->equals(*serial[i]), path[i]->imp()->type()->internalName());
+    }
+}
+
+QTEST_GUILESS_MAIN(CalcAllTest)
+
+#include "calcalltest.moc"
@@ -0,0 +1,308 @@
+/*
+    SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "../misc/kignumerics.h"
+
+#include <QTest>
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+class KigNumericsTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void testCubicRoots_data();
+    void testCubicRoots();
+    void testCubicRootNumbering();
+    void benchmarkCubicRoots_data();
+    void benchmarkCubicRoots();
+};
+
+namespace
+{
+// the cubics of the tests are given by their roots, with
+// multiplicities, and a leading coefficient
+void coefficients(double lead, double r1, double r2, double r3, double &a, double &b, double &c, double &d)
+{
+    a = lead;
+    b = -lead * (r1 + r2 + r3);
+    c = lead * (r1 * r2 + r1 * r3 + r2 * r3);
+    d = -lead * r1 * r2 * r3;
+}
+
+/*
+ * the bisection on the Sturm sequence that calcCubicRoot() used before
+ * calcCubicRoots(), as the baseline of the benchmark.  Only the cubic
+ * case is kept, the cubics of the benchmark have a leading coefficient
+ * of 1.
+ */
+int sturmVariations(double x, double a, double b, double c, double d, double p1a, double p1b, double p0a)
+{
+    double fval, fpval;
+    fval = fpval = a;
+    fval = b + x * fval;
+    fpval = fval + x * fpval;
+    fval = c + x * fval;
+    fpval = fval + x * fpval;
+    fval = d + x * fval;
+
+    double f1val = p1a * x + p1b;
+
+    bool f3pos = fval >= 0;
+    bool f2pos = fpval <= 0;
+    bool f1pos = f1val >= 0;
+    bool f0pos = p0a >= 0;
+
+    int variations = 0;
+    if (f3pos != f2pos)
+        variations++;
+    if (f2pos != f1pos)
+        variations++;
+    if (f1pos != f0pos)
+        variations++;
+    return variations;
+}
+
+void sturmDerivatives(double x, double a, double b, double c, double d, double &fval, double &fpval, double &fppval)
+{
+    fval = fpval = fppval = a;
+    fval = b + x * fval;
+    fpval = fval + x * fpval;
+    fppval = fpval + x * fppval;
+    fval = c + x * fval;
+    fpval = fval + x * fpval;
+    fval = d + x * fval;
+}
+
+double sturmNewton(double xmin, double xmax, double a, double b, double c, double d, double tol)
+{
+    double fval, fpval, fppval;
+
+    double fval1, fval2, fpval1, fpval2, fppval1, fppval2;
+    sturmDerivatives(xmin, a, b, c, d, fval1, fpval1, fppval1);
+    sturmDerivatives(xmax, a, b, c, d, fval2, fpval2, fppval2);
+
+    while (xmax - xmin > tol) {
+        if (fppval1 * fppval2 < 0 || fpval1 * fpval2 < 0) {
+            double xmiddle = (xmin + xmax) / 2;
+            sturmDerivatives(xmiddle, a, b, c, d, fval, fpval, fppval);
+            if (fval1 * fval <= 0) {
+                xmax = xmiddle;
+                fval2 = fval;
+                fpval2 = fpval;
+                fppval2 = fppval;
+            } else {
+                xmin = xmiddle;
+                fval1 = fval;
+                fpval1 = fpval;
+                fppval1 = fppval;
+            }
+        } else {
+            double x = xmin;
+            if (fval2 * fppval2 > 0)
+                x = xmax;
+            double p = 1.0;
+            int iterations = 0;
+            while (std::fabs(p) > tol && iterations++ < 100) {
+                sturmDerivatives(x, a, b, c, d, fval, fpval, fppval);
+                p = fval / fpval;
+                x -= p;
+            }
+            if (iterations >= 100)
+                return std::numeric_limits<double>::infinity();
+            return x;
+        }
+    }
+    return (xmin + xmax) / 2;
+}
+
+double sturmCubicRoot(double a, double b, double c, double d, int root, bool &valid, int &numroots)
+{
+    assert(a > 0);
+    double infnorm = std::max({std::fabs(a), std::fabs(b), std::fabs(c), std::fabs(d)});
+    a /= infnorm;
+    b /= infnorm;
+    c /= infnorm;
+    d /= infnorm;
+
+    double xmax = std::max({std::fabs(d / a), std::fabs(c / a) + 1, std::fabs(b / a) + 1});
+    double xmin = -xmax;
+
+    double p1a = 2 * b * b - 6 * a * c;
+    double p1b = b * c - 9 * a * d;
+    double p0a = c * p1a * p1a + p1b * (3 * a * p1b - 2 * b * p1a);
+
+    int varbottom = sturmVariations(xmin, a, b, c, d, p1a, p1b, p0a);
+    int vartop = sturmVariations(xmax, a, b, c, d, p1a, p1b, p0a);
+    numroots = vartop - varbottom;
+    valid = false;
+    if (root <= varbottom || root > vartop)
+        return 0.0;
+    valid = true;
+
+    double dx = (xmax - xmin) / 2;
+    while (vartop - varbottom > 1) {
+        if (std::fabs(dx) < 1e-8)
+            return (xmin + xmax) / 2;
+        double xmiddle = xmin + dx;
+        int varmiddle = sturmVariations(xmiddle, a, b, c, d, p1a, p1b, p0a);
+        if (varmiddle < root) {
+            xmin = xmiddle;
+            varbottom = varmiddle;
+        } else {
+            xmax = xmiddle;
+            vartop = varmiddle;
+        }
+        dx /= 2;
+    }
+    if (vartop - varbottom == 1)
+        return sturmNewton(xmin, xmax, a, b, c, d, 1e-8);
+    return (xmin + xmax) / 2;
+}
+}
+
+void KigNumericsTest::testCubicRoots_data()
+{
+    QTest::addColumn<double>("lead");
+    QTest::addColumn<double>("r1");
+    QTest::addColumn<double>("r2");
+    QTest::addColumn<double>("r3");
+    // the error we accept on the roots: a root of multiplicity m is
+    // only determined up to about the m'th root of the machine epsilon
+    QTest::addColumn<double>("tolerance");
+
+    QTest::newRow("distinct") << 1. << -2. << 0.5 << 3. << 1e-12;
+    QTest::newRow("distinct, negative leading coefficient") << -4. << -1. << 1. << 7. << 1e-12;
+    QTest::newRow("distinct, large") << 1. << -1e3 << 1. << 1e3 << 1e-9;
+    QTest::newRow("double root") << 1. << 1. << 1. << -2. << 1e-7;
+    QTest::newRow("double root, scaled") << 3. << -0.5 << 2. << 2. << 1e-7;
+    QTest::newRow("triple root") << 1. << 1. << 1. << 1. << 1e-5;
+    QTest::newRow("triple root at zero") << 2. << 0. << 0. << 0. << 1e-5;
+    QTest::newRow("nearly equal roots") << 1. << 1. << 1. + 1e-4 << -3. << 1e-7;
+    QTest::newRow("nearly equal roots, close to zero") << 1. << 1e-3 << 1.001e-3 << 2. << 1e-7;
+    QTest::newRow("nearly triple root") << 1. << 1. - 1e-3 << 1. << 1. + 1e-3 << 1e-5;
+}
+
+void KigNumericsTest::testCubicRoots()
+{
+    QFETCH(double, lead);
+    QFETCH(double, r1);
+    QFETCH(double, r2);
+    QFETCH(double, r3);
+    QFETCH(double, tolerance);
+
+    double a, b, c, d;
+    coefficients(lead, r1, r2, r3, a, b, c, d);
+    double roots[3];
+    const int numroots = calcCubicRoots(a, b, c, d, roots);
+    QVERIFY(numroots >= 1 && numroots <= 3);
+
+    // increasing order
+    for (int i = 1; i < numroots; ++i)
+        QVERIFY(roots[i - 1] < roots[i]);
+    // every root found is one of the real roots, and every real root is
+    // found.  Multiple and nearly multiple roots may be found once or
+    // several times.
+    const std::vector<double> expected = {r1, r2, r3};
+    for (int i = 0; i < numroots; ++i) {
+        double best = 1e300;
+        for (double e : expected)
+            best = std::min(best, std::fabs(roots[i] - e));
+        QVERIFY2(best <= tolerance * (1 + std::fabs(roots[i])), qPrintable(QStringLiteral("unexpected root %1").arg(roots[i], 0, 'g', 17)));
+    }
+    for (double e : expected) {
+        double best = 1e300;
+        for (int i = 0; i < numroots; ++i)
+            best = std::min(best, std::fabs(roots[i] - e));
+        QVERIFY2(best <= tolerance * (1 + std::fabs(e)), qPrintable(QStringLiteral("missed root %1").arg(e, 0, 'g', 17)));
+    }
+}
+
+void KigNumericsTest::testCubicRootNumbering()
+{
+    // calcCubicRoot() numbers the roots from the left, and only counts
+    // those between xmin and xmax
+    double a, b, c, d;
+    coefficients(1., -2., 0.5, 3., a, b, c, d);
+    bool valid;
+    int numroots;
+    QCOMPARE(calcCubicRoot(-1e10, 1e10, a, b, c, d, 1, valid, numroots), -2.);
+    QVERIFY(valid);
+    QCOMPARE(numroots, 3);
+    QCOMPARE(calcCubicRoot(-1e10, 1e10, a, b, c, d, 3, valid, numroots), 3.);
+    QVERIFY(valid);
+    calcCubicRoot(0., 1e10, a, b, c, d, 1, valid, numroots);
+    QVERIFY(!valid);
+    QCOMPARE(numroots, 2);
+    QCOMPARE(calcCubicRoot(0., 1e10, a, b, c, d, 2, valid, numroots), 0.5);
+    QVERIFY(valid);
+
+    // a single real root, which keeps the number it had before the
+    // other two became complex
+    int numvalid = 0;
+    for (int root = 1; root <= 3; ++root) {
+        calcCubicRoot(-1e10, 1e10, 1., 0., 1., 1., root, valid, numroots);
+        QCOMPARE(numroots, 1);
+        if (valid)
+            ++numvalid;
+    }
+    QCOMPARE(numvalid, 1);
+}
+
+void KigNumericsTest::benchmarkCubicRoots_data()
+{
+    QTest::addColumn<int>("method");
+    QTest::newRow("calcCubicRoots") << 0;
+    QTest::newRow("calcCubicRoot per root") << 1;
+    QTest::newRow("Sturm bisection per root") << 2;
+}
+
+void KigNumericsTest::benchmarkCubicRoots()
+{
+    QFETCH(int, method);
+
+    // a family of cubics sweeping through triple, double, nearly equal
+    // and distinct roots, like a cubic drawn while one of its points is
+    // dragged
+    std::vector<double> coeffs;
+    for (int i = 0; i < 1000; ++i) {
+        double a, b, c, d;
+        const double t = (i - 500) * 1e-3;
+        coefficients(1., t, 0., -t * t, a, b, c, d);
+        coeffs.insert(coeffs.end(), {a, b, c, d});
+    }
+
+    double sum = 0;
+    QBENCHMARK {
+        for (std::size_t i = 0; i < coeffs.size(); i += 4) {
+            if (method == 0) {
+                double roots[3];
+                const int n = calcCubicRoots(coeffs[i], coeffs[i + 1], coeffs[i + 2], coeffs[i + 3], roots);
+                for (int j = 0; j < n; ++j)
+                    sum += roots[j];
+            } else {
+                bool valid;
+                int numroots;
+                for (int root = 1; root <= 3; ++root) {
+                    if (method == 1)
+                        sum += calcCubicRoot(-1e10, 1e10, coeffs[i], coeffs[i + 1], coeffs[i + 2], coeffs[i + 3], root, valid, numroots);
+                    else
+                        sum += sturmCubicRoot(coeffs[i], coeffs[i + 1], coeffs[i + 2], coeffs[i + 3], root, valid, numroots);
+                }
+            }
+        }
+    }
+    QVERIFY(std::isfinite(sum));
+}
+
+QTEST_GUILESS_MAIN(KigNumericsTest)
+
+#include "kignumericstest.moc"
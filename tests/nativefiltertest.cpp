@@ -0,0 +1,198 @@
+/*
+    SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "../filters/native-filter.h"
+#include "../kig/kig_document.h"
+#include "../misc/coordinate_system.h"
+#include "../misc/cubic-common.h"
+#include "../misc/kigtransform.h"
+#include "../objects/bogus_imp.h"
+#include "../objects/circle_imp.h"
+#include "../objects/conic_imp.h"
+#include "../objects/cubic_imp.h"
+#include "../objects/line_imp.h"
+#include "../objects/object_calcer.h"
+#include "../objects/object_drawer.h"
+#include "../objects/object_factory.h"
+#include "../objects/object_holder.h"
+#include "../objects/other_imp.h"
+#include "../objects/point_imp.h"
+#include "../objects/point_type.h"
+#include "../objects/text_imp.h"
+
+#include <QTemporaryDir>
+#include <QTest>
+
+#include <cmath>
+#include <memory>
+
+class NativeFilterTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void testRoundTrip();
+};
+
+namespace
+{
+/**
+ * a document with an ObjectConstCalcer for every type of ObjectImp
+ * that can be saved, and some ObjectTypeCalcer's and
+ * ObjectPropertyCalcer's depending on them.
+ */
+KigDocument *buildDocument()
+{
+    KigDocument *doc = new KigDocument();
+    doc->setGrid(false);
+    doc->setAxes(true);
+
+    std::vector<ObjectCalcer *> calcers;
+    // the calcers are calculated as they are built, the later ones need
+    // the imps of the earlier ones
+    auto add = [&](ObjectCalcer *c) {
+        c->calc(*doc);
+        calcers.push_back(c);
+    };
+    const ObjectFactory *factory = ObjectFactory::instance();
+
+    ObjectTypeCalcer *a = factory->fixedPointCalcer(Coordinate(0.1, -2.5));
+    ObjectTypeCalcer *b = factory->fixedPointCalcer(Coordinate(1. / 3, 7.25));
+    add(a);
+    add(b);
+    std::vector<ObjectCalcer *> ab = {a, b};
+    add(new ObjectTypeCalcer(MidPointType::instance(), ab));
+
+    ObjectConstCalcer *segment = new ObjectConstCalcer(new SegmentImp(Coordinate(-1, 0), Coordinate(2, 3)));
+    add(segment);
+    add(new ObjectPropertyCalcer(segment, "mid-point"));
+
+    ObjectConstCalcer *circle = new ObjectConstCalcer(new CircleImp(Coordinate(0.5, 0.5), 2.75));
+    add(circle);
+    ObjectTypeCalcer *constrained = factory->constrainedPointCalcer(circle, 0.3);
+    add(constrained);
+    std::vector<ObjectCalcer *> moving = {constrained, b};
+    ObjectTypeCalcer::shared_ptr mid = new ObjectTypeCalcer(MidPointType::instance(), moving);
+    mid->calc(*doc);
+    // the locus calcer has a HierarchyImp parent, and we save a copy of
+    // its LocusImp too
+    ObjectTypeCalcer *locus = factory->locusCalcer(constrained, mid.get());
+    add(locus);
+    add(new ObjectConstCalcer(locus->imp()->copy()));
+
+    add(new ObjectConstCalcer(new IntImp(-42)));
+    add(new ObjectConstCalcer(new DoubleImp(0.1 + 0.2)));
+    add(new ObjectConstCalcer(new StringImp(QStringLiteral("<&\"'> ünïcödé"))));
+    add(new ObjectConstCalcer(new TransformationImp(Transformation::rotation(0.7, Coordinate(1, 2)))));
+    add(new ObjectConstCalcer(new LineImp(Coordinate(0, 0), Coordinate(1e-300, 1e300))));
+    add(new ObjectConstCalcer(new RayImp(Coordinate(-3, 4), Coordinate(5, -6))));
+    add(new ObjectConstCalcer(new PointImp(Coordinate(M_PI, -M_E))));
+    add(new ObjectConstCalcer(new TextImp(QStringLiteral("a label\nover two lines"), Coordinate(3, 3), true)));
+    add(new ObjectConstCalcer(new AngleImp(Coordinate(1, 1), 0.25, 1.5, false)));
+    add(new ObjectConstCalcer(new ArcImp(Coordinate(-1, -1), 1.5, 0.5, 2.5)));
+    add(new ObjectConstCalcer(new VectorImp(Coordinate(0, 1), Coordinate(2, 3))));
+    add(new ObjectConstCalcer(new ConicImpPolar(ConicPolarData(Coordinate(1, 2), 3.5, 0.25, -0.5))));
+    add(new ObjectConstCalcer(new CubicImp(CubicCartesianData(1, -2, 3, -4, 5, -6, 7, -8, 9, -10))));
+
+    std::vector<ObjectHolder *> holders;
+    int i = 0;
+    for (ObjectCalcer *c : calcers) {
+        // vary the drawers, and name every other object
+        ++i;
+        ObjectDrawer *drawer = new ObjectDrawer(QColor::fromRgb(i * 10, 255 - i * 5, i * 3),
+                                                i % 4 - 1,
+                                                i % 3 != 0,
+                                                static_cast<Qt::PenStyle>(Qt::SolidLine + i % 5),
+                                                static_cast<Kig::PointStyle>(i % 5));
+        ObjectConstCalcer *namecalcer = nullptr;
+        if (i % 2 == 0)
+            namecalcer = new ObjectConstCalcer(new StringImp(QStringLiteral("object %1").arg(i)));
+        holders.push_back(new ObjectHolder(c, drawer, namecalcer));
+    }
+    doc->addObjects(holders);
+    return doc;
+}
+
+// compares the calcers a and b and their ancestors
+void compareCalcers(const ObjectCalcer *a, const ObjectCalcer *b)
+{
+    QVERIFY(a && b);
+    QCOMPARE(typeid(*a).name(), typeid(*b).name());
+    QVERIFY2(a->imp()->equals(*b->imp()), a->imp()->type()->internalName());
+    if (const ObjectTypeCalcer *ta = dynamic_cast<const ObjectTypeCalcer *>(a))
+        QCOMPARE(ta->type()->fullName(), static_cast<const ObjectTypeCalcer *>(b)->type()->fullName());
+    if (const ObjectPropertyCalcer *propa = dynamic_cast<const ObjectPropertyCalcer *>(a)) {
+        const ObjectPropertyCalcer *propb = static_cast<const ObjectPropertyCalcer *>(b);
+        QCOMPARE(propa->parent()->imp()->getPropName(propa->propGid()), propb->parent()->imp()->getPropName(propb->propGid()));
+    }
+
+    const std::span<ObjectCalcer *const> pa = a->parentsView();
+    const std::span<ObjectCalcer *const> pb = b->parentsView();
+    QCOMPARE(pa.size(), pb.size());
+    for (std::size_t i = 0; i < pa.size(); ++i) {
+        compareCalcers(pa[i], pb[i]);
+        if (QTest::currentTestFailed())
+            return;
+    }
+}
+
+void compareDocuments(const KigDocument &a, const KigDocument &b)
+{
+    QCOMPARE(a.grid(), b.grid());
+    QCOMPARE(a.axes(), b.axes());
+    QCOMPARE(a.coordinateSystem().type(), b.coordinateSystem().type());
+
+    const std::vector<ObjectHolder *> &oa = a.objects();
+    const std::vector<ObjectHolder *> &ob = b.objects();
+    QCOMPARE(oa.size(), ob.size());
+    for (std::size_t i = 0; i < oa.size(); ++i) {
+        const ObjectDrawer *da = oa[i]->drawer();
+        const ObjectDrawer *db = ob[i]->drawer();
+        QCOMPARE(da->color(), db->color());
+        QCOMPARE(da->width(), db->width());
+        QCOMPARE(da->shown(), db->shown());
+        QCOMPARE(da->style(), db->style());
+        QCOMPARE(da->pointStyle(), db->pointStyle());
+        QCOMPARE(da->font(), db->font());
+
+        QCOMPARE(oa[i]->nameCalcer() != nullptr, ob[i]->nameCalcer() != nullptr);
+        if (oa[i]->nameCalcer())
+            compareCalcers(oa[i]->nameCalcer(), ob[i]->nameCalcer());
+        compareCalcers(oa[i]->calcer(), ob[i]->calcer());
+        if (QTest::currentTestFailed())
+            return;
+    }
+}
+}
+
+void NativeFilterTest::testRoundTrip()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString kig = dir.filePath(QStringLiteral("roundtrip.kig"));
+    const QString kigb = dir.filePath(QStringLiteral("roundtrip.kigb"));
+
+    std::unique_ptr<KigDocument> original(buildDocument());
+    QVERIFY(KigFilterNative::instance()->save(*original, kig));
+    QVERIFY(KigFilterNative::instance()->save(*original, kigb));
+
+    std::unique_ptr<KigDocument> fromkig(KigFilterNative::instance()->load(kig));
+    QVERIFY(fromkig);
+    std::unique_ptr<KigDocument> fromkigb(KigFilterNative::instance()->load(kigb));
+    QVERIFY(fromkigb);
+
+    compareDocuments(*original, *fromkig);
+    if (QTest::currentTestFailed())
+        return;
+    compareDocuments(*original, *fromkigb);
+    if (QTest::currentTestFailed())
+        return;
+    compareDocuments(*fromkig, *fromkigb);
+}
+
+QTEST_MAIN(NativeFilterTest)
+
+#include "nativefiltertest.moc"
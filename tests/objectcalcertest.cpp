@@ -0,0 +1,183 @@
+/*
+    SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "../objects/bogus_imp.h"
+#include "../objects/object_calcer.h"
+#include "../objects/point_type.h"
+
+#include <QList>
+#include <QTest>
+
+#include <algorithm>
+#include <map>
+#include <vector>
+
+class ObjectCalcerTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void testDeleteChildren_data();
+    void testDeleteChildren();
+    void testSetParents();
+};
+
+namespace
+{
+/**
+ * An ObjectConstCalcer that tells when it is deleted, which is when the
+ * last reference to it is released.
+ */
+class TrackedCalcer : public ObjectConstCalcer
+{
+    bool &mdeleted;
+
+public:
+    TrackedCalcer(int value, bool &deleted)
+        : ObjectConstCalcer(new IntImp(value))
+        , mdeleted(deleted)
+    {
+        mdeleted = false;
+    }
+    ~TrackedCalcer() override
+    {
+        mdeleted = true;
+    }
+};
+
+// the children are never calculated, so any type will do for them
+ObjectTypeCalcer *typeCalcer(const std::vector<ObjectCalcer *> &parents)
+{
+    return new ObjectTypeCalcer(MidPointType::instance(), parents, false);
+}
+
+// checks that the children of every parent are exactly the calcers
+// that have it among their parents, as often as they have it
+void checkChildren(const std::vector<ObjectCalcer *> &parents, const std::vector<ObjectCalcer *> &children)
+{
+    for (ObjectCalcer *p : parents) {
+        std::map<ObjectCalcer *, int> expected;
+        for (ObjectCalcer *c : children)
+            for (ObjectCalcer *cp : c->parentsView())
+                if (cp == p)
+                    ++expected[c];
+        std::map<ObjectCalcer *, int> actual;
+        for (ObjectCalcer *c : p->childrenView())
+            ++actual[c];
+        QVERIFY(actual == expected);
+        QCOMPARE(p->children().size(), p->childrenView().size());
+    }
+}
+}
+
+void ObjectCalcerTest::testDeleteChildren_data()
+{
+    QTest::addColumn<QList<int>>("order");
+    // all orders of deleting the four children
+    QList<int> order = {0, 1, 2, 3};
+    do {
+        QString name;
+        for (int i : order)
+            name += QString::number(i);
+        QTest::newRow(qPrintable(name)) << order;
+    } while (std::next_permutation(order.begin(), order.end()));
+}
+
+void ObjectCalcerTest::testDeleteChildren()
+{
+    QFETCH(QList<int>, order);
+
+    bool adeleted, bdeleted;
+    ObjectCalcer *a = new TrackedCalcer(1, adeleted);
+    ObjectCalcer *b = new TrackedCalcer(2, bdeleted);
+    // only the children keep a and b alive, with a reference for every
+    // time they have them among their parents
+    std::vector<ObjectCalcer::shared_ptr> children;
+    children.push_back(typeCalcer({a, a}));
+    children.push_back(typeCalcer({a, b, a}));
+    children.push_back(new ObjectPropertyCalcer(a, "base-object-type"));
+    children.push_back(typeCalcer({b, a, b, b}));
+
+    std::vector<ObjectCalcer *> alive;
+    for (const ObjectCalcer::shared_ptr &c : children)
+        alive.push_back(c.get());
+    checkChildren({a, b}, alive);
+    if (QTest::currentTestFailed())
+        return;
+
+    for (int i : order) {
+        alive.erase(std::find(alive.begin(), alive.end(), children[i].get()));
+        children[i] = nullptr;
+
+        std::vector<ObjectCalcer *> parents;
+        bool aused = false;
+        bool bused = false;
+        for (ObjectCalcer *c : alive) {
+            const std::span<ObjectCalcer *const> cparents = c->parentsView();
+            aused |= std::find(cparents.begin(), cparents.end(), a) != cparents.end();
+            bused |= std::find(cparents.begin(), cparents.end(), b) != cparents.end();
+        }
+        QCOMPARE(adeleted, !aused);
+        QCOMPARE(bdeleted, !bused);
+        if (aused)
+            parents.push_back(a);
+        if (bused)
+            parents.push_back(b);
+        checkChildren(parents, alive);
+        if (QTest::currentTestFailed())
+            return;
+    }
+    QVERIFY(adeleted);
+    QVERIFY(bdeleted);
+}
+
+void ObjectCalcerTest::testSetParents()
+{
+    bool adeleted, bdeleted, cdeleted;
+    ObjectCalcer *a = new TrackedCalcer(1, adeleted);
+    ObjectCalcer *b = new TrackedCalcer(2, bdeleted);
+    ObjectCalcer *c = new TrackedCalcer(3, cdeleted);
+    {
+        ObjectCalcer::shared_ptr aref = a;
+        ObjectCalcer::shared_ptr cref = c;
+
+        ObjectTypeCalcer::shared_ptr first = typeCalcer({a, b, a});
+        ObjectTypeCalcer::shared_ptr second = typeCalcer({b, a, b});
+        checkChildren({a, b, c}, {first.get(), second.get()});
+        if (QTest::currentTestFailed())
+            return;
+
+        // b is only kept alive by its children..
+        first->setParents({c, a, c});
+        checkChildren({a, b, c}, {first.get(), second.get()});
+        if (QTest::currentTestFailed())
+            return;
+        second->setParents({a, a});
+        QVERIFY(bdeleted);
+        checkChildren({a, c}, {first.get(), second.get()});
+        if (QTest::currentTestFailed())
+            return;
+
+        // setting the same parents again keeps them alive
+        first->setParents(first->parents());
+        QVERIFY(!adeleted && !cdeleted);
+        checkChildren({a, c}, {first.get(), second.get()});
+        if (QTest::currentTestFailed())
+            return;
+
+        first = nullptr;
+        checkChildren({a, c}, {second.get()});
+        if (QTest::currentTestFailed())
+            return;
+        QVERIFY(c->childrenView().empty());
+    }
+    QVERIFY(adeleted);
+    QVERIFY(cdeleted);
+}
+
+QTEST_GUILESS_MAIN(ObjectCalcerTest)
+
+#include "objectcalcertest.moc"